@@ -547,12 +547,10 @@ TrunkAllocator& TrunkAllocator::operator=(TrunkAllocator&& other) noexcept {
 
 TreeTrunk* TrunkAllocator::allocTrunk() {
 	this->allocationCount++;
-	std::cout << "allocTrunk " << this->allocationCount << std::endl;
 	return static_cast<TreeTrunk*>(aligned_malloc(sizeof(TreeTrunk), alignof(TreeTrunk)));
 }
 void TrunkAllocator::freeTrunk(TreeTrunk* trunk) {
 	this->allocationCount--;
-	std::cout << "freeTrunk " << this->allocationCount << std::endl;
 	aligned_free(trunk);
 }
 void TrunkAllocator::freeAllTrunks(TreeTrunk& baseTrunk, int baseTrunkSize) {
@@ -1062,6 +1062,13 @@ public:
 		forEachColissionBetweenRecursive<Boundable, TrunkSIMDHelperFallback, Func>(this->tree.baseTrunk, this->tree.baseTrunkSize, other.tree.baseTrunk, other.tree.baseTrunkSize, func);
 	}
 
+	// calls func(obj, other) for every object in this tree whose bounds overlap objBounds, obj itself does not need to be in the tree
+	template<typename Func>
+	void forEachColissionWith(Boundable* obj, const BoundsTemplate<float>& objBounds, const Func& func) const {
+		if(this->tree.baseTrunkSize == 0) return;
+		forEachColissionWithRecursive<Boundable, TrunkSIMDHelperFallback, Func>(obj, objBounds, this->tree.baseTrunk, this->tree.baseTrunkSize, func);
+	}
+
 	void recalculateBounds() {
 		recalculateBoundsRecursive<Boundable>(this->tree.baseTrunk, this->tree.baseTrunkSize);
 	}
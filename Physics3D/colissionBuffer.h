@@ -10,10 +10,32 @@ struct Colission {
 	Vec3 exitVector;
 };
 
+/*
+	A colission scheduled for handling, isTerrain tells whether it refers to a free-terrain colission
+*/
+struct ColouredColission {
+	const Colission* colission;
+	bool isTerrain;
+};
+
 struct ColissionBuffer {
 	std::vector<Colission> freePartColissions;
 	std::vector<Colission> freeTerrainColissions;
 
+	/*
+		Filled by findSpeculativeColissions, pairs of fast parts and the parts they may hit within the next tick that do not intersect yet
+		intersection lies halfway between the closest points, exitVector points from the closest point on p1 to the closest point on p2
+	*/
+	std::vector<Colission> speculativePartColissions;
+	std::vector<Colission> speculativeTerrainColissions;
+
+	/*
+		Filled by colourColissions, colissions grouped into batches such that no two colissions in the same batch touch the same MotorizedPhysical
+		Batch i spans colouredColissions[colourBatchStarts[i]] up to colouredColissions[colourBatchStarts[i+1]]
+	*/
+	std::vector<ColouredColission> colouredColissions;
+	std::vector<std::size_t> colourBatchStarts;
+
 	inline void addFreePartColission(Part* a, Part* b, Position intersection, Vec3 exitVector) {
 		freePartColissions.push_back(Colission{a, b, intersection, exitVector});
 	}
@@ -23,6 +45,13 @@ struct ColissionBuffer {
 	inline void clear() {
 		freePartColissions.clear();
 		freeTerrainColissions.clear();
+		speculativePartColissions.clear();
+		speculativeTerrainColissions.clear();
+		colouredColissions.clear();
+		colourBatchStarts.clear();
+	}
+	inline std::size_t getColourBatchCount() const {
+		return colourBatchStarts.empty() ? 0 : colourBatchStarts.size() - 1;
 	}
 };
 };
@@ -0,0 +1,132 @@
+#include "contactCache.h"
+
+#include "math/linalg/mat.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace P3D {
+/*
+	Upper bound of how far the contact moved between both relative transforms of the second part in the first part's space
+	The contact lies within both parts, so it suffices to bound the relative motion of either part's points within it's maxRadius
+*/
+static double getContactDisplacement(const CFrame& oldTransform, const CFrame& newTransform, double radiusFirst, double radiusSecond) {
+	Mat3 oldRotation = oldTransform.getRotation().asRotationMatrix();
+	Mat3 newRotation = newTransform.getRotation().asRotationMatrix();
+
+	double rotationDifferenceSq = 0.0;
+	for(std::size_t row = 0; row < 3; row++) {
+		for(std::size_t col = 0; col < 3; col++) {
+			double d = newRotation(row, col) - oldRotation(row, col);
+			rotationDifferenceSq += d * d;
+		}
+	}
+	double rotationDifference = std::sqrt(rotationDifferenceSq);
+
+	// points of the second part, seen from the first part
+	double secondMovement = length(newTransform.getPosition() - oldTransform.getPosition()) + rotationDifference * radiusSecond;
+	// points of the first part, seen from the second part
+	Vec3 origin(0.0, 0.0, 0.0);
+	double firstMovement = length(newTransform.globalToLocal(origin) - oldTransform.globalToLocal(origin)) + rotationDifference * radiusFirst;
+
+	return std::min(firstMovement, secondMovement);
+}
+
+void ContactCache::takeReusableColissions(std::vector<Colission>& colissions, std::vector<Colission>& reused, double tolerance, std::size_t age) {
+	std::size_t kept = 0;
+	for(std::size_t i = 0; i < colissions.size(); i++) {
+		Colission col = colissions[i];
+
+		auto found = entries.find(PartPair(col.p1, col.p2));
+		if(found != entries.end()) {
+			Entry& entry = found->second;
+			CFrame relativeTransform = col.p1->getCFrame().globalToLocal(col.p2->getCFrame());
+			if(getContactDisplacement(entry.relativeTransform, relativeTransform, col.p1->maxRadius, col.p2->maxRadius) < tolerance) {
+				// re-project the penetration depth onto the cached normal, so the contact keeps responding to the small motion since it was computed
+				Vec3 movedIntersection = relativeTransform.localToGlobal(entry.relativeTransform.globalToLocal(entry.localIntersection));
+				double cachedDepth = length(entry.localExitVector);
+				if(cachedDepth > 0.0) {
+					Vec3 normal = entry.localExitVector / cachedDepth;
+					double depth = cachedDepth - (movedIntersection - entry.localIntersection) * normal;
+					if(depth > 0.0) {
+						col.intersection = col.p1->getCFrame().localToGlobal((entry.localIntersection + movedIntersection) * 0.5);
+						col.exitVector = col.p1->getCFrame().localToRelative(normal * depth);
+						entry.lastUsed = age;
+						reused.push_back(col);
+						continue;
+					}
+				}
+			}
+		}
+
+		colissions[kept++] = col;
+	}
+	colissions.resize(kept);
+}
+
+void ContactCache::storeColissions(const std::vector<Colission>& colissions, std::size_t age) {
+	for(const Colission& col : colissions) {
+		const GlobalCFrame& cframe = col.p1->getCFrame();
+		PartPair pair(col.p1, col.p2);
+		Entry entry{
+			cframe.globalToLocal(col.p2->getCFrame()),
+			cframe.globalToLocal(col.intersection),
+			cframe.relativeToLocal(col.exitVector),
+			age
+		};
+		auto inserted = entries.insert_or_assign(pair, entry);
+		if(inserted.second) {
+			pairsOfPart[col.p1].push_back(pair);
+			pairsOfPart[col.p2].push_back(pair);
+		}
+	}
+}
+
+void ContactCache::unlinkPair(const Part* part, const PartPair& pair) {
+	auto found = pairsOfPart.find(part);
+	if(found == pairsOfPart.end()) return;
+	std::vector<PartPair>& pairs = found->second;
+	for(std::size_t i = 0; i < pairs.size(); i++) {
+		if(pairs[i] == pair) {
+			pairs[i] = pairs.back();
+			pairs.pop_back();
+			break;
+		}
+	}
+	if(pairs.empty()) {
+		pairsOfPart.erase(found);
+	}
+}
+
+void ContactCache::erasePair(std::unordered_map<PartPair, Entry, PairHash>::iterator entry) {
+	PartPair pair = entry->first;
+	entries.erase(entry);
+	unlinkPair(pair.first, pair);
+	unlinkPair(pair.second, pair);
+}
+
+void ContactCache::removeStaleEntries(std::size_t age) {
+	for(auto iter = entries.begin(); iter != entries.end();) {
+		if(iter->second.lastUsed != age) {
+			auto stale = iter++;
+			erasePair(stale);
+		} else {
+			++iter;
+		}
+	}
+}
+
+void ContactCache::forgetPart(const Part* part) {
+	// the cache is empty while reuseRestingContacts is off, parts are removed far more often than the cache is used
+	if(entries.empty()) return;
+
+	auto found = pairsOfPart.find(part);
+	if(found == pairsOfPart.end()) return;
+	std::vector<PartPair> pairs = std::move(found->second);
+	pairsOfPart.erase(found);
+	for(const PartPair& pair : pairs) {
+		entries.erase(pair);
+		unlinkPair(pair.first == part ? pair.second : pair.first, pair);
+	}
+}
+};
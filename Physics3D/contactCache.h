@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cstddef>
+#include <functional>
+
+#include "math/linalg/vec.h"
+#include "math/cframe.h"
+#include "part.h"
+#include "colissionBuffer.h"
+
+namespace P3D {
+/*
+	Remembers the last computed intersection of every colliding pair of parts, local to the first part
+	While the relative transform of a pair barely changes, as in settled piles, the old intersection is moved along with the first part instead of running GJK and EPA again
+	Entries are compared against the relative transform at which they were computed, so reuse never drifts further than the tolerance
+*/
+class ContactCache {
+	struct Entry {
+		CFrame relativeTransform;
+		Vec3 localIntersection;
+		Vec3 localExitVector;
+		std::size_t lastUsed;
+	};
+
+	struct PairHash {
+		std::size_t operator()(const std::pair<const Part*, const Part*>& pair) const {
+			std::size_t a = std::hash<const Part*>()(pair.first);
+			std::size_t b = std::hash<const Part*>()(pair.second);
+			return a ^ (b + 0x9e3779b9 + (a << 6) + (a >> 2));
+		}
+	};
+
+	typedef std::pair<const Part*, const Part*> PartPair;
+
+	std::unordered_map<PartPair, Entry, PairHash> entries;
+	// the keys of entries every part is in, so a removed part's entries are found without scanning all of them
+	std::unordered_map<const Part*, std::vector<PartPair>> pairsOfPart;
+
+	void unlinkPair(const Part* part, const PartPair& pair);
+	void erasePair(std::unordered_map<PartPair, Entry, PairHash>::iterator entry);
+
+public:
+	/*
+		Moves every colission whose cached intersection can be reused from colissions to reused, filling in the intersection and exitVector
+		A cached intersection is reusable if the parts moved less than tolerance relative to each other around the contact
+	*/
+	void takeReusableColissions(std::vector<Colission>& colissions, std::vector<Colission>& reused, double tolerance, std::size_t age);
+	// stores the freshly computed intersections of colissions
+	void storeColissions(const std::vector<Colission>& colissions, std::size_t age);
+	// removes all entries that weren't used during the given age, these pairs no longer collide
+	void removeStaleEntries(std::size_t age);
+	// removes all entries of the given part, only has to look at that part's own entries
+	void forgetPart(const Part* part);
+
+	inline std::size_t size() const { return entries.size(); }
+	inline void clear() {
+		entries.clear();
+		pairsOfPart.clear();
+	}
+};
+};
@@ -3,8 +3,11 @@
 #include <malloc.h>
 #include <stdlib.h>
 
+#include "../misc/allocationTracker.h"
+
 namespace P3D {
 void* aligned_malloc(size_t size, size_t align) {
+	allocationTracker.countAllocation(size);
 #ifdef _MSC_VER
 	return _aligned_malloc(size, align);
 #else
@@ -12,6 +15,7 @@ void* aligned_malloc(size_t size, size_t align) {
 #endif
 }
 void aligned_free(void* ptr) {
+	if(ptr != nullptr) allocationTracker.countFree();
 #ifdef _MSC_VER
 	_aligned_free(ptr);
 #else
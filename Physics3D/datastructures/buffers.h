@@ -335,6 +335,11 @@ public:
 		return T(total / limit);
 	}
 
+	inline void clear() {
+		curI = 0;
+		hasComeAround = false;
+	}
+
 	inline void resize(size_t newCapacity) {
 		T* newBuf = new T[newCapacity];
 
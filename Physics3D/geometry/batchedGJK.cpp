@@ -0,0 +1,26 @@
+#include "batchedGJK.h"
+
+#include "shapeClass.h"
+#include "builtinShapeClasses.h"
+#include "../misc/cpuid.h"
+
+namespace P3D {
+bool isBatchableGJKClass(std::size_t intersectionClassID) {
+	return intersectionClassID == CUBE_CLASS_ID || intersectionClassID == SPHERE_CLASS_ID;
+}
+
+void runGJKBatchFallback(const GJKBatch& batch, std::optional<Tetrahedron>* results) {
+	for(int i = 0; i < batch.size; i++) {
+		ColissionPair info{*batch.first, *batch.second, batch.transforms[i], batch.scalesFirst[i], batch.scalesSecond[i]};
+		results[i] = runGJKTransformed(info, -batch.transforms[i].position);
+	}
+}
+
+void runGJKBatch(const GJKBatch& batch, std::optional<Tetrahedron>* results) {
+	if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2 | CPUIDCheck::FMA)) {
+		runGJKBatchAVX(batch, results);
+	} else {
+		runGJKBatchFallback(batch, results);
+	}
+}
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <optional>
+#include <cstddef>
+
+#include "../math/linalg/vec.h"
+#include "../math/linalg/mat.h"
+#include "../math/cframe.h"
+#include "genericIntersection.h"
+
+namespace P3D {
+class ShapeClass;
+
+/*
+	Up to SIZE GJK problems between the same two shape classes, run in lockstep by runGJKBatch
+	transforms[i] is the transform of the second shape relative to the first, as in ColissionPair
+*/
+struct GJKBatch {
+	static constexpr int SIZE = 8;
+
+	const ShapeClass* first;
+	const ShapeClass* second;
+
+	int size = 0;
+	CFramef transforms[SIZE];
+	DiagonalMat3f scalesFirst[SIZE];
+	DiagonalMat3f scalesSecond[SIZE];
+
+	GJKBatch(const ShapeClass* first, const ShapeClass* second) : first(first), second(second) {}
+
+	inline bool isFull() const { return size == SIZE; }
+	inline void add(const CFramef& transform, const DiagonalMat3f& scaleFirst, const DiagonalMat3f& scaleSecond) {
+		transforms[size] = transform;
+		scalesFirst[size] = scaleFirst;
+		scalesSecond[size] = scaleSecond;
+		size++;
+	}
+};
+
+// only shape classes with an inlined support function can be batched, at the moment boxes and spheres
+bool isBatchableGJKClass(std::size_t intersectionClassID);
+
+/*
+	Runs GJK for every problem of the batch, results[i] is set just like runGJKTransformed would for problem i
+	Both shape classes of the batch must be batchable
+*/
+void runGJKBatchFallback(const GJKBatch& batch, std::optional<Tetrahedron>* results);
+void runGJKBatchAVX(const GJKBatch& batch, std::optional<Tetrahedron>* results);
+void runGJKBatch(const GJKBatch& batch, std::optional<Tetrahedron>* results);
+};
@@ -0,0 +1,301 @@
+#include "batchedGJK.h"
+
+#include "shapeClass.h"
+#include "builtinShapeClasses.h"
+#include "../misc/debug.h"
+
+#include <immintrin.h>
+
+#define GJK_MAX_ITER 200
+
+// AVX implementation of runGJKBatch, every lane of the registers below holds one GJK problem
+namespace P3D {
+namespace {
+struct Vec3x8 {
+	__m256 x, y, z;
+};
+
+struct MinkPointx8 {
+	Vec3x8 p;
+	Vec3x8 originFirst;
+	Vec3x8 originSecond;
+};
+
+inline Vec3x8 operator+(const Vec3x8& a, const Vec3x8& b) {
+	return Vec3x8{_mm256_add_ps(a.x, b.x), _mm256_add_ps(a.y, b.y), _mm256_add_ps(a.z, b.z)};
+}
+inline Vec3x8 operator-(const Vec3x8& a, const Vec3x8& b) {
+	return Vec3x8{_mm256_sub_ps(a.x, b.x), _mm256_sub_ps(a.y, b.y), _mm256_sub_ps(a.z, b.z)};
+}
+inline Vec3x8 operator-(const Vec3x8& a) {
+	__m256 signBit = _mm256_set1_ps(-0.0f);
+	return Vec3x8{_mm256_xor_ps(a.x, signBit), _mm256_xor_ps(a.y, signBit), _mm256_xor_ps(a.z, signBit)};
+}
+inline Vec3x8 operator*(const Vec3x8& a, const Vec3x8& b) {
+	return Vec3x8{_mm256_mul_ps(a.x, b.x), _mm256_mul_ps(a.y, b.y), _mm256_mul_ps(a.z, b.z)};
+}
+inline __m256 dot(const Vec3x8& a, const Vec3x8& b) {
+	return _mm256_fmadd_ps(a.z, b.z, _mm256_fmadd_ps(a.y, b.y, _mm256_mul_ps(a.x, b.x)));
+}
+inline Vec3x8 cross(const Vec3x8& a, const Vec3x8& b) {
+	return Vec3x8{
+		_mm256_fmsub_ps(a.y, b.z, _mm256_mul_ps(a.z, b.y)),
+		_mm256_fmsub_ps(a.z, b.x, _mm256_mul_ps(a.x, b.z)),
+		_mm256_fmsub_ps(a.x, b.y, _mm256_mul_ps(a.y, b.x))
+	};
+}
+// lanes where mask is set take b, others keep a
+inline Vec3x8 select(const Vec3x8& a, const Vec3x8& b, __m256 mask) {
+	return Vec3x8{_mm256_blendv_ps(a.x, b.x, mask), _mm256_blendv_ps(a.y, b.y, mask), _mm256_blendv_ps(a.z, b.z, mask)};
+}
+inline MinkPointx8 select(const MinkPointx8& a, const MinkPointx8& b, __m256 mask) {
+	return MinkPointx8{select(a.p, b.p, mask), select(a.originFirst, b.originFirst, mask), select(a.originSecond, b.originSecond, mask)};
+}
+inline __m256 isPositive(__m256 v) {
+	return _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GT_OQ);
+}
+inline __m256 isNegative(__m256 v) {
+	return _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LT_OQ);
+}
+
+// vectorized equivalents of CubeClass::furthestInDirection and SphereClass::furthestInDirection
+template<std::size_t ClassID>
+inline Vec3x8 furthestInDirection(const Vec3x8& direction);
+
+template<>
+inline Vec3x8 furthestInDirection<CUBE_CLASS_ID>(const Vec3x8& direction) {
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 minusOne = _mm256_set1_ps(-1.0f);
+	return Vec3x8{
+		_mm256_blendv_ps(one, minusOne, isNegative(direction.x)),
+		_mm256_blendv_ps(one, minusOne, isNegative(direction.y)),
+		_mm256_blendv_ps(one, minusOne, isNegative(direction.z))
+	};
+}
+
+template<>
+inline Vec3x8 furthestInDirection<SPHERE_CLASS_ID>(const Vec3x8& direction) {
+	__m256 lenSq = dot(direction, direction);
+	__m256 isZero = _mm256_cmp_ps(lenSq, _mm256_setzero_ps(), _CMP_EQ_OQ);
+	__m256 invLength = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(lenSq));
+	Vec3x8 normalized{_mm256_mul_ps(direction.x, invLength), _mm256_mul_ps(direction.y, invLength), _mm256_mul_ps(direction.z, invLength)};
+	Vec3x8 fallback{_mm256_set1_ps(1.0f), _mm256_setzero_ps(), _mm256_setzero_ps()};
+	return select(normalized, fallback, isZero);
+}
+
+struct BatchTransforms {
+	__m256 rotation[3][3];
+	Vec3x8 position;
+	Vec3x8 scaleFirst;
+	Vec3x8 scaleSecond;
+
+	explicit BatchTransforms(const GJKBatch& batch) {
+		alignas(32) float buf[15][GJKBatch::SIZE]{};
+		for(int lane = 0; lane < batch.size; lane++) {
+			Mat3f rot = batch.transforms[lane].getRotation().asRotationMatrix();
+			for(int row = 0; row < 3; row++) {
+				for(int col = 0; col < 3; col++) {
+					buf[row * 3 + col][lane] = rot(row, col);
+				}
+			}
+			for(int axis = 0; axis < 3; axis++) {
+				buf[9 + axis][lane] = batch.transforms[lane].getPosition()[axis];
+				buf[12 + axis][lane] = batch.scalesFirst[lane][axis];
+			}
+		}
+		for(int row = 0; row < 3; row++) {
+			for(int col = 0; col < 3; col++) {
+				rotation[row][col] = _mm256_load_ps(buf[row * 3 + col]);
+			}
+		}
+		position = Vec3x8{_mm256_load_ps(buf[9]), _mm256_load_ps(buf[10]), _mm256_load_ps(buf[11])};
+		scaleFirst = Vec3x8{_mm256_load_ps(buf[12]), _mm256_load_ps(buf[13]), _mm256_load_ps(buf[14])};
+
+		for(int lane = 0; lane < batch.size; lane++) {
+			for(int axis = 0; axis < 3; axis++) {
+				buf[axis][lane] = batch.scalesSecond[lane][axis];
+			}
+		}
+		scaleSecond = Vec3x8{_mm256_load_ps(buf[0]), _mm256_load_ps(buf[1]), _mm256_load_ps(buf[2])};
+	}
+
+	inline Vec3x8 localToGlobal(const Vec3x8& v) const {
+		return Vec3x8{
+			_mm256_fmadd_ps(rotation[0][2], v.z, _mm256_fmadd_ps(rotation[0][1], v.y, _mm256_fmadd_ps(rotation[0][0], v.x, position.x))),
+			_mm256_fmadd_ps(rotation[1][2], v.z, _mm256_fmadd_ps(rotation[1][1], v.y, _mm256_fmadd_ps(rotation[1][0], v.x, position.y))),
+			_mm256_fmadd_ps(rotation[2][2], v.z, _mm256_fmadd_ps(rotation[2][1], v.y, _mm256_fmadd_ps(rotation[2][0], v.x, position.z)))
+		};
+	}
+	inline Vec3x8 relativeToLocal(const Vec3x8& v) const {
+		return Vec3x8{
+			_mm256_fmadd_ps(rotation[2][0], v.z, _mm256_fmadd_ps(rotation[1][0], v.y, _mm256_mul_ps(rotation[0][0], v.x))),
+			_mm256_fmadd_ps(rotation[2][1], v.z, _mm256_fmadd_ps(rotation[1][1], v.y, _mm256_mul_ps(rotation[0][1], v.x))),
+			_mm256_fmadd_ps(rotation[2][2], v.z, _mm256_fmadd_ps(rotation[1][2], v.y, _mm256_mul_ps(rotation[0][2], v.x)))
+		};
+	}
+};
+
+// mirrors getSupport in genericIntersection.cpp
+template<std::size_t FirstClassID, std::size_t SecondClassID>
+inline MinkPointx8 getSupport(const BatchTransforms& info, const Vec3x8& searchDirection) {
+	Vec3x8 furthest1 = info.scaleFirst * furthestInDirection<FirstClassID>(info.scaleFirst * searchDirection);
+	Vec3x8 transformedSearchDirection = -info.relativeToLocal(searchDirection);
+	Vec3x8 furthest2 = info.scaleSecond * furthestInDirection<SecondClassID>(info.scaleSecond * transformedSearchDirection);
+	Vec3x8 secondVertex = info.localToGlobal(furthest2);
+
+	return MinkPointx8{furthest1 - secondVertex, furthest1, secondVertex};
+}
+
+inline Vec3f extractLane(const Vec3x8& v, int lane) {
+	alignas(32) float x[GJKBatch::SIZE];
+	alignas(32) float y[GJKBatch::SIZE];
+	alignas(32) float z[GJKBatch::SIZE];
+	_mm256_store_ps(x, v.x);
+	_mm256_store_ps(y, v.y);
+	_mm256_store_ps(z, v.z);
+	return Vec3f(x[lane], y[lane], z[lane]);
+}
+
+inline MinkPoint extractLane(const MinkPointx8& v, int lane) {
+	return MinkPoint{extractLane(v.p, lane), extractLane(v.originFirst, lane), extractLane(v.originSecond, lane)};
+}
+
+// sets the iteration count of every lane that is active in activeBefore but no longer in activeAfter
+inline void recordFinishedLanes(__m256 activeBefore, __m256 activeAfter, int iterTime, int* laneIterations) {
+	int finishedLanes = _mm256_movemask_ps(activeBefore) & ~_mm256_movemask_ps(activeAfter);
+	for(int lane = 0; lane < GJKBatch::SIZE; lane++) {
+		if(finishedLanes & (1 << lane)) {
+			laneIterations[lane] = iterTime;
+		}
+	}
+}
+
+/*
+	Same steps as runGJKTransformed, every iteration every lane does exactly one support query
+	Lanes that found their answer are masked out of all further updates
+	Every lane is tallied with the iteration count the scalar version would report for it
+*/
+template<std::size_t FirstClassID, std::size_t SecondClassID>
+void runGJKBatchAVXImpl(const GJKBatch& batch, std::optional<Tetrahedron>* results) {
+	BatchTransforms info(batch);
+
+	__m256 laneIndices = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256 active = _mm256_cmp_ps(laneIndices, _mm256_set1_ps(static_cast<float>(batch.size)), _CMP_LT_OQ);
+	__m256 collided = _mm256_setzero_ps();
+	// lanes still active after the last iteration reached the limit, as in runGJKTransformed
+	int laneIterations[GJKBatch::SIZE];
+	for(int lane = 0; lane < GJKBatch::SIZE; lane++) {
+		laneIterations[lane] = GJK_MAX_ITER + 2;
+	}
+
+	Vec3x8 searchDirection = -info.position;
+	MinkPointx8 A = getSupport<FirstClassID, SecondClassID>(info, searchDirection);
+
+	searchDirection = -A.p;
+	MinkPointx8 B = getSupport<FirstClassID, SecondClassID>(info, searchDirection);
+	__m256 activeBefore = active;
+	active = _mm256_andnot_ps(isNegative(dot(B.p, searchDirection)), active);
+	recordFinishedLanes(activeBefore, active, 0, laneIterations);
+
+	Vec3x8 AO = -B.p;
+	Vec3x8 AB = A.p - B.p;
+	searchDirection = -cross(cross(AO, AB), AB);
+	MinkPointx8 C = getSupport<FirstClassID, SecondClassID>(info, searchDirection);
+	activeBefore = active;
+	active = _mm256_andnot_ps(isNegative(dot(C.p, searchDirection)), active);
+	recordFinishedLanes(activeBefore, active, 1, laneIterations);
+
+	MinkPointx8 D = C;
+
+	for(int iter = 0; iter < GJK_MAX_ITER && _mm256_movemask_ps(active) != 0; iter++) {
+		activeBefore = active;
+		// triangle, find which feature is closest to the origin
+		Vec3x8 AO = -C.p;
+		Vec3x8 AB = B.p - C.p;
+		Vec3x8 AC = A.p - C.p;
+		Vec3x8 normal = cross(AB, AC);
+		Vec3x8 nAB = cross(AB, normal);
+		Vec3x8 nAC = cross(normal, AC);
+
+		__m256 edgeAB = _mm256_and_ps(active, isPositive(dot(AO, nAB)));
+		__m256 edgeAC = _mm256_and_ps(_mm256_andnot_ps(edgeAB, active), isPositive(dot(AO, nAC)));
+		__m256 tetrahedron = _mm256_andnot_ps(_mm256_or_ps(edgeAB, edgeAC), active);
+		__m256 invert = _mm256_andnot_ps(isPositive(dot(normal, AO)), tetrahedron);
+
+		searchDirection = select(searchDirection, -cross(cross(AO, AB), AB), edgeAB);
+		searchDirection = select(searchDirection, -cross(cross(AO, AC), AC), edgeAC);
+		searchDirection = select(searchDirection, normal, tetrahedron);
+		searchDirection = select(searchDirection, -normal, invert);
+
+		// edge AB: A = B, B = C; edge AC: B = C; inverted triangle: swap A and B
+		MinkPointx8 oldA = A;
+		A = select(A, B, _mm256_or_ps(edgeAB, invert));
+		B = select(B, C, _mm256_or_ps(edgeAB, edgeAC));
+		B = select(B, oldA, invert);
+
+		MinkPointx8 support = getSupport<FirstClassID, SecondClassID>(info, searchDirection);
+		active = _mm256_andnot_ps(isNegative(dot(support.p, searchDirection)), active);
+		edgeAB = _mm256_and_ps(edgeAB, active);
+		edgeAC = _mm256_and_ps(edgeAC, active);
+		tetrahedron = _mm256_and_ps(tetrahedron, active);
+
+		C = select(C, support, _mm256_or_ps(edgeAB, edgeAC));
+		D = select(D, support, tetrahedron);
+
+		// tetrahedron, D is the new point at the top
+		Vec3x8 DO = -D.p;
+		Vec3x8 DC = C.p - D.p;
+		Vec3x8 DB = B.p - D.p;
+		Vec3x8 DA = A.p - D.p;
+		Vec3x8 nDCB = cross(DC, DB);
+		Vec3x8 nDBA = cross(DB, DA);
+		Vec3x8 nDAC = cross(DA, DC);
+
+		__m256 removeB = _mm256_and_ps(tetrahedron, isPositive(dot(nDBA, DO)));
+		__m256 removeD = _mm256_and_ps(_mm256_andnot_ps(removeB, tetrahedron), isPositive(dot(nDCB, DO)));
+		__m256 removeC = _mm256_and_ps(_mm256_andnot_ps(_mm256_or_ps(removeB, removeD), tetrahedron), isPositive(dot(nDAC, DO)));
+		__m256 enclosesOrigin = _mm256_andnot_ps(_mm256_or_ps(_mm256_or_ps(removeB, removeD), removeC), tetrahedron);
+
+		A = select(A, B, removeD);
+		B = select(B, C, _mm256_or_ps(removeD, removeC));
+		C = select(C, D, _mm256_or_ps(_mm256_or_ps(removeB, removeD), removeC));
+
+		collided = _mm256_or_ps(collided, enclosesOrigin);
+		active = _mm256_andnot_ps(enclosesOrigin, active);
+		recordFinishedLanes(activeBefore, active, iter + 2, laneIterations);
+	}
+
+	if(_mm256_movemask_ps(active) != 0) {
+		Debug::logWarn("GJK iteration limit reached!");
+	}
+
+	int collidedLanes = _mm256_movemask_ps(collided);
+	for(int lane = 0; lane < batch.size; lane++) {
+		bool laneCollided = (collidedLanes & (1 << lane)) != 0;
+		tallyGJKIterations(laneCollided, laneIterations[lane]);
+		if(laneCollided) {
+			results[lane] = Tetrahedron{extractLane(D, lane), extractLane(C, lane), extractLane(B, lane), extractLane(A, lane)};
+		} else {
+			results[lane] = std::optional<Tetrahedron>();
+		}
+	}
+}
+};
+
+void runGJKBatchAVX(const GJKBatch& batch, std::optional<Tetrahedron>* results) {
+	std::size_t firstID = batch.first->intersectionClassID;
+	std::size_t secondID = batch.second->intersectionClassID;
+
+	if(firstID == CUBE_CLASS_ID && secondID == CUBE_CLASS_ID) {
+		runGJKBatchAVXImpl<CUBE_CLASS_ID, CUBE_CLASS_ID>(batch, results);
+	} else if(firstID == CUBE_CLASS_ID && secondID == SPHERE_CLASS_ID) {
+		runGJKBatchAVXImpl<CUBE_CLASS_ID, SPHERE_CLASS_ID>(batch, results);
+	} else if(firstID == SPHERE_CLASS_ID && secondID == CUBE_CLASS_ID) {
+		runGJKBatchAVXImpl<SPHERE_CLASS_ID, CUBE_CLASS_ID>(batch, results);
+	} else if(firstID == SPHERE_CLASS_ID && secondID == SPHERE_CLASS_ID) {
+		runGJKBatchAVXImpl<SPHERE_CLASS_ID, SPHERE_CLASS_ID>(batch, results);
+	} else {
+		runGJKBatchFallback(batch, results);
+	}
+}
+};
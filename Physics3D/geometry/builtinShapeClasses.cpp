@@ -2,8 +2,19 @@
 
 #include "shapeCreation.h"
 #include "shapeLibrary.h"
+#include "quickhull.h"
 #include "../math/constants.h"
+#include "../math/utils.h"
 
+#include <limits>
+#include <cassert>
+#include <set>
+#include <utility>
+#include <vector>
+
+// polyhedra with more vertices than this get a collision LOD
+#define COLLISION_LOD_VERTEX_THRESHOLD 256
+#define COLLISION_LOD_VERTEX_COUNT 32
 
 namespace P3D {
 #pragma region CubeClass
@@ -441,7 +452,39 @@ Polyhedron CornerClass::asPolyhedron() const {
 #pragma endregion
 
 #pragma region PolyhedronShapeClass
-PolyhedronShapeClass::PolyhedronShapeClass(Polyhedron&& poly) noexcept : poly(std::move(poly)), ShapeClass(poly.getVolume(), poly.getCenterOfMass(), poly.getScalableInertiaAroundCenterOfMass(), CONVEX_POLYHEDRON_CLASS_ID) {}
+/*
+	The hull of at most COLLISION_LOD_VERTEX_COUNT of the vertices, scaled up around its center just enough to enclose all other vertices
+	The error is bounded by how much it had to be scaled, which is small for the round, finely tesselated shapes this is meant for
+*/
+static Polyhedron buildCollisionLOD(const Polyhedron& poly) {
+	if(poly.vertexCount <= COLLISION_LOD_VERTEX_THRESHOLD) return Polyhedron();
+
+	std::vector<Vec3f> vertices;
+	vertices.reserve(poly.vertexCount);
+	for(Vec3f vertex : poly.iterVertices()) {
+		vertices.push_back(vertex);
+	}
+	QuickhullSettings settings;
+	settings.maxVertices = COLLISION_LOD_VERTEX_COUNT;
+	Polyhedron inner = quickhull(vertices.data(), static_cast<int>(vertices.size()), settings);
+	if(inner.vertexCount == 0) return Polyhedron();
+
+	Vec3f center(inner.getCenterOfMass());
+	float scale = 1.0f;
+	for(Triangle triangle : inner.iterTriangles()) {
+		Vec3f normal = inner.getNormalVecOfTriangle(triangle);
+		float centerDistance = (inner.getVertex(triangle.firstIndex) - center) * normal;
+		for(Vec3f vertex : vertices) {
+			scale = std::max(scale, (vertex - center) * normal / centerDistance);
+		}
+	}
+	// margin for the rounding of the scaled vertices
+	scale *= 1.0001f;
+
+	return inner.translated(-center).scaled(scale, scale, scale).translated(center);
+}
+
+PolyhedronShapeClass::PolyhedronShapeClass(Polyhedron&& poly) noexcept : poly(std::move(poly)), collisionLOD(buildCollisionLOD(this->poly)), ShapeClass(poly.getVolume(), poly.getCenterOfMass(), poly.getScalableInertiaAroundCenterOfMass(), CONVEX_POLYHEDRON_CLASS_ID) {}
 
 bool PolyhedronShapeClass::containsPoint(Vec3 point) const {
 	return poly.containsPoint(point);
@@ -450,7 +493,9 @@ double PolyhedronShapeClass::getIntersectionDistance(Vec3 origin, Vec3 direction
 	return poly.getIntersectionDistance(origin, direction);
 }
 BoundingBox PolyhedronShapeClass::getBounds(const Rotation& rotation, const DiagonalMat3& scale) const {
-	return poly.getBounds(Mat3f(rotation.asRotationMatrix() * scale));
+	// the collision LOD encloses poly, so its bounds are slightly larger but much cheaper
+	const Polyhedron* collisionLOD = getCollisionLOD();
+	return (collisionLOD != nullptr ? *collisionLOD : poly).getBounds(Mat3f(rotation.asRotationMatrix() * scale));
 }
 double PolyhedronShapeClass::getScaledMaxRadius(DiagonalMat3 scale) const {
 	return poly.getScaledMaxRadius(scale);
@@ -494,6 +539,340 @@ BoundingBox PolyhedronShapeClassFallback::getBounds(const Rotation& rotation, co
 Vec3f PolyhedronShapeClassFallback::furthestInDirection(const Vec3f& direction) const {
 	return poly.furthestInDirectionFallback(direction);
 }
+
+PolyhedronShapeClassHillClimbing::PolyhedronShapeClassHillClimbing(Polyhedron&& poly) noexcept : PolyhedronShapeClass(std::move(poly)), adjacency(this->poly.computeVertexAdjacency()) {}
+
+Vec3f PolyhedronShapeClassHillClimbing::furthestInDirection(const Vec3f& direction) const {
+	return poly.getVertex(poly.furthestIndexInDirectionHillClimb(direction, adjacency, 0));
+}
+Vec3f PolyhedronShapeClassHillClimbing::furthestInDirectionFrom(const Vec3f& direction, int& searchState) const {
+	searchState = poly.furthestIndexInDirectionHillClimb(direction, adjacency, searchState);
+	return poly.getVertex(searchState);
+}
+#pragma endregion
+
+#pragma region TriangleMeshShapeClass
+// closed if every edge is used once in each direction, a Polyhedron must be closed
+static bool isClosedMesh(const TriangleMesh& mesh) {
+	std::set<std::pair<int, int>> edges;
+	for(Triangle triangle : mesh.iterTriangles()) {
+		std::pair<int, int> triangleEdges[3]{{triangle.firstIndex, triangle.secondIndex}, {triangle.secondIndex, triangle.thirdIndex}, {triangle.thirdIndex, triangle.firstIndex}};
+		for(const std::pair<int, int>& edge : triangleEdges) {
+			if(!edges.insert(edge).second) return false;
+		}
+	}
+	for(const std::pair<int, int>& edge : edges) {
+		if(edges.find(std::pair<int, int>(edge.second, edge.first)) == edges.end()) return false;
+	}
+	return true;
+}
+
+// only a closed mesh has a positive volume, open terrain meshes get the mass properties of their bounding box
+static Polyhedron getMassMesh(const TriangleMesh& mesh) {
+	if(isClosedMesh(mesh)) {
+		double volume = 0.0;
+		for(Triangle triangle : mesh.iterTriangles()) {
+			Vec3 a = mesh.getVertex(triangle.firstIndex);
+			Vec3 b = mesh.getVertex(triangle.secondIndex);
+			Vec3 c = mesh.getVertex(triangle.thirdIndex);
+			volume += a * (b % c);
+		}
+		if(volume > 0.0) {
+			return Polyhedron(mesh);
+		}
+	}
+	return CubeClass::instance.asPolyhedron();
+}
+
+TriangleMeshShapeClass::TriangleMeshShapeClass(TriangleMesh&& mesh) noexcept : TriangleMeshShapeClass(std::move(mesh), getMassMesh(mesh)) {}
+
+TriangleMeshShapeClass::TriangleMeshShapeClass(TriangleMesh&& mesh, const Polyhedron& massMesh) noexcept :
+	ShapeClass(massMesh.getVolume(), massMesh.getCenterOfMass(), massMesh.getScalableInertiaAroundCenterOfMass(), TRIANGLE_MESH_CLASS_ID),
+	mesh(std::move(mesh)),
+	bvh(this->mesh) {}
+
+bool TriangleMeshShapeClass::containsPoint(Vec3 point) const {
+	Vec3 ray(1, 0, 0);
+	double distance;
+	int triangle = bvh.getFirstIntersectedTriangle(mesh, point, ray, distance);
+	return triangle != -1 && mesh.getNormalVecOfTriangle(mesh.getTriangle(triangle)) * Vec3f(ray) >= 0;
+}
+double TriangleMeshShapeClass::getIntersectionDistance(Vec3 origin, Vec3 direction) const {
+	double distance;
+	if(bvh.getFirstIntersectedTriangle(mesh, origin, direction, distance) == -1) {
+		return std::numeric_limits<double>::max();
+	}
+	return distance;
+}
+BoundingBox TriangleMeshShapeClass::getBounds(const Rotation& rotation, const DiagonalMat3& scale) const {
+	return mesh.getBounds(Mat3f(rotation.asRotationMatrix() * scale));
+}
+double TriangleMeshShapeClass::getScaledMaxRadius(DiagonalMat3 scale) const {
+	return mesh.getScaledMaxRadius(scale);
+}
+double TriangleMeshShapeClass::getScaledMaxRadiusSq(DiagonalMat3 scale) const {
+	return mesh.getScaledMaxRadiusSq(scale);
+}
+Vec3f TriangleMeshShapeClass::furthestInDirection(const Vec3f& direction) const {
+	return mesh.furthestInDirection(direction);
+}
+Polyhedron TriangleMeshShapeClass::asPolyhedron() const {
+	return Polyhedron(mesh);
+}
+#pragma endregion
+
+#pragma region HeightfieldShapeClass
+HeightfieldShapeClass::HeightfieldShapeClass(int sampleCountX, int sampleCountZ, const float* heights, bool quantize) :
+	ShapeClass(CubeClass::instance.volume, CubeClass::instance.centerOfMass, CubeClass::instance.inertia, HEIGHTFIELD_CLASS_ID),
+	sampleCountX(sampleCountX),
+	sampleCountZ(sampleCountZ),
+	tileCountX((sampleCountX - 2) / TILE_SIZE + 1),
+	tileCountZ((sampleCountZ - 2) / TILE_SIZE + 1) {
+	assert(sampleCountX >= 2 && sampleCountZ >= 2);
+
+	int sampleCount = sampleCountX * sampleCountZ;
+	if(quantize) {
+		this->quantizedHeights.resize(sampleCount);
+		for(int i = 0; i < sampleCount; i++) {
+			float normalized = std::clamp((heights[i] + 1.0f) * 0.5f, 0.0f, 1.0f);
+			this->quantizedHeights[i] = static_cast<std::uint16_t>(std::lround(normalized * 65535.0f));
+		}
+	} else {
+		this->heights.assign(heights, heights + sampleCount);
+	}
+
+	// computed from the stored heights, so quantization can never make the surface stick out of its tile
+	this->tileMaxHeights.resize(tileCountX * tileCountZ);
+	for(int tileX = 0; tileX < tileCountX; tileX++) {
+		for(int tileZ = 0; tileZ < tileCountZ; tileZ++) {
+			float maxHeight = -std::numeric_limits<float>::infinity();
+			for(int x = tileX * TILE_SIZE; x <= getLastCellOfTile(tileX, sampleCountX) + 1; x++) {
+				for(int z = tileZ * TILE_SIZE; z <= getLastCellOfTile(tileZ, sampleCountZ) + 1; z++) {
+					maxHeight = std::max(maxHeight, getHeight(x, z));
+				}
+			}
+			this->tileMaxHeights[tileX * tileCountZ + tileZ] = maxHeight;
+		}
+	}
+	this->maxHeight = *std::max_element(tileMaxHeights.begin(), tileMaxHeights.end());
+
+	std::vector<Vec3f> points;
+	points.reserve(sampleCount + 4);
+	for(int x = 0; x < sampleCountX; x++) {
+		for(int z = 0; z < sampleCountZ; z++) {
+			points.push_back(getSample(x, z));
+		}
+	}
+	Vec3f bottomCorners[4]{Vec3f(-1.0f, -1.0f, -1.0f), Vec3f(-1.0f, -1.0f, 1.0f), Vec3f(1.0f, -1.0f, -1.0f), Vec3f(1.0f, -1.0f, 1.0f)};
+	points.insert(points.end(), bottomCorners, bottomCorners + 4);
+	Polyhedron hull = quickhull(points.data(), static_cast<int>(points.size()));
+	if(hull.vertexCount != 0) {
+		for(Vec3f vertex : hull.iterVertices()) {
+			this->hullVertices.push_back(vertex);
+		}
+	} else {
+		// every sample lies at the bottom, the corners span the flat solid
+		this->hullVertices.assign(bottomCorners, bottomCorners + 4);
+	}
+}
+
+float HeightfieldShapeClass::getSurfaceHeight(float x, float z) const {
+	int cellX = getCellIndex(x, sampleCountX);
+	int cellZ = getCellIndex(z, sampleCountZ);
+	float fx = std::clamp((x - getSampleX(cellX)) * 0.5f * (sampleCountX - 1), 0.0f, 1.0f);
+	float fz = std::clamp((z - getSampleZ(cellZ)) * 0.5f * (sampleCountZ - 1), 0.0f, 1.0f);
+
+	float h00 = getHeight(cellX, cellZ);
+	float h10 = getHeight(cellX + 1, cellZ);
+	float h01 = getHeight(cellX, cellZ + 1);
+	float h11 = getHeight(cellX + 1, cellZ + 1);
+	// same split along the diagonal as forEachTriangleInBounds
+	if(fz >= fx) {
+		return h00 + (h11 - h01) * fx + (h01 - h00) * fz;
+	} else {
+		return h00 + (h10 - h00) * fx + (h11 - h10) * fz;
+	}
+}
+
+bool HeightfieldShapeClass::containsPoint(Vec3 point) const {
+	if(std::abs(point.x) > 1.0 || std::abs(point.z) > 1.0 || point.y < -1.0) return false;
+	return point.y <= getSurfaceHeight(static_cast<float>(point.x), static_cast<float>(point.z));
+}
+
+/*
+	Walks the cells of a grid that the ray crosses between tStart and tEnd in order, starting in cell (x, z)
+	edgeX(i) and edgeZ(i) give the lower edge of the cells with index i, leaving minX..maxX or minZ..maxZ ends the walk
+	func(x, z, tCellEnter, tCellExit) returns true to stop the walk, walkGrid then returns true as well
+*/
+template<typename EdgeX, typename EdgeZ, typename Func>
+static bool walkGrid(Vec3 origin, Vec3 direction, double tStart, double tEnd, int x, int z, int minX, int maxX, int minZ, int maxZ, const EdgeX& edgeX, const EdgeZ& edgeZ, const Func& func) {
+	int stepX = direction.x > 0.0 ? 1 : -1;
+	int stepZ = direction.z > 0.0 ? 1 : -1;
+	double tNextX = direction.x != 0.0 ? (edgeX(stepX > 0 ? x + 1 : x) - origin.x) / direction.x : std::numeric_limits<double>::infinity();
+	double tNextZ = direction.z != 0.0 ? (edgeZ(stepZ > 0 ? z + 1 : z) - origin.z) / direction.z : std::numeric_limits<double>::infinity();
+
+	double t = tStart;
+	while(true) {
+		double tCellExit = std::min(std::min(tNextX, tNextZ), tEnd);
+		if(func(x, z, t, tCellExit)) return true;
+		if(tCellExit >= tEnd) return false;
+
+		if(tNextX < tNextZ) {
+			x += stepX;
+			if(x < minX || x > maxX) return false;
+			t = tNextX;
+			tNextX = (edgeX(stepX > 0 ? x + 1 : x) - origin.x) / direction.x;
+		} else {
+			z += stepZ;
+			if(z < minZ || z > maxZ) return false;
+			t = tNextZ;
+			tNextZ = (edgeZ(stepZ > 0 ? z + 1 : z) - origin.z) / direction.z;
+		}
+	}
+}
+
+/*
+	A ray entering the solid through its sides or bottom hits it right where it enters
+	Otherwise the ray walks the tiles under it in order, skipping those it passes entirely above, and walks the cells of the others
+	The first cell with a hit holds the closest hit. A ray starting inside the solid only hits the surface
+*/
+double HeightfieldShapeClass::getIntersectionDistance(Vec3 origin, Vec3 direction) const {
+	const double NO_HIT = std::numeric_limits<double>::max();
+
+	Vec3 boundsMin(-1.0, -1.0, -1.0);
+	Vec3 boundsMax(1.0, maxHeight, 1.0);
+	double tEnter = 0.0;
+	double tExit = std::numeric_limits<double>::infinity();
+	for(int axis = 0; axis < 3; axis++) {
+		if(direction[axis] == 0.0) {
+			if(origin[axis] < boundsMin[axis] || origin[axis] > boundsMax[axis]) return NO_HIT;
+		} else {
+			double t0 = (boundsMin[axis] - origin[axis]) / direction[axis];
+			double t1 = (boundsMax[axis] - origin[axis]) / direction[axis];
+			tEnter = std::max(tEnter, std::min(t0, t1));
+			tExit = std::min(tExit, std::max(t0, t1));
+		}
+	}
+	if(tEnter > tExit) return NO_HIT;
+
+	Vec3 entry = origin + direction * tEnter;
+	if(tEnter > 0.0 && entry.y <= getSurfaceHeight(static_cast<float>(entry.x), static_cast<float>(entry.z))) return tEnter;
+
+	auto tileEdgeX = [this](int tileX) { return static_cast<double>(getSampleX(std::min(tileX * TILE_SIZE, sampleCountX - 1))); };
+	auto tileEdgeZ = [this](int tileZ) { return static_cast<double>(getSampleZ(std::min(tileZ * TILE_SIZE, sampleCountZ - 1))); };
+	auto cellEdgeX = [this](int x) { return static_cast<double>(getSampleX(x)); };
+	auto cellEdgeZ = [this](int z) { return static_cast<double>(getSampleZ(z)); };
+
+	double best = NO_HIT;
+	auto testCell = [&](int x, int z, double tCellEnter, double tCellExit) {
+		Vec3 s00 = getSample(x, z);
+		Vec3 s10 = getSample(x + 1, z);
+		Vec3 s01 = getSample(x, z + 1);
+		Vec3 s11 = getSample(x + 1, z + 1);
+		double lowestRayHeight = std::min(origin.y + direction.y * tCellEnter, origin.y + direction.y * tCellExit);
+		if(lowestRayHeight > std::max(std::max(s00.y, s10.y), std::max(s01.y, s11.y))) return false;
+
+		RayIntersection<double> first = rayTriangleIntersection(origin, direction, s00, s01, s11);
+		if(first.rayIntersectsTriangle()) best = std::min(best, first.d);
+		RayIntersection<double> second = rayTriangleIntersection(origin, direction, s00, s11, s10);
+		if(second.rayIntersectsTriangle()) best = std::min(best, second.d);
+		return best != NO_HIT;
+	};
+	auto testTile = [&](int tileX, int tileZ, double tTileEnter, double tTileExit) {
+		double lowestRayHeight = std::min(origin.y + direction.y * tTileEnter, origin.y + direction.y * tTileExit);
+		if(lowestRayHeight > tileMaxHeights[tileX * tileCountZ + tileZ]) return false;
+
+		int lastX = getLastCellOfTile(tileX, sampleCountX);
+		int lastZ = getLastCellOfTile(tileZ, sampleCountZ);
+		Vec3 tileEntry = origin + direction * tTileEnter;
+		int x = std::clamp(getCellIndex(static_cast<float>(tileEntry.x), sampleCountX), tileX * TILE_SIZE, lastX);
+		int z = std::clamp(getCellIndex(static_cast<float>(tileEntry.z), sampleCountZ), tileZ * TILE_SIZE, lastZ);
+		return walkGrid(origin, direction, tTileEnter, tTileExit, x, z, tileX * TILE_SIZE, lastX, tileZ * TILE_SIZE, lastZ, cellEdgeX, cellEdgeZ, testCell);
+	};
+
+	int tileX = getCellIndex(static_cast<float>(entry.x), sampleCountX) / TILE_SIZE;
+	int tileZ = getCellIndex(static_cast<float>(entry.z), sampleCountZ) / TILE_SIZE;
+	walkGrid(origin, direction, tEnter, tExit, tileX, tileZ, 0, tileCountX - 1, 0, tileCountZ - 1, tileEdgeX, tileEdgeZ, testTile);
+	return best;
+}
+
+BoundingBox HeightfieldShapeClass::getBounds(const Rotation& rotation, const DiagonalMat3& scale) const {
+	Mat3 transform = rotation.asRotationMatrix() * scale;
+
+	double inf = std::numeric_limits<double>::infinity();
+	BoundingBox result(inf, inf, inf, -inf, -inf, -inf);
+	for(Vec3f vertex : hullVertices) {
+		result = result.expanded(transform * Vec3(vertex));
+	}
+	return result;
+}
+
+double HeightfieldShapeClass::getScaledMaxRadiusSq(DiagonalMat3 scale) const {
+	double bestDistSq = 0.0;
+	for(Vec3f vertex : hullVertices) {
+		bestDistSq = std::max(bestDistSq, lengthSquared(scale * Vec3(vertex)));
+	}
+	return bestDistSq;
+}
+
+Vec3f HeightfieldShapeClass::furthestInDirection(const Vec3f& direction) const {
+	Vec3f best = hullVertices[0];
+	float bestDot = best * direction;
+	for(std::size_t i = 1; i < hullVertices.size(); i++) {
+		float dot = hullVertices[i] * direction;
+		if(dot > bestDot) {
+			best = hullVertices[i];
+			bestDot = dot;
+		}
+	}
+	return best;
+}
+
+/*
+	The closed solid: the surface, a wall under every edge of the grid down to y=-1 and a bottom fanned out from its center
+	The walls have a vertex under every sample on the edge, so they follow the surface exactly
+*/
+Polyhedron HeightfieldShapeClass::asPolyhedron() const {
+	// the samples around the edge of the grid, in order
+	std::vector<int> ring;
+	for(int x = 0; x < sampleCountX - 1; x++) ring.push_back(x * sampleCountZ);
+	for(int z = 0; z < sampleCountZ - 1; z++) ring.push_back((sampleCountX - 1) * sampleCountZ + z);
+	for(int x = sampleCountX - 1; x > 0; x--) ring.push_back(x * sampleCountZ + sampleCountZ - 1);
+	for(int z = sampleCountZ - 1; z > 0; z--) ring.push_back(z);
+
+	int surfaceVertexCount = sampleCountX * sampleCountZ;
+	int ringSize = static_cast<int>(ring.size());
+	int bottomCenter = surfaceVertexCount + ringSize;
+	int surfaceTriangleCount = (sampleCountX - 1) * (sampleCountZ - 1) * 2;
+	EditableMesh mesh(surfaceVertexCount + ringSize + 1, surfaceTriangleCount + ringSize * 3);
+	for(int x = 0; x < sampleCountX; x++) {
+		for(int z = 0; z < sampleCountZ; z++) {
+			mesh.setVertex(x * sampleCountZ + z, getSample(x, z));
+		}
+	}
+	for(int x = 0; x < sampleCountX - 1; x++) {
+		for(int z = 0; z < sampleCountZ - 1; z++) {
+			int corner = x * sampleCountZ + z;
+			int triangle = (x * (sampleCountZ - 1) + z) * 2;
+			mesh.setTriangle(triangle, corner, corner + 1, corner + sampleCountZ + 1);
+			mesh.setTriangle(triangle + 1, corner, corner + sampleCountZ + 1, corner + sampleCountZ);
+		}
+	}
+
+	for(int i = 0; i < ringSize; i++) {
+		Vec3f top = mesh.getVertex(ring[i]);
+		mesh.setVertex(surfaceVertexCount + i, top.x, -1.0f, top.z);
+	}
+	mesh.setVertex(bottomCenter, 0.0f, -1.0f, 0.0f);
+	for(int i = 0; i < ringSize; i++) {
+		int next = (i + 1) % ringSize;
+		int triangle = surfaceTriangleCount + i * 3;
+		mesh.setTriangle(triangle, ring[i], surfaceVertexCount + next, surfaceVertexCount + i);
+		mesh.setTriangle(triangle + 1, ring[i], ring[next], surfaceVertexCount + next);
+		mesh.setTriangle(triangle + 2, bottomCenter, surfaceVertexCount + i, surfaceVertexCount + next);
+	}
+	return Polyhedron(std::move(mesh));
+}
 #pragma endregion
 
 const CubeClass CubeClass::instance;
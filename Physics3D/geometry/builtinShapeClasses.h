@@ -2,6 +2,12 @@
 
 #include "polyhedron.h"
 #include "shapeClass.h"
+#include "triangleBVH.h"
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
 
 namespace P3D {
 #define CUBE_CLASS_ID 0
@@ -10,6 +16,8 @@ namespace P3D {
 #define WEDGE_CLASS_ID 3
 #define CORNER_CLASS_ID 4
 #define CONVEX_POLYHEDRON_CLASS_ID 10
+#define TRIANGLE_MESH_CLASS_ID 11
+#define HEIGHTFIELD_CLASS_ID 12
 
 
 class CubeClass : public ShapeClass {
@@ -92,9 +100,17 @@ public:
 class PolyhedronShapeClass : public ShapeClass {
 protected:
 	Polyhedron poly;
+	// empty for polyhedra with few vertices
+	Polyhedron collisionLOD;
 public:
 	PolyhedronShapeClass(Polyhedron&& poly) noexcept;
 
+	/*
+		A hull with far fewer vertices that encloses this polyhedron, or nullptr if the polyhedron has few vertices itself
+		Collision tests reject shapes that don't touch it before testing the full polyhedron, and getBounds uses it
+	*/
+	inline const Polyhedron* getCollisionLOD() const { return collisionLOD.vertexCount != 0 ? &collisionLOD : nullptr; }
+
 	virtual bool containsPoint(Vec3 point) const override;
 	virtual double getIntersectionDistance(Vec3 origin, Vec3 direction) const override;
 	virtual BoundingBox getBounds(const Rotation& rotation, const DiagonalMat3& scale) const override;
@@ -135,4 +151,137 @@ public:
 	virtual BoundingBox getBounds(const Rotation& rotation, const DiagonalMat3& scale) const override;
 	virtual Vec3f furthestInDirection(const Vec3f& direction) const override;
 };
-};
\ No newline at end of file
+
+/*
+	For large convex polyhedra, finds support points by walking the vertex graph instead of scanning every vertex
+	Within a GJK run each walk starts at the previous result, consecutive queries use similar directions so this usually takes only a few steps
+*/
+class PolyhedronShapeClassHillClimbing : public PolyhedronShapeClass {
+	VertexAdjacency adjacency;
+public:
+	PolyhedronShapeClassHillClimbing(Polyhedron&& poly) noexcept;
+
+	virtual Vec3f furthestInDirection(const Vec3f& direction) const override;
+	// searchState is the index of the vertex the previous query ended at
+	virtual Vec3f furthestInDirectionFrom(const Vec3f& direction, int& searchState) const override;
+};
+
+/*
+	Concave shape made of arbitrary triangles, meant for static terrain such as building interiors and terrain meshes
+	Collisions test the other shape only against the triangles near it, found through an internal TriangleBVH, see intersectsTransformed
+	furthestInDirection describes the convex hull of the mesh, open meshes get the mass properties of their bounding box
+*/
+class TriangleMeshShapeClass : public ShapeClass {
+	TriangleMesh mesh;
+	TriangleBVH bvh;
+
+	TriangleMeshShapeClass(TriangleMesh&& mesh, const Polyhedron& massMesh) noexcept;
+public:
+	TriangleMeshShapeClass(TriangleMesh&& mesh) noexcept;
+
+	virtual bool containsPoint(Vec3 point) const override;
+	virtual double getIntersectionDistance(Vec3 origin, Vec3 direction) const override;
+	virtual BoundingBox getBounds(const Rotation& rotation, const DiagonalMat3& scale) const override;
+	virtual double getScaledMaxRadius(DiagonalMat3 scale) const override;
+	virtual double getScaledMaxRadiusSq(DiagonalMat3 scale) const override;
+	virtual Vec3f furthestInDirection(const Vec3f& direction) const override;
+	virtual Polyhedron asPolyhedron() const override;
+
+	inline const TriangleMesh& getMesh() const { return mesh; }
+	inline const TriangleBVH& getBVH() const { return bvh; }
+};
+
+/*
+	Static terrain given as a grid of height samples spread evenly over -1..1 along x and z, heights are within -1..1 too
+	The shape is solid from y=-1 up to the surface through the samples, every cell of the grid is split in two triangles
+	Heights can be stored quantized to 16 bits
+	The highest sample of every tile of TILE_SIZE x TILE_SIZE cells is kept, so triangle queries and ray casts skip tiles that lie below them whole
+	The vertices of the convex hull of the solid are kept as well, bounds, radius and support queries only look at those
+	Like open TriangleMeshShapeClass meshes, it gets the mass properties of its bounding box
+*/
+class HeightfieldShapeClass : public ShapeClass {
+public:
+	static constexpr int TILE_SIZE = 16;
+
+private:
+	int sampleCountX;
+	int sampleCountZ;
+	std::vector<float> heights;
+	std::vector<std::uint16_t> quantizedHeights;
+
+	int tileCountX;
+	int tileCountZ;
+	std::vector<float> tileMaxHeights;
+	float maxHeight;
+	// the samples and bottom corners on the convex hull of the solid
+	std::vector<Vec3f> hullVertices;
+
+	inline float getSampleX(int x) const { return -1.0f + 2.0f * x / (sampleCountX - 1); }
+	inline float getSampleZ(int z) const { return -1.0f + 2.0f * z / (sampleCountZ - 1); }
+	// the cell containing the given coordinate, clamped to the grid
+	static inline int getCellIndex(float coordinate, int sampleCount) {
+		int index = static_cast<int>(std::floor((coordinate + 1.0f) * 0.5f * (sampleCount - 1)));
+		return std::clamp(index, 0, sampleCount - 2);
+	}
+	// the last cell of the tile along an axis with the given number of samples
+	static inline int getLastCellOfTile(int tile, int sampleCount) {
+		return std::min(tile * TILE_SIZE + TILE_SIZE - 1, sampleCount - 2);
+	}
+
+public:
+	// heights[x * sampleCountZ + z] is the height of sample (x, z), both sample counts must be at least 2
+	HeightfieldShapeClass(int sampleCountX, int sampleCountZ, const float* heights, bool quantize);
+
+	inline int getSampleCountX() const { return sampleCountX; }
+	inline int getSampleCountZ() const { return sampleCountZ; }
+	inline bool isQuantized() const { return !quantizedHeights.empty(); }
+	inline float getHeight(int x, int z) const {
+		if(quantizedHeights.empty()) {
+			return heights[x * sampleCountZ + z];
+		} else {
+			return quantizedHeights[x * sampleCountZ + z] * (2.0f / 65535.0f) - 1.0f;
+		}
+	}
+	inline Vec3f getSample(int x, int z) const { return Vec3f(getSampleX(x), getHeight(x, z), getSampleZ(z)); }
+	// height of the surface above the given point, x and z are clamped to the grid
+	float getSurfaceHeight(float x, float z) const;
+
+	// calls func(a, b, c) for both triangles of every cell under the given bounds that reaches up into them
+	template<typename Func>
+	void forEachTriangleInBounds(const BoundingBoxTemplate<float>& bounds, const Func& func) const {
+		if(bounds.max.x < -1.0f || bounds.min.x > 1.0f || bounds.max.z < -1.0f || bounds.min.z > 1.0f || bounds.max.y < -1.0f || bounds.min.y > maxHeight) return;
+
+		int minX = getCellIndex(bounds.min.x, sampleCountX);
+		int maxX = getCellIndex(bounds.max.x, sampleCountX);
+		int minZ = getCellIndex(bounds.min.z, sampleCountZ);
+		int maxZ = getCellIndex(bounds.max.z, sampleCountZ);
+		for(int tileX = minX / TILE_SIZE; tileX <= maxX / TILE_SIZE; tileX++) {
+			for(int tileZ = minZ / TILE_SIZE; tileZ <= maxZ / TILE_SIZE; tileZ++) {
+				if(tileMaxHeights[tileX * tileCountZ + tileZ] < bounds.min.y) continue;
+
+				int lastX = std::min(maxX, getLastCellOfTile(tileX, sampleCountX));
+				int lastZ = std::min(maxZ, getLastCellOfTile(tileZ, sampleCountZ));
+				for(int x = std::max(minX, tileX * TILE_SIZE); x <= lastX; x++) {
+					for(int z = std::max(minZ, tileZ * TILE_SIZE); z <= lastZ; z++) {
+						Vec3f s00 = getSample(x, z);
+						Vec3f s10 = getSample(x + 1, z);
+						Vec3f s01 = getSample(x, z + 1);
+						Vec3f s11 = getSample(x + 1, z + 1);
+						if(std::max(std::max(s00.y, s10.y), std::max(s01.y, s11.y)) < bounds.min.y) continue;
+
+						func(s00, s01, s11);
+						func(s00, s11, s10);
+					}
+				}
+			}
+		}
+	}
+
+	virtual bool containsPoint(Vec3 point) const override;
+	virtual double getIntersectionDistance(Vec3 origin, Vec3 direction) const override;
+	virtual BoundingBox getBounds(const Rotation& rotation, const DiagonalMat3& scale) const override;
+	virtual double getScaledMaxRadiusSq(DiagonalMat3 scale) const override;
+	virtual Vec3f furthestInDirection(const Vec3f& direction) const override;
+	virtual Polyhedron asPolyhedron() const override;
+};
+};
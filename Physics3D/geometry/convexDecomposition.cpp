@@ -0,0 +1,258 @@
+#include "convexDecomposition.h"
+
+#include "triangleMesh.h"
+#include "quickhull.h"
+#include "shapeCreation.h"
+#include "../math/utils.h"
+#include "../part.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// number of cutting planes tried along every axis when splitting a piece
+#define SPLIT_CANDIDATES_PER_AXIS 8
+
+namespace P3D {
+struct VoxelGrid {
+	int sizeX;
+	int sizeY;
+	int sizeZ;
+	std::vector<bool> inside;
+
+	inline int indexOf(int x, int y, int z) const { return (x * sizeY + y) * sizeZ + z; }
+	inline void coordsOf(int index, int& x, int& y, int& z) const {
+		z = index % sizeZ;
+		y = (index / sizeZ) % sizeY;
+		x = index / (sizeY * sizeZ);
+	}
+};
+
+struct VoxelPiece {
+	std::vector<int> voxels;
+	double hullVolume;
+	// hull volume not covered by voxels
+	double wastedVolume;
+};
+
+/*
+	Fills every voxel whose center is inside the mesh, by counting the surface crossings of a ray along x through every row
+	The voxels are stretched slightly per axis so they tile the bounds exactly
+	The rows are offset from the voxel centers by different amounts in y and z, so they don't run exactly through the edges or face diagonals of axis aligned meshes
+*/
+static VoxelGrid voxelize(const TriangleMesh& mesh, const BoundingBox& bounds, double maxVoxelSize, Vec3& voxelSize) {
+	VoxelGrid grid;
+	grid.sizeX = std::max(1, static_cast<int>(std::ceil(bounds.getWidth() / maxVoxelSize - 0.001)));
+	grid.sizeY = std::max(1, static_cast<int>(std::ceil(bounds.getHeight() / maxVoxelSize - 0.001)));
+	grid.sizeZ = std::max(1, static_cast<int>(std::ceil(bounds.getDepth() / maxVoxelSize - 0.001)));
+	grid.inside.resize(grid.sizeX * grid.sizeY * grid.sizeZ, false);
+	voxelSize = Vec3(
+		std::max(bounds.getWidth(), maxVoxelSize) / grid.sizeX,
+		std::max(bounds.getHeight(), maxVoxelSize) / grid.sizeY,
+		std::max(bounds.getDepth(), maxVoxelSize) / grid.sizeZ
+	);
+
+	std::vector<double> crossings;
+	for(int y = 0; y < grid.sizeY; y++) {
+		for(int z = 0; z < grid.sizeZ; z++) {
+			Vec3 origin(bounds.min.x - voxelSize.x, bounds.min.y + (y + 0.5013) * voxelSize.y, bounds.min.z + (z + 0.5031) * voxelSize.z);
+			Vec3 ray(1.0, 0.0, 0.0);
+
+			crossings.clear();
+			for(Triangle triangle : mesh.iterTriangles()) {
+				RayIntersection<double> intersection = rayTriangleIntersection<double>(origin, ray, Vec3(mesh.getVertex(triangle.firstIndex)), Vec3(mesh.getVertex(triangle.secondIndex)), Vec3(mesh.getVertex(triangle.thirdIndex)));
+				if(intersection.lineIntersectsTriangle() && std::isfinite(intersection.d)) {
+					crossings.push_back(origin.x + intersection.d);
+				}
+			}
+			std::sort(crossings.begin(), crossings.end());
+
+			std::size_t passed = 0;
+			for(int x = 0; x < grid.sizeX; x++) {
+				double center = bounds.min.x + (x + 0.5) * voxelSize.x;
+				while(passed < crossings.size() && crossings[passed] < center) passed++;
+				grid.inside[grid.indexOf(x, y, z)] = passed % 2 == 1;
+			}
+		}
+	}
+	return grid;
+}
+
+/*
+	The hull of a set of voxels only depends on the outermost voxels of every row along x
+	so only the corners of those are given to the hull builder
+*/
+static std::vector<Vec3f> getHullPoints(const VoxelGrid& grid, const std::vector<int>& voxels) {
+	std::vector<int> rowMin(grid.sizeY * grid.sizeZ, std::numeric_limits<int>::max());
+	std::vector<int> rowMax(grid.sizeY * grid.sizeZ, -1);
+	for(int voxel : voxels) {
+		int x, y, z;
+		grid.coordsOf(voxel, x, y, z);
+		int row = y * grid.sizeZ + z;
+		rowMin[row] = std::min(rowMin[row], x);
+		rowMax[row] = std::max(rowMax[row], x);
+	}
+
+	std::vector<Vec3f> points;
+	for(int y = 0; y < grid.sizeY; y++) {
+		for(int z = 0; z < grid.sizeZ; z++) {
+			int row = y * grid.sizeZ + z;
+			if(rowMax[row] == -1) continue;
+			for(float x : {static_cast<float>(rowMin[row]), static_cast<float>(rowMax[row] + 1)}) {
+				points.emplace_back(x, static_cast<float>(y), static_cast<float>(z));
+				points.emplace_back(x, static_cast<float>(y + 1), static_cast<float>(z));
+				points.emplace_back(x, static_cast<float>(y), static_cast<float>(z + 1));
+				points.emplace_back(x, static_cast<float>(y + 1), static_cast<float>(z + 1));
+			}
+		}
+	}
+	return points;
+}
+
+// hulls of voxel corners are built in integer voxel coordinates, so coplanar corners are recognized exactly
+static Polyhedron hullOfVoxels(const VoxelGrid& grid, const std::vector<int>& voxels, int maxVertices) {
+	std::vector<Vec3f> points = getHullPoints(grid, voxels);
+	QuickhullSettings settings;
+	settings.maxVertices = maxVertices;
+	return quickhull(points.data(), static_cast<int>(points.size()), settings);
+}
+
+static VoxelPiece makePiece(const VoxelGrid& grid, std::vector<int>&& voxels) {
+	VoxelPiece result;
+	result.voxels = std::move(voxels);
+	Polyhedron hull = hullOfVoxels(grid, result.voxels, 0);
+	if(hull.vertexCount != 0) {
+		result.hullVolume = hull.getVolume();
+	} else {
+		result.hullVolume = static_cast<double>(result.voxels.size());
+	}
+	result.wastedVolume = std::max(0.0, result.hullVolume - static_cast<double>(result.voxels.size()));
+	return result;
+}
+
+// returns false if the piece is a single voxel thick along every axis
+static bool splitPiece(const VoxelGrid& grid, const VoxelPiece& piece, VoxelPiece& first, VoxelPiece& second) {
+	int minCoords[3]{std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::max()};
+	int maxCoords[3]{-1, -1, -1};
+	for(int voxel : piece.voxels) {
+		int coords[3];
+		grid.coordsOf(voxel, coords[0], coords[1], coords[2]);
+		for(int axis = 0; axis < 3; axis++) {
+			minCoords[axis] = std::min(minCoords[axis], coords[axis]);
+			maxCoords[axis] = std::max(maxCoords[axis], coords[axis]);
+		}
+	}
+
+	double bestCost = std::numeric_limits<double>::infinity();
+	bool found = false;
+	for(int axis = 0; axis < 3; axis++) {
+		int extent = maxCoords[axis] - minCoords[axis] + 1;
+		if(extent < 2) continue;
+		int step = std::max(1, extent / SPLIT_CANDIDATES_PER_AXIS);
+		for(int plane = minCoords[axis] + step; plane <= maxCoords[axis]; plane += step) {
+			std::vector<int> below;
+			std::vector<int> above;
+			for(int voxel : piece.voxels) {
+				int coords[3];
+				grid.coordsOf(voxel, coords[0], coords[1], coords[2]);
+				(coords[axis] < plane ? below : above).push_back(voxel);
+			}
+			if(below.empty() || above.empty()) continue;
+
+			VoxelPiece belowPiece = makePiece(grid, std::move(below));
+			VoxelPiece abovePiece = makePiece(grid, std::move(above));
+			double cost = belowPiece.wastedVolume + abovePiece.wastedVolume;
+			if(cost < bestCost) {
+				bestCost = cost;
+				first = std::move(belowPiece);
+				second = std::move(abovePiece);
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+static Polyhedron hullOfMeshVertices(const TriangleMesh& mesh, int maxVertices) {
+	std::vector<Vec3f> points;
+	for(Vec3f vertex : mesh.iterVertices()) {
+		points.push_back(vertex);
+	}
+	QuickhullSettings quickhullSettings;
+	quickhullSettings.maxVertices = maxVertices;
+	return quickhull(points.data(), static_cast<int>(points.size()), quickhullSettings);
+}
+
+std::vector<Polyhedron> decomposeConvex(const TriangleMesh& mesh, const ConvexDecompositionSettings& settings) {
+	std::vector<Polyhedron> result;
+	if(mesh.triangleCount == 0) return result;
+
+	BoundingBox bounds = mesh.getBounds();
+	double longestSide = std::max(bounds.getWidth(), std::max(bounds.getHeight(), bounds.getDepth()));
+	Vec3 voxelSize;
+	VoxelGrid grid = voxelize(mesh, bounds, longestSide / std::clamp(settings.resolution, 1, 200), voxelSize);
+
+	std::vector<int> allVoxels;
+	for(int i = 0; i < static_cast<int>(grid.inside.size()); i++) {
+		if(grid.inside[i]) allVoxels.push_back(i);
+	}
+	if(allVoxels.empty()) {
+		// open or paper thin meshes have no inside, the best we can do is their hull
+		result.push_back(hullOfMeshVertices(mesh, settings.maxVerticesPerHull));
+		return result;
+	}
+
+	double totalVolume = static_cast<double>(allVoxels.size());
+	std::vector<VoxelPiece> pieces;
+	std::vector<bool> canSplit;
+	pieces.push_back(makePiece(grid, std::move(allVoxels)));
+	canSplit.push_back(true);
+
+	while(static_cast<int>(pieces.size()) < settings.maxHullCount) {
+		int worst = -1;
+		for(int i = 0; i < static_cast<int>(pieces.size()); i++) {
+			if(canSplit[i] && (worst == -1 || pieces[i].wastedVolume > pieces[worst].wastedVolume)) worst = i;
+		}
+		if(worst == -1 || pieces[worst].wastedVolume <= settings.maxConcavity * totalVolume) break;
+
+		VoxelPiece first;
+		VoxelPiece second;
+		if(!splitPiece(grid, pieces[worst], first, second)) {
+			canSplit[worst] = false;
+			continue;
+		}
+		pieces[worst] = std::move(first);
+		pieces.push_back(std::move(second));
+		canSplit.push_back(true);
+	}
+
+	Vec3f origin(bounds.min);
+	for(const VoxelPiece& piece : pieces) {
+		Polyhedron hull = hullOfVoxels(grid, piece.voxels, settings.maxVerticesPerHull);
+		if(hull.vertexCount == 0) continue;
+		result.push_back(hull.scaled(static_cast<float>(voxelSize.x), static_cast<float>(voxelSize.y), static_cast<float>(voxelSize.z)).translated(origin));
+	}
+	return result;
+}
+
+ConvexPieces toConvexPieces(const std::vector<Polyhedron>& hulls) {
+	ConvexPieces result;
+	for(const Polyhedron& hull : hulls) {
+		result.shapes.push_back(polyhedronShape(hull));
+		result.offsets.push_back(hull.getBounds().getCenter());
+	}
+	return result;
+}
+
+std::vector<Part*> createConvexParts(const ConvexPieces& pieces, const GlobalCFrame& cframe, const PartProperties& properties) {
+	std::vector<Part*> result;
+	if(pieces.shapes.empty()) return result;
+
+	Part* mainPart = new Part(pieces.shapes[0], cframe.localToGlobal(CFrame(pieces.offsets[0])), properties);
+	result.push_back(mainPart);
+	for(std::size_t i = 1; i < pieces.shapes.size(); i++) {
+		result.push_back(new Part(pieces.shapes[i], *mainPart, CFrame(pieces.offsets[i] - pieces.offsets[0]), properties));
+	}
+	return result;
+}
+};
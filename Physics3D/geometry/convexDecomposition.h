@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "../math/linalg/vec.h"
+#include "../math/globalCFrame.h"
+#include "shape.h"
+#include "polyhedron.h"
+
+namespace P3D {
+class TriangleMesh;
+class Part;
+struct PartProperties;
+
+struct ConvexDecompositionSettings {
+	// number of voxels along the longest side of the mesh, at most 200
+	int resolution = 32;
+	int maxHullCount = 16;
+	int maxVerticesPerHull = 32;
+	// pieces are split until their hull is at most this fraction of the total volume larger than the voxels they cover
+	double maxConcavity = 0.01;
+};
+
+/*
+	Approximates a closed, possibly concave mesh by a few convex hulls, in the coordinates of the mesh
+	The inside of the mesh is voxelized, then the piece whose hull wastes the most volume is repeatedly cut along the best axis aligned plane
+	Meant for loading time, not for every tick
+*/
+std::vector<Polyhedron> decomposeConvex(const TriangleMesh& mesh, const ConvexDecompositionSettings& settings = ConvexDecompositionSettings());
+
+/*
+	The hulls of a decomposition as shapes, centered like polyhedronShape centers them
+	offsets[i] is the position of the center of shapes[i] in the original mesh, createConvexParts makes them into one rigid body
+*/
+struct ConvexPieces {
+	std::vector<Shape> shapes;
+	std::vector<Vec3> offsets;
+};
+
+ConvexPieces toConvexPieces(const std::vector<Polyhedron>& hulls);
+
+/*
+	Makes a part of every piece, every part after the first is attached to the first, so together they are one rigid body
+	The pieces are placed where the original mesh would be with its origin at cframe
+	The caller owns the parts, adding the first to a world adds all of them
+*/
+std::vector<Part*> createConvexParts(const ConvexPieces& pieces, const GlobalCFrame& cframe, const PartProperties& properties);
+};
@@ -5,5 +5,12 @@
 namespace P3D {
 struct GenericCollidable {
 	virtual Vec3f furthestInDirection(const Vec3f& direction) const = 0;
+	/*
+		The same as furthestInDirection, for shapes that search from where their previous query ended
+		The int is the search state, it belongs to the caller and is kept between the queries of a single GJK and EPA run, starting at 0
+	*/
+	virtual Vec3f furthestInDirectionFrom(const Vec3f& direction, int&) const {
+		return furthestInDirection(direction);
+	}
 };
 };
@@ -17,6 +17,8 @@
 
 #define GJK_MAX_ITER 200
 #define EPA_MAX_ITER 200
+// relative tolerance at which the GJK distance query stops refining
+#define GJK_DISTANCE_TOLERANCE 1E-4f
 
 namespace P3D {
 inline static void incDebugTally(HistoricTally<long long, IterationTime>& tally, int iterTime) {
@@ -29,6 +31,10 @@ inline static void incDebugTally(HistoricTally<long long, IterationTime>& tally,
 	}
 }
 
+void tallyGJKIterations(bool collides, int iterTime) {
+	incDebugTally(collides ? GJKCollidesIterationStatistics : GJKNoCollidesIterationStatistics, iterTime);
+}
+
 static Vec3f getNormalVec(Triangle t, Vec3f* vertices) {
 	Vec3f v0 = vertices[t[0]];
 	Vec3f v1 = vertices[t[1]];
@@ -65,9 +71,9 @@ static NearestSurface getNearestSurface(const ConvexShapeBuilder& builder) {
 }
 
 static MinkPoint getSupport(const ColissionPair& info, const Vec3f& searchDirection) {
-	Vec3f furthest1 = info.scaleFirst * info.first.furthestInDirection(info.scaleFirst * searchDirection);  // in local space of first
+	Vec3f furthest1 = info.scaleFirst * info.first.furthestInDirectionFrom(info.scaleFirst * searchDirection, info.searchStateFirst);  // in local space of first
 	Vec3f transformedSearchDirection = -info.transform.relativeToLocal(searchDirection);
-	Vec3f furthest2 = info.scaleSecond * info.second.furthestInDirection(info.scaleSecond * transformedSearchDirection);  // in local space of second
+	Vec3f furthest2 = info.scaleSecond * info.second.furthestInDirectionFrom(info.scaleSecond * transformedSearchDirection, info.searchStateSecond);  // in local space of second
 	Vec3f secondVertex = info.transform.localToGlobal(furthest2);  // converted to local space of first
 
 	/*catchable_assert(isVecValid(furthest1));
@@ -295,4 +301,167 @@ bool runEPATransformed(const ColissionPair& info, const Tetrahedron& s, Vec3f& i
 	incDebugTally(EPAIterationStatistics, EPA_MAX_ITER);
 	return false;
 }
+
+/*
+	===== GJK distance =====
+	The simplex is reduced to the feature closest to the origin after every step,
+	weights holds the barycentric coordinates of that closest point, used to find the witness points on both shapes
+*/
+
+static void setSimplexVertex(MinkPoint* simplex, float* weights, int& count, const MinkPoint& a) {
+	simplex[0] = a;
+	weights[0] = 1.0f;
+	count = 1;
+}
+
+static void setSimplexEdge(MinkPoint* simplex, float* weights, int& count, const MinkPoint& a, const MinkPoint& b, float t) {
+	simplex[0] = a;
+	simplex[1] = b;
+	weights[0] = 1.0f - t;
+	weights[1] = t;
+	count = 2;
+}
+
+// closest point of triangle ABC to the origin, from Ericson's Real-Time Collision Detection
+static void reduceTriangle(MinkPoint* simplex, float* weights, int& count) {
+	MinkPoint A = simplex[0], B = simplex[1], C = simplex[2];
+	Vec3f ab = B.p - A.p;
+	Vec3f ac = C.p - A.p;
+
+	float d1 = -(ab * A.p);
+	float d2 = -(ac * A.p);
+	if(d1 <= 0.0f && d2 <= 0.0f) { setSimplexVertex(simplex, weights, count, A); return; }
+
+	float d3 = -(ab * B.p);
+	float d4 = -(ac * B.p);
+	if(d3 >= 0.0f && d4 <= d3) { setSimplexVertex(simplex, weights, count, B); return; }
+
+	float vc = d1 * d4 - d3 * d2;
+	if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) { setSimplexEdge(simplex, weights, count, A, B, d1 / (d1 - d3)); return; }
+
+	float d5 = -(ab * C.p);
+	float d6 = -(ac * C.p);
+	if(d6 >= 0.0f && d5 <= d6) { setSimplexVertex(simplex, weights, count, C); return; }
+
+	float vb = d5 * d2 - d1 * d6;
+	if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) { setSimplexEdge(simplex, weights, count, A, C, d2 / (d2 - d6)); return; }
+
+	float va = d3 * d6 - d5 * d4;
+	if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) { setSimplexEdge(simplex, weights, count, B, C, (d4 - d3) / ((d4 - d3) + (d5 - d6))); return; }
+
+	float denom = 1.0f / (va + vb + vc);
+	weights[1] = vb * denom;
+	weights[2] = vc * denom;
+	weights[0] = 1.0f - weights[1] - weights[2];
+	count = 3;
+}
+
+static Vec3f getSimplexPoint(const MinkPoint* simplex, const float* weights, int count) {
+	Vec3f result(0.0f, 0.0f, 0.0f);
+	for(int i = 0; i < count; i++) {
+		result += simplex[i].p * weights[i];
+	}
+	return result;
+}
+
+// returns false if the tetrahedron contains the origin
+static bool reduceTetrahedron(MinkPoint* simplex, float* weights, int& count) {
+	static const int faces[4][4]{{0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 3, 1}, {1, 2, 3, 0}};
+
+	bool foundOutsideFace = false;
+	float bestDistSq = 0.0f;
+	MinkPoint bestSimplex[3];
+	float bestWeights[3];
+	int bestCount = 0;
+	for(const int* face : faces) {
+		const Vec3f& a = simplex[face[0]].p;
+		Vec3f normal = (simplex[face[1]].p - a) % (simplex[face[2]].p - a);
+		float originSide = -(normal * a);
+		float oppositeSide = normal * (simplex[face[3]].p - a);
+		if(originSide * oppositeSide > 0.0f) continue; // origin lies on the inside of this face
+
+		MinkPoint faceSimplex[3]{simplex[face[0]], simplex[face[1]], simplex[face[2]]};
+		float faceWeights[3];
+		int faceCount = 3;
+		reduceTriangle(faceSimplex, faceWeights, faceCount);
+		float distSq = lengthSquared(getSimplexPoint(faceSimplex, faceWeights, faceCount));
+		if(!foundOutsideFace || distSq < bestDistSq) {
+			foundOutsideFace = true;
+			bestDistSq = distSq;
+			bestCount = faceCount;
+			for(int i = 0; i < faceCount; i++) {
+				bestSimplex[i] = faceSimplex[i];
+				bestWeights[i] = faceWeights[i];
+			}
+		}
+	}
+	if(!foundOutsideFace) return false;
+
+	count = bestCount;
+	for(int i = 0; i < bestCount; i++) {
+		simplex[i] = bestSimplex[i];
+		weights[i] = bestWeights[i];
+	}
+	return true;
+}
+
+// returns false if the origin lies within the simplex
+static bool reduceSimplex(MinkPoint* simplex, float* weights, int& count) {
+	switch(count) {
+	case 1:
+		weights[0] = 1.0f;
+		return true;
+	case 2: {
+		Vec3f ab = simplex[1].p - simplex[0].p;
+		float abLengthSq = lengthSquared(ab);
+		float t = abLengthSq > 0.0f ? -(simplex[0].p * ab) / abLengthSq : 0.0f;
+		if(t <= 0.0f) {
+			setSimplexVertex(simplex, weights, count, simplex[0]);
+		} else if(t >= 1.0f) {
+			setSimplexVertex(simplex, weights, count, simplex[1]);
+		} else {
+			weights[0] = 1.0f - t;
+			weights[1] = t;
+		}
+		return true;
+	}
+	case 3:
+		reduceTriangle(simplex, weights, count);
+		return true;
+	default:
+		return reduceTetrahedron(simplex, weights, count);
+	}
+}
+
+bool runGJKDistanceTransformed(const ColissionPair& info, Vec3f searchDirection, Vec3f& closestOnFirst, Vec3f& closestOnSecond) {
+	MinkPoint simplex[4];
+	float weights[4];
+	int count = 1;
+	simplex[0] = getSupport(info, searchDirection);
+
+	for(int iter = 0; iter < GJK_MAX_ITER; iter++) {
+		if(!reduceSimplex(simplex, weights, count)) {
+			return false;
+		}
+		Vec3f closest = getSimplexPoint(simplex, weights, count);
+		float closestDistSq = lengthSquared(closest);
+		if(closestDistSq <= GJK_DISTANCE_TOLERANCE * GJK_DISTANCE_TOLERANCE) {
+			return false; // touching or intersecting
+		}
+
+		MinkPoint newPoint = getSupport(info, -closest);
+		if(closestDistSq - closest * newPoint.p <= closestDistSq * GJK_DISTANCE_TOLERANCE) {
+			break; // no more progress towards the origin, closest is the closest point of the minkowski difference
+		}
+		simplex[count++] = newPoint;
+	}
+
+	closestOnFirst = Vec3f(0.0f, 0.0f, 0.0f);
+	closestOnSecond = Vec3f(0.0f, 0.0f, 0.0f);
+	for(int i = 0; i < count; i++) {
+		closestOnFirst += simplex[i].originFirst * weights[i];
+		closestOnSecond += simplex[i].originSecond * weights[i];
+	}
+	return true;
+}
 };
@@ -54,8 +54,15 @@ struct ColissionPair {
 	CFramef transform;
 	DiagonalMat3f scaleFirst;
 	DiagonalMat3f scaleSecond;
+	// the search states of furthestInDirectionFrom, local to this pair so concurrent queries on the same shapes don't share them
+	mutable int searchStateFirst = 0;
+	mutable int searchStateSecond = 0;
 };
 
+// adds a GJK run that ended after iterTime iterations to GJKCollidesIterationStatistics or GJKNoCollidesIterationStatistics, as runGJKTransformed does
+void tallyGJKIterations(bool collides, int iterTime);
 std::optional<Tetrahedron> runGJKTransformed(const ColissionPair& colissionPair, Vec3f initialSearchDirection);
 bool runEPATransformed(const ColissionPair& colissionPair, const Tetrahedron& s, Vec3f& intersection, Vec3f& exitVector, ComputationBuffers& bufs);
+// returns false if the shapes intersect, otherwise closestOnFirst and closestOnSecond are set to the nearest points of both shapes, local to first
+bool runGJKDistanceTransformed(const ColissionPair& colissionPair, Vec3f initialSearchDirection, Vec3f& closestOnFirst, Vec3f& closestOnSecond);
 };
\ No newline at end of file
@@ -10,17 +10,261 @@
 
 #include "../misc/validityHelper.h"
 #include "shapeClass.h"
+#include "builtinShapeClasses.h"
 
 #include "../misc/catchable_assert.h"
 
 #include <algorithm>
+#include <limits>
 
 namespace P3D {
+thread_local ComputationBuffers buffers(1000, 2000);
+
+/*
+	A triangle of a concave shape, extruded against its normal into a prism so that EPA has a volume to work with
+	The thickness must cover the deepest expected penetration, otherwise shapes could be pushed out through the back
+*/
+struct TrianglePrism : public GenericCollidable {
+	Vec3f vertices[6];
+
+	TrianglePrism(Vec3f a, Vec3f b, Vec3f c, Vec3f extrusion) : vertices{a, b, c, a - extrusion, b - extrusion, c - extrusion} {}
+
+	virtual Vec3f furthestInDirection(const Vec3f& direction) const override {
+		int best = 0;
+		float bestDot = vertices[0] * direction;
+		for(int i = 1; i < 6; i++) {
+			float dot = vertices[i] * direction;
+			if(dot > bestDot) {
+				best = i;
+				bestDot = dot;
+			}
+		}
+		return vertices[best];
+	}
+};
+
+/*
+	The bounds of other, grown by margin on every side, in the unscaled space of the concave shape
+	relativeTransform is the transform of other relative to the concave shape
+*/
+static BoundingBoxTemplate<float> getConcaveQueryBounds(const ShapeClass& other, const CFrame& relativeTransform, const DiagonalMat3& concaveScale, const DiagonalMat3& otherScale, double margin) {
+	BoundingBox otherBounds = other.getBounds(relativeTransform.getRotation(), otherScale);
+	Vec3 boundsMin = otherBounds.min + relativeTransform.position - Vec3(margin, margin, margin);
+	Vec3 boundsMax = otherBounds.max + relativeTransform.position + Vec3(margin, margin, margin);
+	return BoundingBoxTemplate<float>(
+		static_cast<float>(boundsMin.x / concaveScale[0]), static_cast<float>(boundsMin.y / concaveScale[1]), static_cast<float>(boundsMin.z / concaveScale[2]),
+		static_cast<float>(boundsMax.x / concaveScale[0]), static_cast<float>(boundsMax.y / concaveScale[1]), static_cast<float>(boundsMax.z / concaveScale[2]));
+}
+
+/*
+	Calls onPrism(prism) for the TrianglePrism of every triangle that forEachTriangleInBounds gives for the given bounds, scaled by concaveScale
+	forEachTriangleInBounds(bounds, onTriangle) must call onTriangle(a, b, c) at least for every triangle of the concave shape overlapping bounds, both unscaled
+	The prisms are as thick as other is wide, so other can't be pushed out through their backs
+*/
+template<typename ForEachTriangleInBounds, typename OnPrism>
+static void forEachTrianglePrism(const ForEachTriangleInBounds& forEachTriangleInBounds, const BoundingBoxTemplate<float>& bounds, const ShapeClass& other, const DiagonalMat3& concaveScale, const DiagonalMat3& otherScale, const OnPrism& onPrism) {
+	float thickness = static_cast<float>(other.getScaledMaxRadius(otherScale) * 2.0);
+	DiagonalMat3f concaveScalef(concaveScale);
+
+	forEachTriangleInBounds(bounds, [&](Vec3f a, Vec3f b, Vec3f c) {
+		a = concaveScalef * a;
+		b = concaveScalef * b;
+		c = concaveScalef * c;
+		Vec3f normal = (b - a) % (c - a);
+		float normalLength = length(normal);
+		if(normalLength == 0.0f) return;
+
+		onPrism(TrianglePrism(a, b, c, normal * (thickness / normalLength)));
+	});
+}
+
+/*
+	relativeTransform is the transform of other relative to the concave shape
+	The deepest of the intersections with the triangles of the concave shape is returned
+*/
+template<typename ForEachTriangleInBounds>
+static std::optional<Intersection> intersectsTrianglesTransformed(const ForEachTriangleInBounds& forEachTriangleInBounds, const ShapeClass& other, const CFrame& relativeTransform, const DiagonalMat3& concaveScale, const DiagonalMat3& otherScale) {
+	BoundingBoxTemplate<float> queryBounds = getConcaveQueryBounds(other, relativeTransform, concaveScale, otherScale, 0.0);
+
+	std::optional<Intersection> deepest;
+	double deepestDepthSq = -1.0;
+	forEachTrianglePrism(forEachTriangleInBounds, queryBounds, other, concaveScale, otherScale, [&](const TrianglePrism& prism) {
+		std::optional<Intersection> result = intersectsTransformed(prism, other, relativeTransform, DiagonalMat3::IDENTITY(), otherScale);
+		if(result && lengthSquared(result.value().exitVector) > deepestDepthSq) {
+			deepestDepthSq = lengthSquared(result.value().exitVector);
+			deepest = result;
+		}
+	});
+	return deepest;
+}
+
+/*
+	relativeTransform is the transform of other relative to the concave shape, concaveBounds are the unscaled bounds of the whole concave shape
+	Returns the closest points to the nearest triangle, or no value if other intersects any of them, just as intersectsTrianglesTransformed would find
+	First only the triangles within other's own radius are tried, only if none of them is that close all triangles are
+*/
+template<typename ForEachTriangleInBounds>
+static std::optional<ClosestPoints> closestPointsTrianglesTransformed(const ForEachTriangleInBounds& forEachTriangleInBounds, const BoundingBoxTemplate<float>& concaveBounds, const ShapeClass& other, const CFrame& relativeTransform, const DiagonalMat3& concaveScale, const DiagonalMat3& otherScale) {
+	double margin = other.getScaledMaxRadius(otherScale);
+
+	std::optional<ClosestPoints> closest;
+	double closestDistanceSq = std::numeric_limits<double>::infinity();
+	bool intersects = false;
+	auto onPrism = [&](const TrianglePrism& prism) {
+		if(intersects) return;
+		std::optional<ClosestPoints> result = closestPointsTransformed(prism, other, relativeTransform, DiagonalMat3::IDENTITY(), otherScale);
+		if(!result) {
+			intersects = true;
+			return;
+		}
+		double distanceSq = lengthSquared(result.value().onSecond - result.value().onFirst);
+		if(distanceSq < closestDistanceSq) {
+			closestDistanceSq = distanceSq;
+			closest = result;
+		}
+	};
+
+	// any triangle closer than margin overlaps other's bounds grown by margin
+	forEachTrianglePrism(forEachTriangleInBounds, getConcaveQueryBounds(other, relativeTransform, concaveScale, otherScale, margin), other, concaveScale, otherScale, onPrism);
+	if(!intersects && closestDistanceSq > margin * margin) {
+		forEachTrianglePrism(forEachTriangleInBounds, concaveBounds, other, concaveScale, otherScale, onPrism);
+	}
+	if(intersects) return std::optional<ClosestPoints>();
+	return closest;
+}
+
+// support function of a PolyhedronShapeClass's collision LOD
+struct CollisionLODCollidable : public GenericCollidable {
+	const Polyhedron* collisionLOD;
+
+	CollisionLODCollidable(const Polyhedron* collisionLOD) : collisionLOD(collisionLOD) {}
+
+	virtual Vec3f furthestInDirection(const Vec3f& direction) const override {
+		return collisionLOD->furthestInDirection(direction);
+	}
+};
+
+static const Polyhedron* getCollisionLOD(const ShapeClass& shapeClass) {
+	if(shapeClass.intersectionClassID != CONVEX_POLYHEDRON_CLASS_ID) return nullptr;
+	return static_cast<const PolyhedronShapeClass&>(shapeClass).getCollisionLOD();
+}
+
+/*
+	Returns false only if the shapes certainly don't intersect, by running GJK on the collision LODs of the shapes that have one
+	The LODs enclose their shapes, so anything that touches the shape touches its LOD
+*/
+static bool collisionLODsIntersect(const Shape& first, const Shape& second, const CFrame& relativeTransform) {
+	const Polyhedron* firstLOD = getCollisionLOD(*first.baseShape);
+	const Polyhedron* secondLOD = getCollisionLOD(*second.baseShape);
+	if(firstLOD == nullptr && secondLOD == nullptr) return true;
+
+	CollisionLODCollidable firstCoarse(firstLOD);
+	CollisionLODCollidable secondCoarse(secondLOD);
+	const GenericCollidable& firstCollidable = (firstLOD != nullptr) ? static_cast<const GenericCollidable&>(firstCoarse) : *first.baseShape;
+	const GenericCollidable& secondCollidable = (secondLOD != nullptr) ? static_cast<const GenericCollidable&>(secondCoarse) : *second.baseShape;
+
+	ColissionPair info{firstCollidable, secondCollidable, relativeTransform, first.scale, second.scale};
+	physicsMeasure.mark(PhysicsProcess::GJK_COL);
+	if(!runGJKTransformed(info, -relativeTransform.position)) {
+		physicsMeasure.mark(PhysicsProcess::OTHER, PhysicsProcess::GJK_NO_COL);
+		return false;
+	}
+	return true;
+}
+
+static bool isConcaveClass(std::size_t intersectionClassID) {
+	return intersectionClassID == TRIANGLE_MESH_CLASS_ID || intersectionClassID == HEIGHTFIELD_CLASS_ID;
+}
+
+// calls onTriangle(a, b, c) for the triangles of the concave shape in the given bounds, as forEachTriangleInBounds of intersectsTrianglesTransformed
+template<typename OnTriangle>
+static void forEachConcaveTriangleInBounds(const ShapeClass& concave, const BoundingBoxTemplate<float>& bounds, const OnTriangle& onTriangle) {
+	if(concave.intersectionClassID == TRIANGLE_MESH_CLASS_ID) {
+		const TriangleMeshShapeClass& meshClass = static_cast<const TriangleMeshShapeClass&>(concave);
+		const TriangleMesh& mesh = meshClass.getMesh();
+		meshClass.getBVH().forEachTriangleInBounds(bounds, [&](int triangleIndex) {
+			Triangle triangle = mesh.getTriangle(triangleIndex);
+			onTriangle(mesh.getVertex(triangle.firstIndex), mesh.getVertex(triangle.secondIndex), mesh.getVertex(triangle.thirdIndex));
+		});
+	} else {
+		static_cast<const HeightfieldShapeClass&>(concave).forEachTriangleInBounds(bounds, onTriangle);
+	}
+}
+
+static std::optional<Intersection> intersectsConcaveTransformed(const ShapeClass& concave, const ShapeClass& other, const CFrame& relativeTransform, const DiagonalMat3& concaveScale, const DiagonalMat3& otherScale) {
+	return intersectsTrianglesTransformed([&](const BoundingBoxTemplate<float>& bounds, const auto& onTriangle) {
+		forEachConcaveTriangleInBounds(concave, bounds, onTriangle);
+	}, other, relativeTransform, concaveScale, otherScale);
+}
+
+static std::optional<ClosestPoints> closestPointsConcaveTransformed(const ShapeClass& concave, const ShapeClass& other, const CFrame& relativeTransform, const DiagonalMat3& concaveScale, const DiagonalMat3& otherScale) {
+	BoundingBox concaveBounds = concave.getBounds(Rotation(), DiagonalMat3::IDENTITY());
+	BoundingBoxTemplate<float> concaveBoundsf(
+		static_cast<float>(concaveBounds.min.x), static_cast<float>(concaveBounds.min.y), static_cast<float>(concaveBounds.min.z),
+		static_cast<float>(concaveBounds.max.x), static_cast<float>(concaveBounds.max.y), static_cast<float>(concaveBounds.max.z));
+	return closestPointsTrianglesTransformed([&](const BoundingBoxTemplate<float>& bounds, const auto& onTriangle) {
+		forEachConcaveTriangleInBounds(concave, bounds, onTriangle);
+	}, concaveBoundsf, other, relativeTransform, concaveScale, otherScale);
+}
+
 std::optional<Intersection> intersectsTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform) {
+	bool firstIsConcave = isConcaveClass(first.baseShape->intersectionClassID);
+	bool secondIsConcave = isConcaveClass(second.baseShape->intersectionClassID);
+	if(firstIsConcave && secondIsConcave) {
+		// concave shapes are only used for static terrain, which never collides with itself
+		return std::optional<Intersection>();
+	} else if(firstIsConcave) {
+		return intersectsConcaveTransformed(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale);
+	} else if(secondIsConcave) {
+		std::optional<Intersection> result = intersectsConcaveTransformed(*second.baseShape, *first.baseShape, ~relativeTransform, second.scale, first.scale);
+		if(result) {
+			// exitVector is the direction in which the concave shape must move, which is opposite to the direction other must move
+			return Intersection(relativeTransform.localToGlobal(result.value().intersection), -relativeTransform.localToRelative(result.value().exitVector));
+		}
+		return std::optional<Intersection>();
+	}
+	if(!collisionLODsIntersect(first, second, relativeTransform)) {
+		return std::optional<Intersection>();
+	}
 	return intersectsTransformed(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale);
 }
 
-thread_local ComputationBuffers buffers(1000, 2000);
+static std::optional<Intersection> runEPAOnGJKResult(const ColissionPair& info, const Tetrahedron& result) {
+	physicsMeasure.mark(PhysicsProcess::EPA);
+	Vec3f intersection;
+	Vec3f exitVector;
+
+	if(!std::isfinite(result.A.p.x) || !std::isfinite(result.A.p.y) || !std::isfinite(result.A.p.z)) {
+		intersection = Vec3f(0.0f, 0.0f, 0.0f);
+		float minOfScaleFirst = std::min(info.scaleFirst[0], std::min(info.scaleFirst[1], info.scaleFirst[2]));
+		float minOfScaleSecond = std::min(info.scaleSecond[0], std::min(info.scaleSecond[1], info.scaleSecond[2]));
+		exitVector = Vec3f(std::min(minOfScaleFirst, minOfScaleSecond), 0.0f, 0.0f);
+
+		return Intersection(intersection, exitVector);
+	}
+
+	catchable_assert(isVecValid(result.A.p));
+	catchable_assert(isVecValid(result.A.originFirst));
+	catchable_assert(isVecValid(result.A.originSecond));
+	catchable_assert(isVecValid(result.B.p));
+	catchable_assert(isVecValid(result.B.originFirst));
+	catchable_assert(isVecValid(result.B.originSecond));
+	catchable_assert(isVecValid(result.C.p));
+	catchable_assert(isVecValid(result.C.originFirst));
+	catchable_assert(isVecValid(result.C.originSecond));
+	catchable_assert(isVecValid(result.D.p));
+	catchable_assert(isVecValid(result.D.originFirst));
+	catchable_assert(isVecValid(result.D.originSecond));
+
+	bool epaResult = runEPATransformed(info, result, intersection, exitVector, buffers);
+
+	catchable_assert(isVecValid(exitVector));
+	if(!epaResult) {
+		return std::optional<Intersection>();
+	} else {
+		return std::optional<Intersection>(Intersection(intersection, exitVector));
+	}
+}
 
 std::optional<Intersection> intersectsTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond) {
 	ColissionPair info{first, second, relativeTransform, scaleFirst, scaleSecond};
@@ -28,44 +272,50 @@ std::optional<Intersection> intersectsTransformed(const GenericCollidable& first
 	std::optional collides = runGJKTransformed(info, -relativeTransform.position);
 
 	if(collides) {
-		Tetrahedron& result = collides.value();
-		physicsMeasure.mark(PhysicsProcess::EPA);
-		Vec3f intersection;
-		Vec3f exitVector;
-
-		if(!std::isfinite(result.A.p.x) || !std::isfinite(result.A.p.y) || !std::isfinite(result.A.p.z)) {
-			intersection = Vec3f(0.0f, 0.0f, 0.0f);
-			float minOfScaleFirst = float(std::min(scaleFirst[0], std::min(scaleFirst[1], scaleFirst[2])));
-			float minOfScaleSecond = float(std::min(scaleSecond[0], std::min(scaleSecond[1], scaleSecond[2])));
-			exitVector = Vec3f(std::min(minOfScaleFirst, minOfScaleSecond), 0.0f, 0.0f);
-
-			return Intersection(intersection, exitVector);
-		}
-
-		catchable_assert(isVecValid(result.A.p));
-		catchable_assert(isVecValid(result.A.originFirst));
-		catchable_assert(isVecValid(result.A.originSecond));
-		catchable_assert(isVecValid(result.B.p));
-		catchable_assert(isVecValid(result.B.originFirst));
-		catchable_assert(isVecValid(result.B.originSecond));
-		catchable_assert(isVecValid(result.C.p));
-		catchable_assert(isVecValid(result.C.originFirst));
-		catchable_assert(isVecValid(result.C.originSecond));
-		catchable_assert(isVecValid(result.D.p));
-		catchable_assert(isVecValid(result.D.originFirst));
-		catchable_assert(isVecValid(result.D.originSecond));
-
-		bool epaResult = runEPATransformed(info, result, intersection, exitVector, buffers);
-
-		catchable_assert(isVecValid(exitVector));
-		if(!epaResult) {
-			return std::optional<Intersection>();
-		} else {
-			return std::optional<Intersection>(Intersection(intersection, exitVector));
-		}
+		return runEPAOnGJKResult(info, collides.value());
 	} else {
 		physicsMeasure.mark(PhysicsProcess::OTHER, PhysicsProcess::GJK_NO_COL);
 		return std::optional<Intersection>();
 	}
 }
+
+std::optional<Intersection> intersectsTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform, const Tetrahedron& gjkResult) {
+	return intersectsTransformed(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale, gjkResult);
+}
+
+std::optional<Intersection> intersectsTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond, const Tetrahedron& gjkResult) {
+	ColissionPair info{first, second, relativeTransform, scaleFirst, scaleSecond};
+	return runEPAOnGJKResult(info, gjkResult);
+}
+
+std::optional<ClosestPoints> closestPointsTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform) {
+	bool firstIsConcave = isConcaveClass(first.baseShape->intersectionClassID);
+	bool secondIsConcave = isConcaveClass(second.baseShape->intersectionClassID);
+	if(firstIsConcave && secondIsConcave) {
+		// concave shapes are only used for static terrain, which is never brought close to other terrain
+		return std::optional<ClosestPoints>();
+	} else if(firstIsConcave) {
+		return closestPointsConcaveTransformed(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale);
+	} else if(secondIsConcave) {
+		std::optional<ClosestPoints> result = closestPointsConcaveTransformed(*second.baseShape, *first.baseShape, ~relativeTransform, second.scale, first.scale);
+		if(result) {
+			return ClosestPoints(relativeTransform.localToGlobal(result.value().onSecond), relativeTransform.localToGlobal(result.value().onFirst));
+		}
+		return std::optional<ClosestPoints>();
+	}
+	return closestPointsTransformed(*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale);
+}
+
+std::optional<ClosestPoints> closestPointsTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond) {
+	ColissionPair info{first, second, relativeTransform, scaleFirst, scaleSecond};
+	Vec3f onFirst;
+	Vec3f onSecond;
+	if(runGJKDistanceTransformed(info, -relativeTransform.position, onFirst, onSecond)) {
+		catchable_assert(isVecValid(onFirst));
+		catchable_assert(isVecValid(onSecond));
+		return ClosestPoints(onFirst, onSecond);
+	} else {
+		return std::optional<ClosestPoints>();
+	}
+}
 };
@@ -9,6 +9,7 @@
 namespace P3D {
 class Shape;
 class Polyhedron;
+struct Tetrahedron;
 
 struct Intersection {
 	// Local to first
@@ -21,6 +22,25 @@ struct Intersection {
 		exitVector(exitVector) {}
 };
 
+struct ClosestPoints {
+	// Local to first
+	Vec3 onFirst;
+	// Local to first
+	Vec3 onSecond;
+
+	ClosestPoints(const Vec3& onFirst, const Vec3& onSecond) :
+		onFirst(onFirst),
+		onSecond(onSecond) {}
+};
+
 std::optional<Intersection> intersectsTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform);
 std::optional<Intersection> intersectsTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond);
+
+// finishes an intersection test for which GJK already found a tetrahedron around the origin, such as one produced by runGJKBatch
+std::optional<Intersection> intersectsTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform, const Tetrahedron& gjkResult);
+std::optional<Intersection> intersectsTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond, const Tetrahedron& gjkResult);
+
+// returns no value if the shapes intersect
+std::optional<ClosestPoints> closestPointsTransformed(const Shape& first, const Shape& second, const CFrame& relativeTransform);
+std::optional<ClosestPoints> closestPointsTransformed(const GenericCollidable& first, const GenericCollidable& second, const CFrame& relativeTransform, const DiagonalMat3& scaleFirst, const DiagonalMat3& scaleSecond);
 };
@@ -0,0 +1,509 @@
+#include "quickhull.h"
+
+#include "../threading/threadPool.h"
+
+#include <vector>
+#include <queue>
+#include <utility>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+// point sets smaller than this are partitioned on the calling thread, even if a ThreadPool is given
+#define PARALLEL_PARTITION_MIN_POINTS 16384
+// number of points a thread claims at once while partitioning
+#define PARTITION_CHUNK_SIZE 2048
+// times the visible faces of a point are grown to get rid of degenerate new faces, before the point is dropped
+#define MAX_HORIZON_REPAIRS 8
+
+namespace P3D {
+struct QuickhullFace {
+	int vertices[3];
+	// neighbors[i] is the face across the edge from vertices[i] to vertices[(i + 1) % 3]
+	int neighbors[3];
+	Vec3 normal;
+	double offset;
+	// points outside of this face that are not yet part of the hull
+	std::vector<int> outsidePoints;
+	int furthestPoint = -1;
+	double furthestDistance = 0.0;
+	bool alive = true;
+	bool visible = false;
+	bool forceVisible = false;
+	bool forceHidden = false;
+
+	inline double distanceTo(const Vec3& point) const {
+		return normal * point - offset;
+	}
+};
+
+struct HorizonEdge {
+	int face;
+	int edge;
+};
+
+class QuickhullBuilder {
+	const Vec3f* points;
+	int pointCount;
+	double tolerance;
+	ThreadPool* threadPool;
+
+	std::vector<QuickhullFace> faces;
+	int addedPointCount = 0;
+
+	// buffers reused between iterations
+	std::vector<int> visibleFaces;
+	std::vector<int> faceStack;
+	std::vector<HorizonEdge> horizon;
+	std::vector<HorizonEdge> orderedHorizon;
+	std::vector<QuickhullFace> newFaces;
+	std::vector<int> forcedFaces;
+	std::vector<int> targetFaces;
+	std::vector<int> candidates;
+	std::vector<int> assignment;
+
+	inline Vec3 getPoint(int index) const {
+		return Vec3(points[index]);
+	}
+
+	// returns false if the face is degenerate
+	bool makeFace(QuickhullFace& face, int a, int b, int c) const {
+		Vec3 pa = getPoint(a);
+		Vec3 normal = (getPoint(b) - pa) % (getPoint(c) - pa);
+		double normalLength = length(normal);
+		if(normalLength == 0.0) return false;
+
+		face.vertices[0] = a;
+		face.vertices[1] = b;
+		face.vertices[2] = c;
+		face.normal = normal / normalLength;
+		face.offset = face.normal * pa;
+		return true;
+	}
+
+	inline bool isNearEdge(const Vec3& point, int edgeStart, int edgeEnd) const {
+		Vec3 start = getPoint(edgeStart);
+		Vec3 edge = getPoint(edgeEnd) - start;
+		return length((point - start) % edge) <= tolerance * length(edge);
+	}
+
+	/*
+		Assigns every candidate point to the given face it lies furthest outside of, points inside of all of them are dropped
+		Finding the faces is independent per point, so that part is spread over the ThreadPool for large point sets
+	*/
+	void partition(const std::vector<int>& pointIndices, const std::vector<int>& faceIndices) {
+		assignment.resize(pointIndices.size());
+		auto assignRange = [this, &pointIndices, &faceIndices](std::size_t start, std::size_t end) {
+			for(std::size_t i = start; i < end; i++) {
+				Vec3 point = getPoint(pointIndices[i]);
+				int bestFace = -1;
+				double bestDistance = tolerance;
+				for(int f : faceIndices) {
+					double distance = faces[f].distanceTo(point);
+					if(distance > bestDistance) {
+						bestDistance = distance;
+						bestFace = f;
+					}
+				}
+				assignment[i] = bestFace;
+			}
+		};
+
+		if(threadPool != nullptr && pointIndices.size() >= PARALLEL_PARTITION_MIN_POINTS) {
+			std::atomic<std::size_t> currIndex = 0;
+			const std::size_t workEnd = pointIndices.size();
+			threadPool->doInParallel([&] {
+				while(true) {
+					std::size_t claimedWork = currIndex.fetch_add(PARTITION_CHUNK_SIZE, std::memory_order_relaxed);
+					if(claimedWork >= workEnd) {
+						break;
+					}
+					assignRange(claimedWork, std::min(claimedWork + PARTITION_CHUNK_SIZE, workEnd));
+				}
+			});
+		} else {
+			assignRange(0, pointIndices.size());
+		}
+
+		for(std::size_t i = 0; i < pointIndices.size(); i++) {
+			if(assignment[i] == -1) continue;
+			QuickhullFace& face = faces[assignment[i]];
+			face.outsidePoints.push_back(pointIndices[i]);
+			double distance = face.distanceTo(getPoint(pointIndices[i]));
+			if(distance > face.furthestDistance) {
+				face.furthestDistance = distance;
+				face.furthestPoint = pointIndices[i];
+			}
+		}
+	}
+
+	// returns false if the points don't span a volume
+	bool buildInitialSimplex() {
+		int extremes[6]{0, 0, 0, 0, 0, 0};
+		for(int i = 1; i < pointCount; i++) {
+			for(int axis = 0; axis < 3; axis++) {
+				if(points[i][axis] < points[extremes[axis * 2]][axis]) extremes[axis * 2] = i;
+				if(points[i][axis] > points[extremes[axis * 2 + 1]][axis]) extremes[axis * 2 + 1] = i;
+			}
+		}
+
+		int a = extremes[0];
+		int b = extremes[1];
+		for(int axis = 1; axis < 3; axis++) {
+			if(lengthSquared(getPoint(extremes[axis * 2 + 1]) - getPoint(extremes[axis * 2])) > lengthSquared(getPoint(b) - getPoint(a))) {
+				a = extremes[axis * 2];
+				b = extremes[axis * 2 + 1];
+			}
+		}
+		Vec3 pa = getPoint(a);
+		Vec3 ab = getPoint(b) - pa;
+		if(length(ab) <= tolerance) return false;
+
+		int c = -1;
+		double bestLineDistance = tolerance;
+		for(int i = 0; i < pointCount; i++) {
+			double lineDistance = length((getPoint(i) - pa) % ab) / length(ab);
+			if(lineDistance > bestLineDistance) {
+				bestLineDistance = lineDistance;
+				c = i;
+			}
+		}
+		if(c == -1) return false;
+
+		Vec3 planeNormal = normalize(ab % (getPoint(c) - pa));
+		int d = -1;
+		double bestPlaneDistance = tolerance;
+		for(int i = 0; i < pointCount; i++) {
+			double planeDistance = std::abs((getPoint(i) - pa) * planeNormal);
+			if(planeDistance > bestPlaneDistance) {
+				bestPlaneDistance = planeDistance;
+				d = i;
+			}
+		}
+		if(d == -1) return false;
+
+		// the first face must point away from d
+		if((getPoint(d) - pa) * planeNormal > 0.0) std::swap(b, c);
+
+		int simplex[4][3]{{a, b, c}, {a, c, d}, {a, d, b}, {d, c, b}};
+		faces.resize(4);
+		for(int f = 0; f < 4; f++) {
+			if(!makeFace(faces[f], simplex[f][0], simplex[f][1], simplex[f][2])) return false;
+		}
+		for(int f = 0; f < 4; f++) {
+			for(int i = 0; i < 3; i++) {
+				int from = faces[f].vertices[i];
+				int to = faces[f].vertices[(i + 1) % 3];
+				for(int g = 0; g < 4; g++) {
+					for(int j = 0; j < 3; j++) {
+						if(faces[g].vertices[j] == to && faces[g].vertices[(j + 1) % 3] == from) faces[f].neighbors[i] = g;
+					}
+				}
+			}
+		}
+		addedPointCount = 4;
+
+		candidates.clear();
+		for(int i = 0; i < pointCount; i++) {
+			if(i != a && i != b && i != c && i != d) candidates.push_back(i);
+		}
+		targetFaces.assign({0, 1, 2, 3});
+		partition(candidates, targetFaces);
+		return true;
+	}
+
+	// orders the horizon into a loop, returns false if it isn't a single simple loop
+	bool orderHorizon() {
+		std::unordered_map<int, std::size_t> edgeStartingAt;
+		for(std::size_t i = 0; i < horizon.size(); i++) {
+			int from = faces[horizon[i].face].vertices[horizon[i].edge];
+			if(!edgeStartingAt.emplace(from, i).second) return false;
+		}
+
+		orderedHorizon.clear();
+		std::size_t current = 0;
+		do {
+			orderedHorizon.push_back(horizon[current]);
+			const QuickhullFace& face = faces[horizon[current].face];
+			auto next = edgeStartingAt.find(face.vertices[(horizon[current].edge + 1) % 3]);
+			if(next == edgeStartingAt.end()) return false;
+			current = next->second;
+		} while(current != 0 && orderedHorizon.size() <= horizon.size());
+
+		return orderedHorizon.size() == horizon.size();
+	}
+
+	// the point is dropped instead of added if the visible faces can't be made a disk with valid new faces around it
+	void dropPoint(int eye, int seedFace) {
+		QuickhullFace& seed = faces[seedFace];
+		seed.outsidePoints.erase(std::find(seed.outsidePoints.begin(), seed.outsidePoints.end(), eye));
+		seed.furthestPoint = -1;
+		seed.furthestDistance = 0.0;
+		for(int point : seed.outsidePoints) {
+			double distance = seed.distanceTo(getPoint(point));
+			if(distance > seed.furthestDistance) {
+				seed.furthestDistance = distance;
+				seed.furthestPoint = point;
+			}
+		}
+	}
+
+	/*
+		Collects the faces visible from the point and the edges around them, starting from a face it is above
+		Faces are visible if the point is strictly above them rather than above the tolerance, so the hull never becomes concave at the horizon
+		Faces marked forceVisible are visible too, as are all coplanar faces if relaxed, faces marked forceHidden never are
+	*/
+	void findVisibleFaces(const Vec3& eyePoint, int seedFace, bool relaxed) {
+		visibleFaces.clear();
+		horizon.clear();
+		faceStack.clear();
+		faceStack.push_back(seedFace);
+		faces[seedFace].visible = true;
+		while(!faceStack.empty()) {
+			int f = faceStack.back();
+			faceStack.pop_back();
+			visibleFaces.push_back(f);
+			for(int i = 0; i < 3; i++) {
+				int neighbor = faces[f].neighbors[i];
+				if(faces[neighbor].visible) continue;
+				double distance = faces[neighbor].distanceTo(eyePoint);
+				if(!faces[neighbor].forceHidden && (distance > 0.0 || faces[neighbor].forceVisible || (relaxed && distance > -tolerance))) {
+					faces[neighbor].visible = true;
+					faceStack.push_back(neighbor);
+				} else {
+					horizon.push_back(HorizonEdge{f, i});
+				}
+			}
+		}
+	}
+
+	/*
+		Builds the faces between the horizon and the point into newFaces
+		A new face must be convex with the face on the other side of its horizon edge, if it's degenerate or folds over that face false is returned
+		Then either the visible face at that edge is coplanar with the point and only seemed visible by rounding, so it's marked forceHidden,
+		or the hidden face is coplanar with the point and gets marked forceVisible, so it's replaced together with the visible faces
+	*/
+	bool makeNewFaces(int eye, int seedFace, int firstNewFace) {
+		int horizonSize = static_cast<int>(orderedHorizon.size());
+		newFaces.resize(horizonSize);
+		bool valid = true;
+		for(int k = 0; k < horizonSize; k++) {
+			const QuickhullFace& visibleFace = faces[orderedHorizon[k].face];
+			int edge = orderedHorizon[k].edge;
+			int a = visibleFace.vertices[edge];
+			int b = visibleFace.vertices[(edge + 1) % 3];
+			QuickhullFace& hiddenFace = faces[visibleFace.neighbors[edge]];
+			newFaces[k] = QuickhullFace();
+
+			int opposite = hiddenFace.vertices[0] + hiddenFace.vertices[1] + hiddenFace.vertices[2] - a - b;
+			if(isNearEdge(getPoint(eye), a, b) || !makeFace(newFaces[k], a, b, eye) || newFaces[k].distanceTo(getPoint(opposite)) > tolerance) {
+				int visibleIndex = orderedHorizon[k].face;
+				if(visibleIndex != seedFace && std::abs(visibleFace.distanceTo(getPoint(eye))) <= tolerance) {
+					faces[visibleIndex].forceHidden = true;
+					forcedFaces.push_back(visibleIndex);
+				} else {
+					hiddenFace.forceVisible = true;
+					forcedFaces.push_back(visibleFace.neighbors[edge]);
+				}
+				valid = false;
+				continue;
+			}
+			newFaces[k].neighbors[0] = visibleFace.neighbors[edge];
+			newFaces[k].neighbors[1] = firstNewFace + (k + 1) % horizonSize;
+			newFaces[k].neighbors[2] = firstNewFace + (k + horizonSize - 1) % horizonSize;
+		}
+		return valid;
+	}
+
+	// returns false if the point was dropped, otherwise targetFaces holds the faces that may have gained outside points
+	bool addPoint(int eye, int seedFace) {
+		Vec3 eyePoint = getPoint(eye);
+		int firstNewFace = static_cast<int>(faces.size());
+
+		bool relaxed = false;
+		bool success = false;
+		for(int attempt = 0; attempt < MAX_HORIZON_REPAIRS && !success; attempt++) {
+			findVisibleFaces(eyePoint, seedFace, relaxed);
+			if(!orderHorizon()) {
+				// rounding errors in nearly coplanar faces can pinch the visible faces, including all those faces usually fixes it
+				relaxed = true;
+			} else {
+				success = makeNewFaces(eye, seedFace, firstNewFace);
+			}
+			if(!success) {
+				for(int f : visibleFaces) faces[f].visible = false;
+			}
+		}
+		for(int f : forcedFaces) {
+			faces[f].forceVisible = false;
+			faces[f].forceHidden = false;
+		}
+		forcedFaces.clear();
+		if(!success) {
+			dropPoint(eye, seedFace);
+			return false;
+		}
+		int horizonSize = static_cast<int>(orderedHorizon.size());
+
+		for(int k = 0; k < horizonSize; k++) {
+			QuickhullFace& hiddenFace = faces[newFaces[k].neighbors[0]];
+			for(int j = 0; j < 3; j++) {
+				if(hiddenFace.vertices[j] == newFaces[k].vertices[1]) hiddenFace.neighbors[j] = firstNewFace + k;
+			}
+		}
+
+		candidates.clear();
+		for(int f : visibleFaces) {
+			QuickhullFace& face = faces[f];
+			for(int point : face.outsidePoints) {
+				if(point != eye) candidates.push_back(point);
+			}
+			face.alive = false;
+			face.visible = false;
+			std::vector<int>().swap(face.outsidePoints);
+		}
+
+		// rounding errors around coplanar faces can leave points outside the hidden faces at the horizon instead of the new ones
+		targetFaces.clear();
+		for(int k = 0; k < horizonSize; k++) {
+			targetFaces.push_back(firstNewFace + k);
+			targetFaces.push_back(newFaces[k].neighbors[0]);
+			faces.push_back(std::move(newFaces[k]));
+		}
+		std::sort(targetFaces.begin(), targetFaces.end());
+		targetFaces.erase(std::unique(targetFaces.begin(), targetFaces.end()), targetFaces.end());
+		partition(candidates, targetFaces);
+		addedPointCount++;
+		return true;
+	}
+
+public:
+	QuickhullBuilder(const Vec3f* points, int pointCount, double tolerance, ThreadPool* threadPool) :
+		points(points), pointCount(pointCount), tolerance(tolerance), threadPool(threadPool) {}
+
+	// returns false if the points don't span a volume
+	bool build(int maxVertices) {
+		if(pointCount < 4 || !buildInitialSimplex()) return false;
+
+		std::priority_queue<std::pair<double, int>> queue;
+		for(int f = 0; f < 4; f++) {
+			if(faces[f].furthestPoint != -1) queue.emplace(faces[f].furthestDistance, f);
+		}
+
+		while(!queue.empty() && (maxVertices <= 0 || addedPointCount < maxVertices)) {
+			int faceIndex = queue.top().second;
+			queue.pop();
+			if(!faces[faceIndex].alive || faces[faceIndex].furthestPoint == -1) continue;
+
+			if(!addPoint(faces[faceIndex].furthestPoint, faceIndex)) {
+				if(faces[faceIndex].furthestPoint != -1) queue.emplace(faces[faceIndex].furthestDistance, faceIndex);
+				continue;
+			}
+			for(int f : targetFaces) {
+				if(faces[f].furthestPoint != -1) queue.emplace(faces[f].furthestDistance, f);
+			}
+		}
+		return true;
+	}
+
+	/*
+		Point indices of the hull vertices that are real corners
+		A vertex whose faces all lie within the tolerance of at most two planes is in the middle of a flat face or a straight edge
+		hullVertexCount is set to the number of vertices including those that aren't corners
+	*/
+	std::vector<int> getCornerPoints(int& hullVertexCount) const {
+		std::unordered_map<int, std::vector<int>> facesOfVertex;
+		for(int f = 0; f < static_cast<int>(faces.size()); f++) {
+			if(!faces[f].alive) continue;
+			for(int vertex : faces[f].vertices) facesOfVertex[vertex].push_back(f);
+		}
+
+		hullVertexCount = static_cast<int>(facesOfVertex.size());
+		std::vector<int> corners;
+		for(const auto& [vertex, vertexFaces] : facesOfVertex) {
+			int planes[2]{vertexFaces[0], -1};
+			bool isCorner = false;
+			for(int f : vertexFaces) {
+				bool onPlane = false;
+				for(int plane : planes) {
+					if(plane == -1) continue;
+					bool allVerticesOnPlane = true;
+					for(int v : faces[f].vertices) {
+						if(std::abs(faces[plane].distanceTo(getPoint(v))) > tolerance) allVerticesOnPlane = false;
+					}
+					if(allVerticesOnPlane) onPlane = true;
+				}
+				if(onPlane) continue;
+				if(planes[1] == -1) {
+					planes[1] = f;
+				} else {
+					isCorner = true;
+					break;
+				}
+			}
+			if(isCorner) corners.push_back(vertex);
+		}
+		std::sort(corners.begin(), corners.end());
+		return corners;
+	}
+
+	Polyhedron toPolyhedron() const {
+		std::unordered_map<int, int> hullIndexOf;
+		std::vector<Vec3f> vertices;
+		std::vector<Triangle> triangles;
+		for(const QuickhullFace& face : faces) {
+			if(!face.alive) continue;
+			int indices[3];
+			for(int i = 0; i < 3; i++) {
+				auto found = hullIndexOf.emplace(face.vertices[i], static_cast<int>(vertices.size()));
+				if(found.second) vertices.push_back(points[face.vertices[i]]);
+				indices[i] = found.first->second;
+			}
+			triangles.push_back(Triangle{indices[0], indices[1], indices[2]});
+		}
+		return Polyhedron(vertices.data(), triangles.data(), static_cast<int>(vertices.size()), static_cast<int>(triangles.size()));
+	}
+};
+
+// relative rounding error of float coordinates, scaled to the size of the point cloud
+static double getDefaultTolerance(const Vec3f* points, int pointCount) {
+	Vec3 maxAbs(0.0, 0.0, 0.0);
+	for(int i = 0; i < pointCount; i++) {
+		for(int axis = 0; axis < 3; axis++) {
+			maxAbs[axis] = std::max(maxAbs[axis], static_cast<double>(std::abs(points[i][axis])));
+		}
+	}
+	return 3.0 * std::numeric_limits<float>::epsilon() * (maxAbs.x + maxAbs.y + maxAbs.z);
+}
+
+static Polyhedron buildQuickhull(const Vec3f* points, int pointCount, const QuickhullSettings& settings, ThreadPool* threadPool) {
+	double tolerance = settings.tolerance > 0.0 ? settings.tolerance : getDefaultTolerance(points, pointCount);
+
+	QuickhullBuilder builder(points, pointCount, tolerance, threadPool);
+	if(!builder.build(settings.maxVertices)) return Polyhedron();
+
+	int hullVertexCount;
+	std::vector<int> corners = builder.getCornerPoints(hullVertexCount);
+	if(static_cast<int>(corners.size()) == hullVertexCount) return builder.toPolyhedron();
+
+	// rebuild from the corners alone, which merges the coplanar faces
+	std::vector<Vec3f> cornerPoints;
+	cornerPoints.reserve(corners.size());
+	for(int corner : corners) {
+		cornerPoints.push_back(points[corner]);
+	}
+	QuickhullBuilder cornerBuilder(cornerPoints.data(), static_cast<int>(cornerPoints.size()), tolerance, nullptr);
+	if(!cornerBuilder.build(0)) return builder.toPolyhedron();
+	return cornerBuilder.toPolyhedron();
+}
+
+Polyhedron quickhull(const Vec3f* points, int pointCount, const QuickhullSettings& settings) {
+	return buildQuickhull(points, pointCount, settings, nullptr);
+}
+
+Polyhedron quickhull(const Vec3f* points, int pointCount, ThreadPool& threadPool, const QuickhullSettings& settings) {
+	return buildQuickhull(points, pointCount, settings, &threadPool);
+}
+};
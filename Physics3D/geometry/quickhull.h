@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../math/linalg/vec.h"
+#include "polyhedron.h"
+
+namespace P3D {
+class ThreadPool;
+
+struct QuickhullSettings {
+	// points closer than this to the plane of a face count as lying in it, and faces that are coplanar within it are merged
+	// 0 derives the tolerance from the float precision of the points
+	double tolerance = 0.0;
+	// the hull stops growing at this many vertices, the point furthest outside is always added first. 0 means no limit
+	int maxVertices = 0;
+};
+
+/*
+	Convex hull of a point cloud by Quickhull, meant for large point sets such as scans at asset import time
+	Unlike ConvexShapeBuilder it sizes its own buffers, so any number of points can be given
+	Vertices that only lie on flat faces or straight edges of the hull within the tolerance are left out
+	Returns an empty Polyhedron if the points don't span a volume
+*/
+Polyhedron quickhull(const Vec3f* points, int pointCount, const QuickhullSettings& settings = QuickhullSettings());
+// same, but large point sets are partitioned over the faces on the given ThreadPool
+Polyhedron quickhull(const Vec3f* points, int pointCount, ThreadPool& threadPool, const QuickhullSettings& settings = QuickhullSettings());
+};
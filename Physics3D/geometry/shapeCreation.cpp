@@ -8,6 +8,15 @@
 
 #include "../datastructures/smartPointers.h"
 
+#include <algorithm>
+#include <vector>
+
+// above this many vertices walking the vertex graph beats scanning all vertices, even with AVX
+#define HILL_CLIMBING_VERTEX_THRESHOLD 128
+// flat meshes such as terrain planes still need a nonzero extent along their flat axis to be scaled to the -1..1 box
+#define MIN_TRIANGLE_MESH_EXTENT 0.001
+#define MIN_HEIGHTFIELD_HEIGHT 0.001
+
 namespace P3D {
 Shape boxShape(double width, double height, double depth) {
 	return Shape(intrusive_ptr<const ShapeClass>(&CubeClass::instance), width, height, depth);
@@ -30,25 +39,58 @@ Shape cylinderShape(double radius, double height) {
 }
 
 
-Shape polyhedronShape(const Polyhedron& poly) {
-	BoundingBox bounds = poly.getBounds();
-	Vec3 center = bounds.getCenter();
-	DiagonalMat3 scale{2 / bounds.getWidth(), 2 / bounds.getHeight(), 2 / bounds.getDepth()};
-
-	PolyhedronShapeClass* shapeClass;
-
-	if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2 | CPUIDCheck::FMA)) {
-		shapeClass = new PolyhedronShapeClassAVX(poly.translatedAndScaled(-center, scale));
+PolyhedronShapeClass* createPolyhedronShapeClass(Polyhedron&& normalizedPoly) {
+	if(normalizedPoly.vertexCount > HILL_CLIMBING_VERTEX_THRESHOLD) {
+		return new PolyhedronShapeClassHillClimbing(std::move(normalizedPoly));
+	} else if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2 | CPUIDCheck::FMA)) {
+		return new PolyhedronShapeClassAVX(std::move(normalizedPoly));
 	} else if(CPUIDCheck::hasTechnology(CPUIDCheck::SSE | CPUIDCheck::SSE2)) {
 		if(CPUIDCheck::hasTechnology(CPUIDCheck::SSE4_1)) {
-			shapeClass = new PolyhedronShapeClassSSE4(poly.translatedAndScaled(-center, scale));
+			return new PolyhedronShapeClassSSE4(std::move(normalizedPoly));
 		} else {
-			shapeClass = new PolyhedronShapeClassSSE(poly.translatedAndScaled(-center, scale));
+			return new PolyhedronShapeClassSSE(std::move(normalizedPoly));
 		}
 	} else {
-		shapeClass = new PolyhedronShapeClassFallback(poly.translatedAndScaled(-center, scale));
+		return new PolyhedronShapeClassFallback(std::move(normalizedPoly));
 	}
+}
+
+Shape polyhedronShape(const Polyhedron& poly) {
+	BoundingBox bounds = poly.getBounds();
+	Vec3 center = bounds.getCenter();
+	DiagonalMat3 scale{2 / bounds.getWidth(), 2 / bounds.getHeight(), 2 / bounds.getDepth()};
+
+	PolyhedronShapeClass* shapeClass = createPolyhedronShapeClass(poly.translatedAndScaled(-center, scale));
 
 	return Shape(intrusive_ptr<const ShapeClass>(shapeClass), bounds.getWidth(), bounds.getHeight(), bounds.getDepth());
 }
+
+Shape triangleMeshShape(const TriangleMesh& mesh) {
+	BoundingBox bounds = mesh.getBounds();
+	Vec3 center = bounds.getCenter();
+	double width = std::max(bounds.getWidth(), MIN_TRIANGLE_MESH_EXTENT);
+	double height = std::max(bounds.getHeight(), MIN_TRIANGLE_MESH_EXTENT);
+	double depth = std::max(bounds.getDepth(), MIN_TRIANGLE_MESH_EXTENT);
+	DiagonalMat3 scale{2 / width, 2 / height, 2 / depth};
+
+	TriangleMeshShapeClass* shapeClass = new TriangleMeshShapeClass(mesh.translatedAndScaled(-center, scale));
+
+	return Shape(intrusive_ptr<const ShapeClass>(shapeClass), width, height, depth);
+}
+
+Shape heightfieldShape(int sampleCountX, int sampleCountZ, const float* heights, double cellSize, bool quantize) {
+	int sampleCount = sampleCountX * sampleCountZ;
+	float minHeight = *std::min_element(heights, heights + sampleCount);
+	float maxHeight = *std::max_element(heights, heights + sampleCount);
+	double height = std::max(static_cast<double>(maxHeight - minHeight), MIN_HEIGHTFIELD_HEIGHT);
+
+	std::vector<float> normalizedHeights(sampleCount);
+	for(int i = 0; i < sampleCount; i++) {
+		normalizedHeights[i] = static_cast<float>((heights[i] - minHeight) / height * 2.0 - 1.0);
+	}
+
+	HeightfieldShapeClass* shapeClass = new HeightfieldShapeClass(sampleCountX, sampleCountZ, normalizedHeights.data(), quantize);
+
+	return Shape(intrusive_ptr<const ShapeClass>(shapeClass), (sampleCountX - 1) * cellSize, height, (sampleCountZ - 1) * cellSize);
+}
 };
\ No newline at end of file
@@ -4,6 +4,8 @@
 
 namespace P3D {
 class Polyhedron;
+class PolyhedronShapeClass;
+class TriangleMesh;
 
 Shape boxShape(double width, double height, double depth);
 Shape wedgeShape(double width, double height, double depth);
@@ -11,4 +13,13 @@ Shape cornerShape(double width, double height, double depth);
 Shape sphereShape(double radius);
 Shape cylinderShape(double radius, double height);
 Shape polyhedronShape(const Polyhedron& poly);
+// the fastest PolyhedronShapeClass for this polyhedron and CPU, poly must already fill the -1..1 box like those of polyhedronShape do
+PolyhedronShapeClass* createPolyhedronShapeClass(Polyhedron&& normalizedPoly);
+// concave mesh collider for static terrain, see TriangleMeshShapeClass
+Shape triangleMeshShape(const TriangleMesh& mesh);
+/*
+	Terrain from a grid of heights, see HeightfieldShapeClass. heights[x * sampleCountZ + z] is the height of the sample at (x * cellSize, z * cellSize)
+	Like the other shapes it is centered on its part, at the center of the bounds of the samples
+*/
+Shape heightfieldShape(int sampleCountX, int sampleCountZ, const float* heights, double cellSize, bool quantize = false);
 }
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "triangleBVH.h"
+
+#include "triangleMesh.h"
+#include "../math/utils.h"
+
+#include <algorithm>
+#include <limits>
+#include <cassert>
+#include <utility>
+
+namespace P3D {
+static BoundingBoxTemplate<float> getEmptyBounds() {
+	float inf = std::numeric_limits<float>::infinity();
+	return BoundingBoxTemplate<float>(inf, inf, inf, -inf, -inf, -inf);
+}
+
+static BoundingBoxTemplate<float> getBoundsOfRange(const std::vector<int>& triangles, const std::vector<BoundingBoxTemplate<float>>& triangleBounds, int start, int end) {
+	BoundingBoxTemplate<float> result = getEmptyBounds();
+	for(int i = start; i < end; i++) {
+		result = result.expanded(triangleBounds[triangles[i]]);
+	}
+	return result;
+}
+
+TriangleBVH::TriangleBVH(const TriangleMesh& mesh) {
+	if(mesh.triangleCount == 0) return;
+
+	std::vector<Vec3f> centroids(mesh.triangleCount);
+	std::vector<BoundingBoxTemplate<float>> triangleBounds(mesh.triangleCount);
+	std::vector<int> triangles(mesh.triangleCount);
+	for(int i = 0; i < mesh.triangleCount; i++) {
+		Triangle t = mesh.getTriangle(i);
+		Vec3f a = mesh.getVertex(t.firstIndex);
+		Vec3f b = mesh.getVertex(t.secondIndex);
+		Vec3f c = mesh.getVertex(t.thirdIndex);
+		centroids[i] = (a + b + c) * (1.0f / 3.0f);
+		triangleBounds[i] = BoundingBoxTemplate<float>(a, a).expanded(b).expanded(c);
+		triangles[i] = i;
+	}
+
+	nodes.reserve(mesh.triangleCount / (LEAF_SIZE * 2) + 1);
+	buildNode(triangles, centroids, triangleBounds, 0, mesh.triangleCount, 0);
+	triangleIndices = std::move(triangles);
+}
+
+/*
+	Splits the range in up to BRANCH_FACTOR groups by repeatedly cutting the largest group at the median centroid along its longest axis
+	Groups of at most LEAF_SIZE triangles become leaves, larger groups become child nodes
+*/
+int TriangleBVH::buildNode(std::vector<int>& triangles, const std::vector<Vec3f>& centroids, const std::vector<BoundingBoxTemplate<float>>& triangleBounds, int start, int end, int depth) {
+	assert(depth < MAX_DEPTH);
+	std::pair<int, int> groups[BRANCH_FACTOR];
+	int groupCount = 1;
+	groups[0] = std::pair<int, int>(start, end);
+
+	while(groupCount < BRANCH_FACTOR) {
+		int largest = 0;
+		for(int i = 1; i < groupCount; i++) {
+			if(groups[i].second - groups[i].first > groups[largest].second - groups[largest].first) largest = i;
+		}
+		int groupStart = groups[largest].first;
+		int groupEnd = groups[largest].second;
+		if(groupEnd - groupStart <= LEAF_SIZE) break;
+
+		BoundingBoxTemplate<float> centroidBounds(centroids[triangles[groupStart]], centroids[triangles[groupStart]]);
+		for(int i = groupStart + 1; i < groupEnd; i++) {
+			centroidBounds = centroidBounds.expanded(centroids[triangles[i]]);
+		}
+		Vec3f extent = centroidBounds.max - centroidBounds.min;
+		int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+		int mid = (groupStart + groupEnd) / 2;
+		std::nth_element(triangles.begin() + groupStart, triangles.begin() + mid, triangles.begin() + groupEnd, [&centroids, axis](int a, int b) {
+			return centroids[a][axis] < centroids[b][axis];
+		});
+
+		groups[largest] = std::pair<int, int>(groupStart, mid);
+		groups[groupCount++] = std::pair<int, int>(mid, groupEnd);
+	}
+
+	int nodeIndex = static_cast<int>(nodes.size());
+	nodes.emplace_back();
+
+	BoundingBoxTemplate<float> empty = getEmptyBounds();
+	for(int i = 0; i < BRANCH_FACTOR; i++) {
+		BoundingBoxTemplate<float> childBounds = empty;
+		int childStart = 0;
+		int childTriangleCount = 0;
+		if(i < groupCount) {
+			childBounds = getBoundsOfRange(triangles, triangleBounds, groups[i].first, groups[i].second);
+			if(groups[i].second - groups[i].first <= LEAF_SIZE) {
+				childStart = groups[i].first;
+				childTriangleCount = groups[i].second - groups[i].first;
+			} else {
+				// may reallocate nodes, so no reference to this node is held across the call
+				childStart = buildNode(triangles, centroids, triangleBounds, groups[i].first, groups[i].second, depth + 1);
+			}
+		}
+
+		Node& node = nodes[nodeIndex];
+		node.xMin[i] = childBounds.min.x;
+		node.yMin[i] = childBounds.min.y;
+		node.zMin[i] = childBounds.min.z;
+		node.xMax[i] = childBounds.max.x;
+		node.yMax[i] = childBounds.max.y;
+		node.zMax[i] = childBounds.max.z;
+		node.childStart[i] = childStart;
+		node.childTriangleCount[i] = childTriangleCount;
+	}
+	nodes[nodeIndex].childCount = groupCount;
+
+	return nodeIndex;
+}
+
+int TriangleBVH::getFirstIntersectedTriangle(const TriangleMesh& mesh, const Vec3& origin, const Vec3& direction, double& distance) const {
+	return castRay(origin, direction, [&mesh, &origin, &direction](int triangleIndex) {
+		Triangle t = mesh.getTriangle(triangleIndex);
+		RayIntersection<double> r = rayTriangleIntersection<double>(origin, direction, mesh.getVertex(t.firstIndex), mesh.getVertex(t.secondIndex), mesh.getVertex(t.thirdIndex));
+		return r.rayIntersectsTriangle() ? r.d : std::numeric_limits<double>::infinity();
+	}, distance);
+}
+
+const TriangleBVH& LazyTriangleBVH::get(const TriangleMesh& mesh) const {
+	const TriangleBVH* existing = bvh.load(std::memory_order_acquire);
+	if(existing != nullptr) return *existing;
+
+	// threads that race here each build one, only the first to finish keeps it
+	const TriangleBVH* built = new TriangleBVH(mesh);
+	if(bvh.compare_exchange_strong(existing, built, std::memory_order_acq_rel, std::memory_order_acquire)) {
+		return *built;
+	}
+	delete built;
+	return *existing;
+}
+};
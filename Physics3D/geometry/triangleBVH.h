@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include "../math/linalg/vec.h"
+#include "../math/boundingBox.h"
+
+#include <limits>
+
+namespace P3D {
+class TriangleMesh;
+
+/*
+	Static bounding volume hierarchy over the triangles of a TriangleMesh, built once and never updated
+	Like a TreeTrunk of the BoundsTree, every node stores the bounds of its children in SoA layout so all children of a node are tested at once
+	A child is either another node, or a leaf of at most LEAF_SIZE consecutive entries of triangleIndices
+*/
+class TriangleBVH {
+public:
+	static constexpr int BRANCH_FACTOR = 8;
+	static constexpr int LEAF_SIZE = 4;
+	// every child holds at most half of the triangles of its parent, so no tree of an int number of triangles is deeper
+	static constexpr int MAX_DEPTH = 32;
+	// a depth first walk holds the unvisited siblings of every node on its path, plus the root
+	static constexpr int MAX_STACK_SIZE = MAX_DEPTH * (BRANCH_FACTOR - 1) + 1;
+
+	struct alignas(32) Node {
+		float xMin[BRANCH_FACTOR];
+		float yMin[BRANCH_FACTOR];
+		float zMin[BRANCH_FACTOR];
+		float xMax[BRANCH_FACTOR];
+		float yMax[BRANCH_FACTOR];
+		float zMax[BRANCH_FACTOR];
+		// index into triangleIndices for leaves, index into nodes for child nodes
+		int childStart[BRANCH_FACTOR];
+		// 0 for child nodes
+		int childTriangleCount[BRANCH_FACTOR];
+		int childCount;
+	};
+
+private:
+	std::vector<Node> nodes;
+	std::vector<int> triangleIndices;
+
+	int buildNode(std::vector<int>& triangles, const std::vector<Vec3f>& centroids, const std::vector<BoundingBoxTemplate<float>>& triangleBounds, int start, int end, int depth);
+
+	// unused children have empty bounds and never overlap
+	static inline void computeOverlaps(const Node& node, const BoundingBoxTemplate<float>& bounds, bool* overlaps) {
+		for(int i = 0; i < BRANCH_FACTOR; i++) {
+			overlaps[i] =
+				node.xMin[i] <= bounds.max.x && node.xMax[i] >= bounds.min.x &&
+				node.yMin[i] <= bounds.max.y && node.yMax[i] >= bounds.min.y &&
+				node.zMin[i] <= bounds.max.z && node.zMax[i] >= bounds.min.z;
+		}
+	}
+
+	static inline void computeRayHits(const Node& node, const Vec3f& origin, const Vec3f& invDirection, float maxDistance, bool* hits) {
+		for(int i = 0; i < BRANCH_FACTOR; i++) {
+			float tx0 = (node.xMin[i] - origin.x) * invDirection.x;
+			float tx1 = (node.xMax[i] - origin.x) * invDirection.x;
+			float ty0 = (node.yMin[i] - origin.y) * invDirection.y;
+			float ty1 = (node.yMax[i] - origin.y) * invDirection.y;
+			float tz0 = (node.zMin[i] - origin.z) * invDirection.z;
+			float tz1 = (node.zMax[i] - origin.z) * invDirection.z;
+			float tNear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::min(tz0, tz1));
+			float tFar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1));
+			hits[i] = tNear <= tFar && tFar >= 0.0f && tNear <= maxDistance;
+		}
+	}
+
+public:
+	TriangleBVH() = default;
+	explicit TriangleBVH(const TriangleMesh& mesh);
+
+	[[nodiscard]] bool empty() const { return nodes.empty(); }
+	[[nodiscard]] std::size_t getNodeCount() const { return nodes.size(); }
+
+	// calls func(triangleIndex) at least for every triangle whose bounds overlap the given bounds, and at most for the other triangles of the same leaves
+	template<typename Func>
+	void forEachTriangleInBounds(const BoundingBoxTemplate<float>& bounds, const Func& func) const {
+		if(nodes.empty()) return;
+
+		int stack[MAX_STACK_SIZE];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while(stackSize != 0) {
+			const Node& node = nodes[stack[--stackSize]];
+
+			bool overlaps[BRANCH_FACTOR];
+			computeOverlaps(node, bounds, overlaps);
+			for(int i = 0; i < node.childCount; i++) {
+				if(!overlaps[i]) continue;
+				if(node.childTriangleCount[i] == 0) {
+					stack[stackSize++] = node.childStart[i];
+				} else {
+					for(int j = node.childStart[i]; j < node.childStart[i] + node.childTriangleCount[i]; j++) {
+						func(triangleIndices[j]);
+					}
+				}
+			}
+		}
+	}
+
+	/*
+		Walks the children hit by the ray origin + t * direction, nearest bounds first is not guaranteed, but children further than the best hit so far are skipped
+		testTriangle(triangleIndex) returns the t at which the ray hits that triangle, or infinity if it misses
+		Returns the index of the triangle with the smallest t, or -1 if none is hit, distance is set to that t
+	*/
+	template<typename TestTriangle>
+	int castRay(const Vec3& origin, const Vec3& direction, const TestTriangle& testTriangle, double& distance) const {
+		int bestTriangle = -1;
+		double bestDistance = std::numeric_limits<double>::infinity();
+		distance = bestDistance;
+		if(nodes.empty()) return bestTriangle;
+
+		// zero components are nudged so every slab test stays finite
+		Vec3f originf(origin);
+		Vec3f invDirection;
+		for(int i = 0; i < 3; i++) {
+			float d = static_cast<float>(direction[i]);
+			invDirection[i] = 1.0f / (d != 0.0f ? d : 1e-30f);
+		}
+
+		int stack[MAX_STACK_SIZE];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while(stackSize != 0) {
+			const Node& node = nodes[stack[--stackSize]];
+
+			bool hits[BRANCH_FACTOR];
+			computeRayHits(node, originf, invDirection, static_cast<float>(bestDistance), hits);
+			for(int i = 0; i < node.childCount; i++) {
+				if(!hits[i]) continue;
+				if(node.childTriangleCount[i] == 0) {
+					stack[stackSize++] = node.childStart[i];
+				} else {
+					for(int j = node.childStart[i]; j < node.childStart[i] + node.childTriangleCount[i]; j++) {
+						double d = testTriangle(triangleIndices[j]);
+						if(d < bestDistance) {
+							bestDistance = d;
+							bestTriangle = triangleIndices[j];
+						}
+					}
+				}
+			}
+		}
+
+		distance = bestDistance;
+		return bestTriangle;
+	}
+
+	/*
+		Returns the index of the first triangle of mesh hit by the ray origin + t * direction with t >= 0, or -1 if none is hit
+		distance is set to the t of that hit
+		mesh must be the mesh this BVH was built from
+	*/
+	[[nodiscard]] int getFirstIntersectedTriangle(const TriangleMesh& mesh, const Vec3& origin, const Vec3& direction, double& distance) const;
+};
+
+/*
+	A TriangleBVH that is only built the first time it is needed, safe to request from multiple threads at once
+	Copies start out unbuilt, as the copy may belong to a different mesh. Moves keep the built BVH, as the triangles move along with it
+*/
+class LazyTriangleBVH {
+	mutable std::atomic<const TriangleBVH*> bvh;
+
+public:
+	LazyTriangleBVH() : bvh(nullptr) {}
+	~LazyTriangleBVH() { delete bvh.load(); }
+	LazyTriangleBVH(const LazyTriangleBVH&) : bvh(nullptr) {}
+	LazyTriangleBVH& operator=(const LazyTriangleBVH& other) {
+		if(this != &other) delete bvh.exchange(nullptr);
+		return *this;
+	}
+	LazyTriangleBVH(LazyTriangleBVH&& other) noexcept : bvh(other.bvh.exchange(nullptr)) {}
+	LazyTriangleBVH& operator=(LazyTriangleBVH&& other) noexcept {
+		if(this != &other) delete bvh.exchange(other.bvh.exchange(nullptr));
+		return *this;
+	}
+
+	[[nodiscard]] bool isBuilt() const { return bvh.load(std::memory_order_acquire) != nullptr; }
+	// builds the BVH of mesh if this is the first call, mesh must be the same every call
+	const TriangleBVH& get(const TriangleMesh& mesh) const;
+};
+};
@@ -9,6 +9,11 @@
 #include <set>
 #include <cmath>
 #include <string.h>
+#include <algorithm>
+#include <limits>
+
+// meshes with fewer triangles are raycast by testing every triangle, a BVH would not pay for itself
+#define INTERSECTION_BVH_MIN_TRIANGLES 256
 
 namespace P3D {
 #pragma region bufManagement
@@ -426,48 +431,70 @@ double TriangleMesh::getScaledMaxRadius(DiagonalMat3 scale) const {
 	return sqrt(getScaledMaxRadiusSq(scale));
 }
 
-double TriangleMesh::getIntersectionDistance(const Vec3& origin, const Vec3& direction) const {
+double TriangleMesh::getTriangleIntersectionDistance(int triangleIndex, const Vec3& origin, const Vec3& direction) const {
 	const double EPSILON = 0.0000001;
-	double t = std::numeric_limits<double>::max();
-	for(Triangle triangle : iterTriangles()) {
-		Vec3 v0 = this->getVertex(triangle.firstIndex);
-		Vec3 v1 = this->getVertex(triangle.secondIndex);
-		Vec3 v2 = this->getVertex(triangle.thirdIndex);
+	Triangle triangle = this->getTriangle(triangleIndex);
+	Vec3 v0 = this->getVertex(triangle.firstIndex);
+	Vec3 v1 = this->getVertex(triangle.secondIndex);
+	Vec3 v2 = this->getVertex(triangle.thirdIndex);
 
-		Vec3 edge1 = v1 - v0;
-		Vec3 edge2 = v2 - v0;
-		Vec3 h = direction % edge2;
+	Vec3 edge1 = v1 - v0;
+	Vec3 edge2 = v2 - v0;
+	Vec3 h = direction % edge2;
 
-		double a = edge1 * h;
-		if(a > -EPSILON && a < EPSILON)
-			continue;
+	double a = edge1 * h;
+	if(a > -EPSILON && a < EPSILON)
+		return std::numeric_limits<double>::max();
 
-		Vec3 s = origin - v0;
-		double f = 1.0 / a;
-		double u = f * (s * h);
+	Vec3 s = origin - v0;
+	double f = 1.0 / a;
+	double u = f * (s * h);
 
-		if(u < 0.0 || u > 1.0)
-			continue;
+	if(u < 0.0 || u > 1.0)
+		return std::numeric_limits<double>::max();
 
-		Vec3 q = s % edge1;
-		double v = direction * f * q;
+	Vec3 q = s % edge1;
+	double v = direction * f * q;
 
-		if(v < 0.0 || u + v > 1.0)
-			continue;
+	if(v < 0.0 || u + v > 1.0)
+		return std::numeric_limits<double>::max();
 
-		double r = edge2 * f * q;
-		if(r > EPSILON) {
-			if(r < t)
-				t = r;
-		} else {
-			//Log::debug("Line intersection but not a ray intersection");
-			continue;
-		}
+	double r = edge2 * f * q;
+	if(r > EPSILON) {
+		return r;
+	} else {
+		//Log::debug("Line intersection but not a ray intersection");
+		return std::numeric_limits<double>::max();
 	}
+}
 
+double TriangleMesh::getIntersectionDistanceFallback(const Vec3& origin, const Vec3& direction) const {
+	double t = std::numeric_limits<double>::max();
+	for(int i = 0; i < this->triangleCount; i++) {
+		double r = getTriangleIntersectionDistance(i, origin, direction);
+		if(r < t)
+			t = r;
+	}
 	return t;
 }
 
+double TriangleMesh::getIntersectionDistance(const Vec3& origin, const Vec3& direction) const {
+	if(this->triangleCount >= INTERSECTION_BVH_MIN_TRIANGLES) {
+		double distance;
+		int hitTriangle = intersectionBVH.get(*this).castRay(origin, direction, [this, &origin, &direction](int triangleIndex) {
+			double r = getTriangleIntersectionDistance(triangleIndex, origin, direction);
+			return r != std::numeric_limits<double>::max() ? r : std::numeric_limits<double>::infinity();
+		}, distance);
+		return hitTriangle != -1 ? distance : std::numeric_limits<double>::max();
+	}
+
+	if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2 | CPUIDCheck::FMA)) {
+		return getIntersectionDistanceAVX(origin, direction);
+	} else {
+		return getIntersectionDistanceFallback(origin, direction);
+	}
+}
+
 
 TriangleMesh stripUnusedVertices(const Vec3f* vertices, const Triangle* triangles, int vertexCount, int triangleCount) {
 	bool* vertexIsReferenced = new bool[vertexCount];
@@ -603,6 +630,53 @@ Vec3f TriangleMesh::furthestInDirection(const Vec3f& direction) const {
 	}
 }
 
+VertexAdjacency TriangleMesh::computeVertexAdjacency() const {
+	std::vector<std::vector<int>> neighbourLists(vertexCount);
+	for(Triangle triangle : iterTriangles()) {
+		for(int i = 0; i < 3; i++) {
+			int a = triangle[i];
+			int b = triangle[(i + 1) % 3];
+			neighbourLists[a].push_back(b);
+			neighbourLists[b].push_back(a);
+		}
+	}
+
+	VertexAdjacency result;
+	result.neighbourStarts.reserve(vertexCount + 1);
+	for(std::vector<int>& list : neighbourLists) {
+		std::sort(list.begin(), list.end());
+		list.erase(std::unique(list.begin(), list.end()), list.end());
+
+		result.neighbourStarts.push_back(static_cast<int>(result.neighbours.size()));
+		result.neighbours.insert(result.neighbours.end(), list.begin(), list.end());
+	}
+	result.neighbourStarts.push_back(static_cast<int>(result.neighbours.size()));
+	return result;
+}
+
+int TriangleMesh::furthestIndexInDirectionHillClimb(const Vec3f& direction, const VertexAdjacency& adjacency, int startIndex) const {
+	int bestVertexIndex = startIndex;
+	float bestDot = this->getVertex(startIndex) * direction;
+
+	// on a convex mesh every vertex that isn't furthest has a neighbour that lies strictly further
+	bool improved = true;
+	while(improved) {
+		improved = false;
+		int neighboursEnd = adjacency.neighbourStarts[bestVertexIndex + 1];
+		for(int i = adjacency.neighbourStarts[bestVertexIndex]; i < neighboursEnd; i++) {
+			int neighbour = adjacency.neighbours[i];
+			float newD = this->getVertex(neighbour) * direction;
+			if(newD > bestDot) {
+				bestDot = newD;
+				bestVertexIndex = neighbour;
+				improved = true;
+			}
+		}
+	}
+
+	return bestVertexIndex;
+}
+
 BoundingBox TriangleMesh::getBounds() const {
 	if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2 | CPUIDCheck::FMA)) {
 		return getBoundsAVX();
@@ -7,7 +7,9 @@
 #include "../math/boundingBox.h"
 #include "../datastructures/alignedPtr.h"
 #include "../datastructures/iteratorFactory.h"
+#include "triangleBVH.h"
 #include <stdint.h>
+#include <vector>
 namespace P3D {
 struct Triangle {
 	union {
@@ -64,6 +66,17 @@ struct ShapeTriangleIter {
 	}
 };
 
+/*
+	Neighbour lists of the vertices of a mesh, stored back to back
+	The neighbours of vertex i are neighbours[neighbourStarts[i]] up to neighbours[neighbourStarts[i+1]]
+*/
+struct VertexAdjacency {
+	std::vector<int> neighbourStarts;
+	std::vector<int> neighbours;
+
+	[[nodiscard]] bool empty() const { return neighbourStarts.empty(); }
+};
+
 class TriangleMesh;
 
 class MeshPrototype {
@@ -103,6 +116,9 @@ public:
 };
 
 class TriangleMesh : public MeshPrototype {
+	// only built for large meshes, by the first getIntersectionDistance call
+	LazyTriangleBVH intersectionBVH;
+
 protected:
 	TriangleMesh(UniqueAlignedPointer<float>&& vertices, UniqueAlignedPointer<int>&& triangles, int vertexCount, int triangleCount);
 
@@ -168,6 +184,24 @@ public:
 	[[nodiscard]] int furthestIndexInDirection(const Vec3f& direction) const;
 	[[nodiscard]] Vec3f furthestInDirection(const Vec3f& direction) const;
 
+	/*
+		Walks the vertex graph from startIndex towards the furthest vertex, only valid for convex meshes
+		Cheaper than a full scan for large meshes, especially when startIndex is the result of a previous similar query
+	*/
+	[[nodiscard]] VertexAdjacency computeVertexAdjacency() const;
+	[[nodiscard]] int furthestIndexInDirectionHillClimb(const Vec3f& direction, const VertexAdjacency& adjacency, int startIndex) const;
+
+	// t of the hit of the ray origin + t * direction with the given triangle, std::numeric_limits<double>::max() if it is missed or the hit lies behind origin
+	[[nodiscard]] double getTriangleIntersectionDistance(int triangleIndex, const Vec3& origin, const Vec3& direction) const;
+
+	[[nodiscard]] double getIntersectionDistanceFallback(const Vec3& origin, const Vec3& direction) const;
+	// tests 8 triangles at once in float, only the triangles that might be hit are retested exactly, so the result equals the fallback
+	[[nodiscard]] double getIntersectionDistanceAVX(const Vec3& origin, const Vec3& direction) const;
+
+	/*
+		Smallest t > 0 at which the ray origin + t * direction hits the mesh, std::numeric_limits<double>::max() if it misses
+		Large meshes build a TriangleBVH on the first call and only test the triangles along the ray from then on
+	*/
 	[[nodiscard]] double getIntersectionDistance(const Vec3& origin, const Vec3& direction) const;
 };
 
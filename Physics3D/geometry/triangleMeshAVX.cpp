@@ -2,6 +2,7 @@
 #include "triangleMeshCommon.h"
 
 #include <immintrin.h>
+#include <limits>
 
 // AVX2 implementation for TriangleMesh functions
 namespace P3D {
@@ -226,4 +227,96 @@ BoundingBox TriangleMesh::getBoundsAVX(const Mat3f& referenceFrame) const {
 
 	return toBounds(xMin, xMax, yMin, yMax, zMin, zMax);
 }
+
+// vertex i lives at vertices[(i / 8) * 24 + i % 8], its y and z at +8 and +16
+static inline __m256i vertexOffsets(__m256i vertexIndices) {
+	__m256i blockStart = _mm256_andnot_si256(_mm256_set1_epi32(7), vertexIndices);
+	return _mm256_add_epi32(vertexIndices, _mm256_slli_epi32(blockStart, 1));
+}
+
+static inline void gatherVertices(const float* vertices, __m256i vertexIndices, __m256& x, __m256& y, __m256& z) {
+	__m256i offsets = vertexOffsets(vertexIndices);
+	x = _mm256_i32gather_ps(vertices, offsets, 4);
+	y = _mm256_i32gather_ps(vertices + 8, offsets, 4);
+	z = _mm256_i32gather_ps(vertices + 16, offsets, 4);
+}
+
+/*
+	Moller-Trumbore on 8 triangles at once in float, with barycentric coordinates allowed slightly outside of the triangle
+	The few triangles that pass, and those too close to parallel to the ray to judge in float, are retested in double by getTriangleIntersectionDistance
+*/
+double TriangleMesh::getIntersectionDistanceAVX(const Vec3& origin, const Vec3& direction) const {
+	const float BARYCENTRIC_TOLERANCE = 0.001f;
+	const float PARALLEL_TOLERANCE = 0.000001f;
+
+	__m256 ox = _mm256_set1_ps(static_cast<float>(origin.x));
+	__m256 oy = _mm256_set1_ps(static_cast<float>(origin.y));
+	__m256 oz = _mm256_set1_ps(static_cast<float>(origin.z));
+	__m256 dx = _mm256_set1_ps(static_cast<float>(direction.x));
+	__m256 dy = _mm256_set1_ps(static_cast<float>(direction.y));
+	__m256 dz = _mm256_set1_ps(static_cast<float>(direction.z));
+
+	__m256 lowerBound = _mm256_set1_ps(-BARYCENTRIC_TOLERANCE);
+	__m256 upperBound = _mm256_set1_ps(1.0f + BARYCENTRIC_TOLERANCE);
+	__m256 parallelBound = _mm256_set1_ps(PARALLEL_TOLERANCE);
+	__m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	double t = std::numeric_limits<double>::max();
+	const int* triangleBuf = this->triangles;
+	for(int blockI = 0; blockI < (this->triangleCount + 7) / 8; blockI++) {
+		// the padding after the last triangle is not initialized, those lanes read vertex 0 instead
+		__m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(this->triangleCount - blockI * 8), laneIndices);
+		__m256i i0 = _mm256_and_si256(valid, _mm256_load_si256(reinterpret_cast<const __m256i*>(triangleBuf + blockI * 24)));
+		__m256i i1 = _mm256_and_si256(valid, _mm256_load_si256(reinterpret_cast<const __m256i*>(triangleBuf + blockI * 24 + 8)));
+		__m256i i2 = _mm256_and_si256(valid, _mm256_load_si256(reinterpret_cast<const __m256i*>(triangleBuf + blockI * 24 + 16)));
+
+		__m256 x0, y0, z0, x1, y1, z1, x2, y2, z2;
+		gatherVertices(this->vertices, i0, x0, y0, z0);
+		gatherVertices(this->vertices, i1, x1, y1, z1);
+		gatherVertices(this->vertices, i2, x2, y2, z2);
+
+		__m256 e1x = _mm256_sub_ps(x1, x0);
+		__m256 e1y = _mm256_sub_ps(y1, y0);
+		__m256 e1z = _mm256_sub_ps(z1, z0);
+		__m256 e2x = _mm256_sub_ps(x2, x0);
+		__m256 e2y = _mm256_sub_ps(y2, y0);
+		__m256 e2z = _mm256_sub_ps(z2, z0);
+
+		// h = direction % edge2
+		__m256 hx = _mm256_fmsub_ps(dy, e2z, _mm256_mul_ps(dz, e2y));
+		__m256 hy = _mm256_fmsub_ps(dz, e2x, _mm256_mul_ps(dx, e2z));
+		__m256 hz = _mm256_fmsub_ps(dx, e2y, _mm256_mul_ps(dy, e2x));
+		__m256 a = _mm256_fmadd_ps(e1z, hz, _mm256_fmadd_ps(e1y, hy, _mm256_mul_ps(e1x, hx)));
+
+		__m256 sx = _mm256_sub_ps(ox, x0);
+		__m256 sy = _mm256_sub_ps(oy, y0);
+		__m256 sz = _mm256_sub_ps(oz, z0);
+		__m256 f = _mm256_div_ps(_mm256_set1_ps(1.0f), a);
+		__m256 u = _mm256_mul_ps(f, _mm256_fmadd_ps(sz, hz, _mm256_fmadd_ps(sy, hy, _mm256_mul_ps(sx, hx))));
+
+		// q = s % edge1
+		__m256 qx = _mm256_fmsub_ps(sy, e1z, _mm256_mul_ps(sz, e1y));
+		__m256 qy = _mm256_fmsub_ps(sz, e1x, _mm256_mul_ps(sx, e1z));
+		__m256 qz = _mm256_fmsub_ps(sx, e1y, _mm256_mul_ps(sy, e1x));
+		__m256 v = _mm256_mul_ps(f, _mm256_fmadd_ps(dz, qz, _mm256_fmadd_ps(dy, qy, _mm256_mul_ps(dx, qx))));
+
+		__m256 inside = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(u, lowerBound, _CMP_GE_OQ), _mm256_cmp_ps(v, lowerBound, _CMP_GE_OQ)),
+			_mm256_cmp_ps(_mm256_add_ps(u, v), upperBound, _CMP_LE_OQ)
+		);
+		__m256 nearlyParallel = _mm256_cmp_ps(_mm256_and_ps(a, absMask), parallelBound, _CMP_LT_OQ);
+		__m256 candidates = _mm256_and_ps(_mm256_or_ps(inside, nearlyParallel), _mm256_castsi256_ps(valid));
+
+		uint32_t mask = _mm256_movemask_ps(candidates);
+		while(mask != 0) {
+			int lane = countZeros(mask);
+			mask &= mask - 1;
+			double r = getTriangleIntersectionDistance(blockI * 8 + lane, origin, direction);
+			if(r < t)
+				t = r;
+		}
+	}
+	return t;
+}
 };
@@ -9,6 +9,7 @@ public:
 
 	virtual void update(double deltaT) override;
 	virtual void invert() override;
+	virtual bool isMoving() const override { return false; }
 
 	virtual CFrame getRelativeCFrame() const override;
 	virtual RelativeMotion getRelativeMotion() const override;
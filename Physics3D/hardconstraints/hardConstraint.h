@@ -14,6 +14,8 @@ public:
 	bool isInverted = false;
 	virtual void update(double deltaT) = 0;
 	virtual void invert() { isInverted = !isInverted; }
+	// constraints that never change their relative motion may return false, so the mass properties of the physicals they connect needn't be recomputed every tick
+	virtual bool isMoving() const { return true; }
 	virtual RelativeMotion getRelativeMotion() const = 0;
 
 	virtual CFrame getRelativeCFrame() const = 0;
@@ -96,6 +96,7 @@ void WorldLayer::moveOutOfGroup(Part* part) {
 void WorldLayer::removePart(Part* partToRemove) {
 	assert(partToRemove->layer == this);
 	tree.remove(partToRemove);
+	parent->world->contactCache.forgetPart(partToRemove);
 	parent->world->onPartRemoved(partToRemove);
 	partToRemove->layer = nullptr;
 }
@@ -172,28 +173,6 @@ void ColissionLayer::refresh() {
 
 
 
-static bool boundsSphereEarlyEnd(const DiagonalMat3& scale, const Vec3& sphereCenter, double sphereRadius) {
-	return std::abs(sphereCenter.x) > scale[0] + sphereRadius || std::abs(sphereCenter.y) > scale[1] + sphereRadius || std::abs(sphereCenter.z) > scale[2] + sphereRadius;
-}
-
-static bool runColissionPreTests(const Part& p1, const Part& p2) {
-	Vec3 offset = p1.getPosition() - p2.getPosition();
-	if(isLongerThan(offset, p1.maxRadius + p2.maxRadius)) {
-		intersectionStatistics.addToTally(IntersectionResult::PART_DISTANCE_REJECT, 1);
-		return false;
-	}
-	if(boundsSphereEarlyEnd(p1.hitbox.scale, p1.getCFrame().globalToLocal(p2.getPosition()), p2.maxRadius)) {
-		intersectionStatistics.addToTally(IntersectionResult::PART_BOUNDS_REJECT, 1);
-		return false;
-	}
-	if(boundsSphereEarlyEnd(p2.hitbox.scale, p2.getCFrame().globalToLocal(p1.getPosition()), p1.maxRadius)) {
-		intersectionStatistics.addToTally(IntersectionResult::PART_BOUNDS_REJECT, 1);
-		return false;
-	}
-
-	return true;
-}
-
 static void findColissionsBetween(std::vector<Colission>& colissions, const BoundsTree<Part>& treeA, const BoundsTree<Part>& treeB) {
 	treeA.forEachColissionWith(treeB, [&colissions](Part* a, Part* b) {
 		colissions.push_back(Colission{a, b});
@@ -214,4 +193,33 @@ void getColissionsBetween(const ColissionLayer& a, const ColissionLayer& b, Coli
 	findColissionsBetween(curColissions.freeTerrainColissions, a.subLayers[0].tree, b.subLayers[1].tree);
 	findColissionsBetween(curColissions.freeTerrainColissions, b.subLayers[0].tree, a.subLayers[1].tree);
 }
+
+static void findSweptColissionsWith(std::vector<Colission>& colissions, Part* part, const BoundsTemplate<float>& sweptBounds, const BoundsTree<Part>& tree) {
+	tree.forEachColissionWith(part, sweptBounds, [&colissions](Part* a, Part* b) {
+		colissions.push_back(Colission{a, b});
+	});
+}
+void getSweptColissionCandidates(Part* freePart, const BoundsTemplate<float>& sweptBounds, std::vector<Colission>& freeCandidates, std::vector<Colission>& terrainCandidates) {
+	const ColissionLayer* layer = freePart->layer->parent;
+	const WorldPrototype* world = layer->world;
+	int layerID = layer->getID();
+
+	if(layer->collidesInternally) {
+		findSweptColissionsWith(freeCandidates, freePart, sweptBounds, layer->subLayers[ColissionLayer::FREE_PARTS_LAYER].tree);
+		findSweptColissionsWith(terrainCandidates, freePart, sweptBounds, layer->subLayers[ColissionLayer::TERRAIN_PARTS_LAYER].tree);
+	}
+	for(std::pair<int, int> collidingLayers : world->colissionMask) {
+		int otherID;
+		if(collidingLayers.first == layerID) {
+			otherID = collidingLayers.second;
+		} else if(collidingLayers.second == layerID) {
+			otherID = collidingLayers.first;
+		} else {
+			continue;
+		}
+		const ColissionLayer& other = world->layers[otherID];
+		findSweptColissionsWith(freeCandidates, freePart, sweptBounds, other.subLayers[ColissionLayer::FREE_PARTS_LAYER].tree);
+		findSweptColissionsWith(terrainCandidates, freePart, sweptBounds, other.subLayers[ColissionLayer::TERRAIN_PARTS_LAYER].tree);
+	}
+}
 };
\ No newline at end of file
@@ -112,4 +112,9 @@ public:
 	int getID() const;
 };
 void getColissionsBetween(const ColissionLayer& a, const ColissionLayer& b, ColissionBuffer& curColissions);
+/*
+	Adds every part that the free part could collide with and whose bounds overlap sweptBounds as a candidate, following the same layer rules as the regular colission search
+	Candidates include the part itself and the other parts of it's physical
+*/
+void getSweptColissionCandidates(Part* freePart, const BoundsTemplate<float>& sweptBounds, std::vector<Colission>& freeCandidates, std::vector<Colission>& terrainCandidates);
 };
@@ -0,0 +1,142 @@
+#include "midphase.h"
+
+#include "math/linalg/vec.h"
+#include "math/linalg/mat.h"
+
+#include "misc/physicsProfiler.h"
+#include "misc/cpuid.h"
+
+#include <cmath>
+
+namespace P3D {
+static bool boundsSphereEarlyEnd(const DiagonalMat3& scale, const Vec3& sphereCenter, double sphereRadius) {
+	return std::abs(sphereCenter.x) > scale[0] + sphereRadius || std::abs(sphereCenter.y) > scale[1] + sphereRadius || std::abs(sphereCenter.z) > scale[2] + sphereRadius;
+}
+
+bool runColissionPreTests(const Part& p1, const Part& p2) {
+	Vec3 offset = p1.getPosition() - p2.getPosition();
+	if(isLongerThan(offset, p1.maxRadius + p2.maxRadius)) {
+		intersectionStatistics.addToTally(IntersectionResult::PART_DISTANCE_REJECT, 1);
+		return false;
+	}
+	if(boundsSphereEarlyEnd(p1.hitbox.scale, p1.getCFrame().globalToLocal(p2.getPosition()), p2.maxRadius)) {
+		intersectionStatistics.addToTally(IntersectionResult::PART_BOUNDS_REJECT, 1);
+		return false;
+	}
+	if(boundsSphereEarlyEnd(p2.hitbox.scale, p2.getCFrame().globalToLocal(p1.getPosition()), p1.maxRadius)) {
+		intersectionStatistics.addToTally(IntersectionResult::PART_BOUNDS_REJECT, 1);
+		return false;
+	}
+
+	return true;
+}
+
+void MidphaseBuffer::gather(const std::vector<Colission>& colissions) {
+	size = colissions.size();
+	paddedSize = (size + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE;
+
+	// padding lanes are zeroed, they always pass and are ignored
+	data.assign(paddedSize * COMPONENT_COUNT, 0.0f);
+	results.resize(paddedSize);
+
+	float* offset[3]{get(OFFSET_X), get(OFFSET_Y), get(OFFSET_Z)};
+	float* radius1 = get(RADIUS_1);
+	float* radius2 = get(RADIUS_2);
+	float* scale1[3]{get(SCALE_1_X), get(SCALE_1_Y), get(SCALE_1_Z)};
+	float* scale2[3]{get(SCALE_2_X), get(SCALE_2_Y), get(SCALE_2_Z)};
+	float* rot1 = get(ROT_1_00);
+	float* rot2 = get(ROT_2_00);
+
+	for(std::size_t i = 0; i < size; i++) {
+		const Part& p1 = *colissions[i].p1;
+		const Part& p2 = *colissions[i].p2;
+
+		Vec3 d = p1.getPosition() - p2.getPosition();
+		Mat3 r1 = p1.getCFrame().getRotation().asRotationMatrix();
+		Mat3 r2 = p2.getCFrame().getRotation().asRotationMatrix();
+
+		for(std::size_t axis = 0; axis < 3; axis++) {
+			offset[axis][i] = static_cast<float>(d[axis]);
+			scale1[axis][i] = static_cast<float>(p1.hitbox.scale[axis]);
+			scale2[axis][i] = static_cast<float>(p2.hitbox.scale[axis]);
+		}
+		radius1[i] = static_cast<float>(p1.maxRadius);
+		radius2[i] = static_cast<float>(p2.maxRadius);
+
+		for(std::size_t row = 0; row < 3; row++) {
+			for(std::size_t col = 0; col < 3; col++) {
+				rot1[(row * 3 + col) * paddedSize + i] = static_cast<float>(r1(row, col));
+				rot2[(row * 3 + col) * paddedSize + i] = static_cast<float>(r2(row, col));
+			}
+		}
+	}
+}
+
+void runMidphaseTestsFallback(MidphaseBuffer& buffer) {
+	const float* dx = buffer.get(MidphaseBuffer::OFFSET_X);
+	const float* dy = buffer.get(MidphaseBuffer::OFFSET_Y);
+	const float* dz = buffer.get(MidphaseBuffer::OFFSET_Z);
+	const float* radius1 = buffer.get(MidphaseBuffer::RADIUS_1);
+	const float* radius2 = buffer.get(MidphaseBuffer::RADIUS_2);
+	const float* rot1 = buffer.get(MidphaseBuffer::ROT_1_00);
+	const float* rot2 = buffer.get(MidphaseBuffer::ROT_2_00);
+	const float* scale1 = buffer.get(MidphaseBuffer::SCALE_1_X);
+	const float* scale2 = buffer.get(MidphaseBuffer::SCALE_2_X);
+	std::size_t stride = buffer.paddedSize;
+
+	for(std::size_t i = 0; i < buffer.size; i++) {
+		float radiusSum = (radius1[i] + radius2[i]) * MidphaseBuffer::TOLERANCE;
+		float distSq = dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i];
+		if(distSq > radiusSum * radiusSum) {
+			buffer.results[i] = MidphaseResult::DISTANCE_REJECT;
+			continue;
+		}
+
+		bool outsideBounds = false;
+		for(std::size_t axis = 0; axis < 3; axis++) {
+			// column axis of each rotation, transposed rotation times the offset gives the other part's center in local space
+			float local2In1 = dx[i] * rot1[(0 + axis) * stride + i] + dy[i] * rot1[(3 + axis) * stride + i] + dz[i] * rot1[(6 + axis) * stride + i];
+			float local1In2 = dx[i] * rot2[(0 + axis) * stride + i] + dy[i] * rot2[(3 + axis) * stride + i] + dz[i] * rot2[(6 + axis) * stride + i];
+			outsideBounds |= std::abs(local2In1) > (scale1[axis * stride + i] + radius2[i]) * MidphaseBuffer::TOLERANCE;
+			outsideBounds |= std::abs(local1In2) > (scale2[axis * stride + i] + radius1[i]) * MidphaseBuffer::TOLERANCE;
+		}
+		buffer.results[i] = outsideBounds ? MidphaseResult::BOUNDS_REJECT : MidphaseResult::PASS;
+	}
+}
+
+void runMidphaseTests(MidphaseBuffer& buffer) {
+	if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2 | CPUIDCheck::FMA)) {
+		runMidphaseTestsAVX(buffer);
+	} else {
+		runMidphaseTestsFallback(buffer);
+	}
+}
+
+void filterColissionsMidphase(std::vector<Colission>& colissions) {
+	thread_local MidphaseBuffer buffer;
+
+	buffer.gather(colissions);
+	runMidphaseTests(buffer);
+
+	std::size_t distanceRejects = 0;
+	std::size_t boundsRejects = 0;
+	std::size_t kept = 0;
+	for(std::size_t i = 0; i < buffer.size; i++) {
+		switch(buffer.results[i]) {
+		case MidphaseResult::PASS:
+			colissions[kept++] = colissions[i];
+			break;
+		case MidphaseResult::DISTANCE_REJECT:
+			distanceRejects++;
+			break;
+		case MidphaseResult::BOUNDS_REJECT:
+			boundsRejects++;
+			break;
+		}
+	}
+	colissions.resize(kept);
+
+	intersectionStatistics.addToTally(IntersectionResult::PART_DISTANCE_REJECT, distanceRejects);
+	intersectionStatistics.addToTally(IntersectionResult::PART_BOUNDS_REJECT, boundsRejects);
+}
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "part.h"
+#include "colissionBuffer.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace P3D {
+enum class MidphaseResult : uint8_t {
+	PASS,
+	DISTANCE_REJECT,
+	BOUNDS_REJECT
+};
+
+/*
+	Structure of arrays holding everything the midphase tests need of a list of colissions
+	Every component is stored in it's own block of paddedSize floats, paddedSize is a multiple of BATCH_SIZE so the AVX kernel never needs a scalar tail
+	offset is p1.getPosition() - p2.getPosition(), rotations are stored row major
+*/
+struct MidphaseBuffer {
+	static constexpr std::size_t BATCH_SIZE = 8;
+	// the tests run in single precision, thresholds are widened by this factor so rounding never rejects a touching pair
+	static constexpr float TOLERANCE = 1.0001f;
+
+	enum Component {
+		OFFSET_X, OFFSET_Y, OFFSET_Z,
+		RADIUS_1, RADIUS_2,
+		SCALE_1_X, SCALE_1_Y, SCALE_1_Z,
+		SCALE_2_X, SCALE_2_Y, SCALE_2_Z,
+		ROT_1_00, ROT_1_01, ROT_1_02, ROT_1_10, ROT_1_11, ROT_1_12, ROT_1_20, ROT_1_21, ROT_1_22,
+		ROT_2_00, ROT_2_01, ROT_2_02, ROT_2_10, ROT_2_11, ROT_2_12, ROT_2_20, ROT_2_21, ROT_2_22,
+		COMPONENT_COUNT
+	};
+
+	std::vector<float> data;
+	std::vector<MidphaseResult> results;
+	std::size_t size = 0;
+	std::size_t paddedSize = 0;
+
+	inline float* get(Component component) { return data.data() + component * paddedSize; }
+	inline const float* get(Component component) const { return data.data() + component * paddedSize; }
+
+	void gather(const std::vector<Colission>& colissions);
+};
+
+/*
+	Scalar reference of the midphase, a bounding sphere test followed by testing each part's bounding sphere against the other's oriented box
+	returns false if the parts can't possibly intersect
+*/
+bool runColissionPreTests(const Part& p1, const Part& p2);
+
+void runMidphaseTestsFallback(MidphaseBuffer& buffer);
+void runMidphaseTestsAVX(MidphaseBuffer& buffer);
+void runMidphaseTests(MidphaseBuffer& buffer);
+
+/*
+	Removes all colissions that fail the midphase tests, keeping the order of the survivors
+	Meant to run on the raw broadphase output, before handing it to GJK
+*/
+void filterColissionsMidphase(std::vector<Colission>& colissions);
+};
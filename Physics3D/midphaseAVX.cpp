@@ -0,0 +1,66 @@
+#include "midphase.h"
+
+#include <immintrin.h>
+
+// AVX implementation of the midphase tests, handles MidphaseBuffer::BATCH_SIZE colissions per iteration
+namespace P3D {
+static inline __m256 mm256_abs_ps(__m256 v) {
+	return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+}
+
+// transposed rotation times the offset, for one local axis
+static inline __m256 localAxis(const float* rot, std::size_t stride, std::size_t i, std::size_t axis, __m256 dx, __m256 dy, __m256 dz) {
+	__m256 r0 = _mm256_loadu_ps(rot + (0 + axis) * stride + i);
+	__m256 r1 = _mm256_loadu_ps(rot + (3 + axis) * stride + i);
+	__m256 r2 = _mm256_loadu_ps(rot + (6 + axis) * stride + i);
+	return _mm256_fmadd_ps(dz, r2, _mm256_fmadd_ps(dy, r1, _mm256_mul_ps(dx, r0)));
+}
+
+void runMidphaseTestsAVX(MidphaseBuffer& buffer) {
+	const float* dxs = buffer.get(MidphaseBuffer::OFFSET_X);
+	const float* dys = buffer.get(MidphaseBuffer::OFFSET_Y);
+	const float* dzs = buffer.get(MidphaseBuffer::OFFSET_Z);
+	const float* radius1s = buffer.get(MidphaseBuffer::RADIUS_1);
+	const float* radius2s = buffer.get(MidphaseBuffer::RADIUS_2);
+	const float* rot1 = buffer.get(MidphaseBuffer::ROT_1_00);
+	const float* rot2 = buffer.get(MidphaseBuffer::ROT_2_00);
+	const float* scale1 = buffer.get(MidphaseBuffer::SCALE_1_X);
+	const float* scale2 = buffer.get(MidphaseBuffer::SCALE_2_X);
+	std::size_t stride = buffer.paddedSize;
+
+	const __m256 tolerance = _mm256_set1_ps(MidphaseBuffer::TOLERANCE);
+
+	for(std::size_t i = 0; i < buffer.paddedSize; i += MidphaseBuffer::BATCH_SIZE) {
+		__m256 dx = _mm256_loadu_ps(dxs + i);
+		__m256 dy = _mm256_loadu_ps(dys + i);
+		__m256 dz = _mm256_loadu_ps(dzs + i);
+		__m256 radius1 = _mm256_loadu_ps(radius1s + i);
+		__m256 radius2 = _mm256_loadu_ps(radius2s + i);
+
+		__m256 radiusSum = _mm256_mul_ps(_mm256_add_ps(radius1, radius2), tolerance);
+		__m256 distSq = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+		int distanceRejects = _mm256_movemask_ps(_mm256_cmp_ps(distSq, _mm256_mul_ps(radiusSum, radiusSum), _CMP_GT_OQ));
+
+		__m256 outside = _mm256_setzero_ps();
+		for(std::size_t axis = 0; axis < 3; axis++) {
+			__m256 local2In1 = mm256_abs_ps(localAxis(rot1, stride, i, axis, dx, dy, dz));
+			__m256 local1In2 = mm256_abs_ps(localAxis(rot2, stride, i, axis, dx, dy, dz));
+			__m256 limit1 = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(scale1 + axis * stride + i), radius2), tolerance);
+			__m256 limit2 = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(scale2 + axis * stride + i), radius1), tolerance);
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(local2In1, limit1, _CMP_GT_OQ));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(local1In2, limit2, _CMP_GT_OQ));
+		}
+		int boundsRejects = _mm256_movemask_ps(outside);
+
+		for(std::size_t lane = 0; lane < MidphaseBuffer::BATCH_SIZE; lane++) {
+			if(distanceRejects & (1 << lane)) {
+				buffer.results[i + lane] = MidphaseResult::DISTANCE_REJECT;
+			} else if(boundsRejects & (1 << lane)) {
+				buffer.results[i + lane] = MidphaseResult::BOUNDS_REJECT;
+			} else {
+				buffer.results[i + lane] = MidphaseResult::PASS;
+			}
+		}
+	}
+}
+};
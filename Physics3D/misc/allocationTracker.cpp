@@ -0,0 +1,84 @@
+#include "allocationTracker.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace P3D {
+// constant initialized, so it can count allocations made while other globals are constructed
+AllocationTracker allocationTracker;
+
+void AllocationTracker::enable() {
+	for(PhaseCounters& counters : phases) {
+		counters.allocations.store(0, std::memory_order_relaxed);
+		counters.frees.store(0, std::memory_order_relaxed);
+		counters.bytes.store(0, std::memory_order_relaxed);
+	}
+	enabled.store(true, std::memory_order_relaxed);
+}
+
+void AllocationTracker::disable() {
+	enabled.store(false, std::memory_order_relaxed);
+}
+
+void AllocationTracker::takeCounts(AllocationCounts* counts, std::size_t phaseCount) {
+	for(std::size_t i = 0; i < phaseCount && i < MAX_PHASES; i++) {
+		counts[i].allocations = phases[i].allocations.exchange(0, std::memory_order_relaxed);
+		counts[i].frees = phases[i].frees.exchange(0, std::memory_order_relaxed);
+		counts[i].bytes = phases[i].bytes.exchange(0, std::memory_order_relaxed);
+	}
+	phases[MAX_PHASES].allocations.store(0, std::memory_order_relaxed);
+	phases[MAX_PHASES].frees.store(0, std::memory_order_relaxed);
+	phases[MAX_PHASES].bytes.store(0, std::memory_order_relaxed);
+}
+};
+
+// The replaceable global allocation functions, the array and nothrow forms of the standard library forward to these
+void* operator new(std::size_t size) {
+	P3D::allocationTracker.countAllocation(size);
+	void* result = std::malloc(size != 0 ? size : 1);
+	if(result == nullptr) throw std::bad_alloc();
+	return result;
+}
+
+void operator delete(void* ptr) noexcept {
+	if(ptr == nullptr) return;
+	P3D::allocationTracker.countFree();
+	std::free(ptr);
+}
+
+// the sized forms are replaced too, a standard library may implement them without going through the unsized ones
+void operator delete(void* ptr, std::size_t) noexcept {
+	::operator delete(ptr);
+}
+
+// over-aligned types, such as the nodes of a TriangleBVH
+void* operator new(std::size_t size, std::align_val_t align) {
+	P3D::allocationTracker.countAllocation(size);
+	std::size_t alignment = static_cast<std::size_t>(align);
+#ifdef _MSC_VER
+	void* result = _aligned_malloc(size != 0 ? size : 1, alignment);
+#else
+	// aligned_alloc wants a multiple of the alignment
+	void* result = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment + (size == 0 ? alignment : 0));
+#endif
+	if(result == nullptr) throw std::bad_alloc();
+	return result;
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+	if(ptr == nullptr) return;
+	P3D::allocationTracker.countFree();
+#ifdef _MSC_VER
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t align) noexcept {
+	::operator delete(ptr, align);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace P3D {
+struct AllocationCounts {
+	long long allocations = 0;
+	long long frees = 0;
+	// frees don't know their size, so only allocated bytes are counted
+	long long bytes = 0;
+
+	inline AllocationCounts operator+(const AllocationCounts& other) const {
+		return AllocationCounts{allocations + other.allocations, frees + other.frees, bytes + other.bytes};
+	}
+	inline AllocationCounts operator-(const AllocationCounts& other) const {
+		return AllocationCounts{allocations - other.allocations, frees - other.frees, bytes - other.bytes};
+	}
+	inline void operator+=(const AllocationCounts& other) {
+		allocations += other.allocations;
+		frees += other.frees;
+		bytes += other.bytes;
+	}
+	inline AllocationCounts operator/(std::size_t divisor) const {
+		long long d = static_cast<long long>(divisor);
+		return AllocationCounts{allocations / d, frees / d, bytes / d};
+	}
+};
+
+/*
+	Counts the heap allocations of every thread, through the global operator new and delete and through aligned_malloc
+	Allocations are attributed to the phase the ticking thread is in, so the work helper threads do in a phase counts for it too
+	The hooks are always linked in, but do nothing but check a flag while the tracker is disabled
+	Allocations of the standard library that bypass operator new, such as those of std::thread, are not seen
+*/
+class AllocationTracker {
+public:
+	static constexpr std::size_t MAX_PHASES = 32;
+
+private:
+	// every phase on its own cache line, so threads counting in different phases don't contend
+	struct alignas(64) PhaseCounters {
+		std::atomic<long long> allocations{0};
+		std::atomic<long long> frees{0};
+		std::atomic<long long> bytes{0};
+	};
+
+	std::atomic<bool> enabled{false};
+	std::atomic<int> currentPhase{-1};
+	// the last one counts everything outside of a phase
+	PhaseCounters phases[MAX_PHASES + 1];
+
+	inline PhaseCounters& getCurrentCounters() {
+		int phase = currentPhase.load(std::memory_order_relaxed);
+		return phases[phase >= 0 && phase < static_cast<int>(MAX_PHASES) ? phase : MAX_PHASES];
+	}
+
+public:
+	inline bool isEnabled() const {
+		return enabled.load(std::memory_order_relaxed);
+	}
+	void enable();
+	void disable();
+
+	// called by the thread that ticks, -1 outside of any phase
+	inline void setPhase(int phase) {
+		currentPhase.store(phase, std::memory_order_relaxed);
+	}
+
+	inline void countAllocation(std::size_t size) {
+		if(!isEnabled()) return;
+		PhaseCounters& counters = getCurrentCounters();
+		counters.allocations.fetch_add(1, std::memory_order_relaxed);
+		counters.bytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+	}
+	inline void countFree() {
+		if(!isEnabled()) return;
+		getCurrentCounters().frees.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// writes the counts of the first phaseCount phases since the last call to counts and resets them, counts outside of any phase are dropped
+	void takeCounts(AllocationCounts* counts, std::size_t phaseCount);
+};
+
+extern AllocationTracker allocationTracker;
+};
@@ -5,6 +5,7 @@
 #endif
 
 #include <stdint.h>
+#include <string.h>
 
 namespace P3D {
 class CPUID {
@@ -50,6 +51,20 @@ CPUIDCheck::CPUIDCheck() : available(0) {
 		if(cpuid7.EBX() & (1 << 5)) this->available |= AVX2;
 		if(cpuid7.EBX() & (1 << 16)) this->available |= AVX512_F;
 	}
+
+	brand[0] = '\0';
+	CPUID extended(0x80000000, 0);
+	if(extended.EAX() >= 0x80000004) {
+		char buf[49];
+		for(unsigned i = 0; i < 3; i++) {
+			CPUID part(0x80000002 + i, 0);
+			memcpy(buf + i * 16, &part.EAX(), 16);
+		}
+		buf[48] = '\0';
+		const char* start = buf;
+		while(*start == ' ') start++;
+		strcpy(brand, start);
+	}
 }
 
 CPUIDCheck CPUIDCheck::availableCPUHardware;
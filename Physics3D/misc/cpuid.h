@@ -3,6 +3,7 @@
 namespace P3D {
 class CPUIDCheck {
 	unsigned int available;
+	char brand[49];
 
 	CPUIDCheck();
 
@@ -37,6 +38,11 @@ public:
 	inline static void disableTechnology(unsigned int technologies) {
 		availableCPUHardware.available &= ~technologies;
 	}
+
+	// processor brand string such as "Intel(R) Core(TM) i7-8700K CPU @ 3.70GHz", empty if the CPU doesn't report one
+	inline static const char* getBrandString() {
+		return availableCPUHardware.brand;
+	}
 };
 
 };
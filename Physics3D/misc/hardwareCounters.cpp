@@ -0,0 +1,118 @@
+#include "hardwareCounters.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace P3D {
+const char* hardwareCounterLabels[HARDWARE_COUNTER_COUNT]{
+	"Cycles",
+	"Instructions",
+	"Cache misses",
+	"Branch misses",
+	"dTLB misses"
+};
+
+HardwareCounters::HardwareCounters() {
+	for(std::size_t i = 0; i < HARDWARE_COUNTER_COUNT; i++) {
+		fds[i] = -1;
+		groupIndex[i] = -1;
+	}
+}
+
+HardwareCounters::~HardwareCounters() {
+	close();
+}
+
+#ifdef __linux__
+static int openCounter(std::uint32_t type, std::uint64_t config, int groupFd) {
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	// the group starts once all counters are in it
+	attr.disabled = groupFd == -1 ? 1 : 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+bool HardwareCounters::open() {
+	close();
+
+	struct CounterConfig {
+		std::uint32_t type;
+		std::uint64_t config;
+	};
+	const CounterConfig configs[HARDWARE_COUNTER_COUNT]{
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+		{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+		{PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)}
+	};
+
+	for(std::size_t i = 0; i < HARDWARE_COUNTER_COUNT; i++) {
+		int fd = openCounter(configs[i].type, configs[i].config, groupFd);
+		if(fd == -1) continue;
+		if(groupFd == -1) groupFd = fd;
+		fds[i] = fd;
+		groupIndex[i] = openCount++;
+	}
+	if(groupFd == -1) return false;
+
+	ownerThread = std::this_thread::get_id();
+	ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+}
+
+void HardwareCounters::close() {
+	for(std::size_t i = 0; i < HARDWARE_COUNTER_COUNT; i++) {
+		if(fds[i] != -1) ::close(fds[i]);
+		fds[i] = -1;
+		groupIndex[i] = -1;
+	}
+	groupFd = -1;
+	openCount = 0;
+}
+
+HardwareCounterValues HardwareCounters::read() const {
+	HardwareCounterValues result;
+	if(groupFd == -1) return result;
+
+	// layout of PERF_FORMAT_GROUP with both times: counter count, time enabled, time running, then the counters in the order they were opened
+	std::uint64_t data[3 + HARDWARE_COUNTER_COUNT];
+	ssize_t readBytes = ::read(groupFd, data, sizeof(std::uint64_t) * (3 + openCount));
+	if(readBytes != static_cast<ssize_t>(sizeof(std::uint64_t) * (3 + openCount))) return result;
+
+	std::uint64_t timeEnabled = data[1];
+	std::uint64_t timeRunning = data[2];
+	double scale = timeRunning != 0 && timeRunning < timeEnabled ? static_cast<double>(timeEnabled) / timeRunning : 1.0;
+	for(std::size_t i = 0; i < HARDWARE_COUNTER_COUNT; i++) {
+		if(groupIndex[i] != -1) {
+			result.values[i] = static_cast<long long>(data[3 + groupIndex[i]] * scale);
+		}
+	}
+	return result;
+}
+#else
+bool HardwareCounters::open() {
+	return false;
+}
+
+void HardwareCounters::close() {}
+
+HardwareCounterValues HardwareCounters::read() const {
+	return HardwareCounterValues();
+}
+#endif
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+
+namespace P3D {
+enum class HardwareCounter {
+	CYCLES,
+	INSTRUCTIONS,
+	// last level cache misses
+	CACHE_MISSES,
+	BRANCH_MISSES,
+	// data TLB load misses, not every CPU has this one
+	DTLB_MISSES,
+	COUNT
+};
+
+constexpr std::size_t HARDWARE_COUNTER_COUNT = static_cast<std::size_t>(HardwareCounter::COUNT);
+
+extern const char* hardwareCounterLabels[HARDWARE_COUNTER_COUNT];
+
+struct HardwareCounterValues {
+	long long values[HARDWARE_COUNTER_COUNT]{};
+
+	inline long long& operator[](HardwareCounter counter) { return values[static_cast<std::size_t>(counter)]; }
+	inline long long operator[](HardwareCounter counter) const { return values[static_cast<std::size_t>(counter)]; }
+
+	inline HardwareCounterValues operator+(const HardwareCounterValues& other) const {
+		HardwareCounterValues result;
+		for(std::size_t i = 0; i < HARDWARE_COUNTER_COUNT; i++) result.values[i] = values[i] + other.values[i];
+		return result;
+	}
+	inline HardwareCounterValues operator-(const HardwareCounterValues& other) const {
+		HardwareCounterValues result;
+		for(std::size_t i = 0; i < HARDWARE_COUNTER_COUNT; i++) result.values[i] = values[i] - other.values[i];
+		return result;
+	}
+	inline void operator+=(const HardwareCounterValues& other) {
+		for(std::size_t i = 0; i < HARDWARE_COUNTER_COUNT; i++) values[i] += other.values[i];
+	}
+	inline HardwareCounterValues operator/(std::size_t divisor) const {
+		HardwareCounterValues result;
+		for(std::size_t i = 0; i < HARDWARE_COUNTER_COUNT; i++) result.values[i] = values[i] / static_cast<long long>(divisor);
+		return result;
+	}
+};
+
+/*
+	CPU performance counters of the thread that opened them, through perf_event_open on Linux, unavailable elsewhere
+	Only user space is counted, so this works with the default perf_event_paranoid of 2
+	Every read is a system call, sampling at every profiler mark slows the narrowphase down noticeably
+	If the CPU has fewer counters than requested the kernel multiplexes them, the values are scaled to the full time
+*/
+class HardwareCounters {
+	// the first counter opened, all others are read through it in one go
+	int groupFd = -1;
+	int fds[HARDWARE_COUNTER_COUNT];
+	// the position of every counter in a read of the group, -1 if it couldn't be opened
+	int groupIndex[HARDWARE_COUNTER_COUNT];
+	int openCount = 0;
+	std::thread::id ownerThread;
+
+public:
+	HardwareCounters();
+	~HardwareCounters();
+	HardwareCounters(const HardwareCounters&) = delete;
+	HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+	// starts counting for the calling thread, returns false if no counter could be opened
+	bool open();
+	void close();
+
+	inline bool isOpen() const { return groupFd != -1; }
+	inline bool isAvailable(HardwareCounter counter) const { return groupIndex[static_cast<std::size_t>(counter)] != -1; }
+	inline bool isOpenOnThisThread() const { return isOpen() && ownerThread == std::this_thread::get_id(); }
+
+	// the counts since open, unavailable counters stay 0
+	HardwareCounterValues read() const;
+};
+};
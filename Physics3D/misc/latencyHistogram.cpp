@@ -0,0 +1,76 @@
+#include "latencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace P3D {
+static int getHighestBit(std::uint64_t value) {
+	int result = 0;
+	while(value >>= 1) result++;
+	return result;
+}
+
+std::size_t LatencyHistogram::getBucketIndex(std::int64_t nanos) {
+	if(nanos < (std::int64_t(1) << SUB_BUCKET_BITS)) return static_cast<std::size_t>(nanos);
+	// the highest SUB_BUCKET_BITS bits of nanos pick the bucket within its power of two
+	int shift = getHighestBit(static_cast<std::uint64_t>(nanos)) - (SUB_BUCKET_BITS - 1);
+	std::int64_t mantissa = nanos >> shift;
+	return (static_cast<std::size_t>(shift) << (SUB_BUCKET_BITS - 1)) + static_cast<std::size_t>(mantissa);
+}
+
+std::int64_t LatencyHistogram::getBucketHighestValue(std::size_t index) {
+	if(index < (std::size_t(1) << SUB_BUCKET_BITS)) return static_cast<std::int64_t>(index);
+	int shift = static_cast<int>(index >> (SUB_BUCKET_BITS - 1)) - 1;
+	std::int64_t mantissa = static_cast<std::int64_t>(index - (static_cast<std::size_t>(shift) << (SUB_BUCKET_BITS - 1)));
+	return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration) {
+	std::int64_t nanos = std::clamp<std::int64_t>(duration.count(), 0, MAX_TRACKABLE_NANOS);
+	counts[getBucketIndex(nanos)]++;
+	totalCount++;
+	totalNanos += static_cast<double>(nanos);
+	minNanos = std::min(minNanos, nanos);
+	maxNanos = std::max(maxNanos, nanos);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+	for(std::size_t i = 0; i < BUCKET_COUNT; i++) {
+		counts[i] += other.counts[i];
+	}
+	totalCount += other.totalCount;
+	totalNanos += other.totalNanos;
+	minNanos = std::min(minNanos, other.minNanos);
+	maxNanos = std::max(maxNanos, other.maxNanos);
+}
+
+void LatencyHistogram::clear() {
+	counts.fill(0);
+	totalCount = 0;
+	totalNanos = 0.0;
+	minNanos = MAX_TRACKABLE_NANOS;
+	maxNanos = 0;
+}
+
+std::chrono::nanoseconds LatencyHistogram::getMean() const {
+	if(totalCount == 0) return std::chrono::nanoseconds(0);
+	return std::chrono::nanoseconds(static_cast<std::int64_t>(totalNanos / totalCount));
+}
+
+std::chrono::nanoseconds LatencyHistogram::getPercentile(double percentile) const {
+	if(totalCount == 0) return std::chrono::nanoseconds(0);
+
+	// the rank of the value that percentile of all values is at or below, at least the first
+	std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * totalCount));
+	rank = std::max<std::uint64_t>(rank, 1);
+
+	std::uint64_t seen = 0;
+	for(std::size_t i = 0; i < BUCKET_COUNT; i++) {
+		seen += counts[i];
+		if(seen >= rank) {
+			return std::chrono::nanoseconds(std::min(getBucketHighestValue(i), maxNanos));
+		}
+	}
+	return std::chrono::nanoseconds(maxNanos);
+}
+};
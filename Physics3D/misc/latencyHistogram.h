@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace P3D {
+/*
+	HDR style histogram of durations in nanoseconds, recording is constant time and allocates nothing
+	Durations below 2^SUB_BUCKET_BITS ns have their own bucket, above that every power of two is split into 2^(SUB_BUCKET_BITS-1) buckets,
+	so percentiles are within 1.6% of the recorded value, up to MAX_TRACKABLE_NANOS (~18 minutes), longer durations count as that
+	Percentiles report the highest duration of their bucket, and never more than the largest recorded duration, which is kept exactly
+*/
+class LatencyHistogram {
+public:
+	static constexpr int SUB_BUCKET_BITS = 7;
+	static constexpr int MAX_TRACKABLE_BITS = 40;
+	static constexpr std::int64_t MAX_TRACKABLE_NANOS = (std::int64_t(1) << MAX_TRACKABLE_BITS) - 1;
+	static constexpr std::size_t BUCKET_COUNT = (MAX_TRACKABLE_BITS - SUB_BUCKET_BITS + 2) << (SUB_BUCKET_BITS - 1);
+
+private:
+	std::array<std::uint64_t, BUCKET_COUNT> counts{};
+	std::uint64_t totalCount = 0;
+	// a double, so long runs can't overflow it
+	double totalNanos = 0.0;
+	std::int64_t minNanos = MAX_TRACKABLE_NANOS;
+	std::int64_t maxNanos = 0;
+
+	static std::size_t getBucketIndex(std::int64_t nanos);
+	static std::int64_t getBucketHighestValue(std::size_t index);
+
+public:
+	void record(std::chrono::nanoseconds duration);
+	void merge(const LatencyHistogram& other);
+	void clear();
+
+	inline std::uint64_t getCount() const { return totalCount; }
+	inline std::chrono::nanoseconds getMin() const { return std::chrono::nanoseconds(totalCount != 0 ? minNanos : 0); }
+	inline std::chrono::nanoseconds getMax() const { return std::chrono::nanoseconds(maxNanos); }
+	std::chrono::nanoseconds getMean() const;
+	// percentile between 0 and 100, 0 if nothing was recorded
+	std::chrono::nanoseconds getPercentile(double percentile) const;
+};
+};
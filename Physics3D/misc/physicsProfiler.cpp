@@ -21,7 +21,8 @@ const char * intersectionLabels[]{
 	"Colission",
 	"GJK Reject",
 	"Part Dist Reject",
-	"Part Bound Reject"
+	"Part Bound Reject",
+	"Cached Contact"
 };
 
 const char* iterationLabels[]{
@@ -25,6 +25,7 @@ enum class IntersectionResult {
 	GJK_REJECT,
 	PART_DISTANCE_REJECT,
 	PART_BOUNDS_REJECT,
+	CACHED_CONTACT,
 	COUNT
 };
 
@@ -2,9 +2,14 @@
 
 #include <chrono>
 #include <map>
+#include <atomic>
+#include <thread>
 
 #include "../datastructures/buffers.h"
 #include "../datastructures/parallelArray.h"
+#include "latencyHistogram.h"
+#include "hardwareCounters.h"
+#include "allocationTracker.h"
 
 namespace P3D {
 class TimerMeasure {
@@ -61,42 +66,150 @@ public:
 	}
 };
 
+/*
+	Splits the time of every tick over the processes marked during it
+	The thread that calls end() owns the next tick, marks from other threads, like the helpers of a ThreadPool, are ignored so they don't mix up its timeline
+	Before the first end() marks from every thread are counted
+	Every tick is also recorded in tickLatency, and the time of every process in that tick in processLatencies, for the tail latencies the averages hide
+	With HardwareCounters set, the counts of every process are kept in counterHistory alongside history, sampled at every mark of the thread that opened them
+	With trackAllocations set, marks also tell the AllocationTracker which process the tick is in, while it is enabled the allocations of every tick are kept in allocationHistory
+	Only one profiler at a time should track allocations, the tracker has a single current phase for the whole program
+*/
 template<typename ProcessType>
 class BreakdownAverageProfiler : public HistoricTally<std::chrono::nanoseconds, ProcessType> {
+	static_assert(static_cast<size_t>(ProcessType::COUNT) <= AllocationTracker::MAX_PHASES, "the AllocationTracker can't tell that many processes apart");
+
 	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
 	ProcessType currentProcess = static_cast<ProcessType>(-1);
+	std::atomic<std::thread::id> tickThread{std::thread::id()};
+
+	HardwareCounters* hardwareCounters = nullptr;
+	HardwareCounterValues lastCounterValues;
+	HardwareCounterValues currentCounterTally[static_cast<size_t>(ProcessType::COUNT)];
 
+	bool trackAllocations = false;
+
+	inline bool isTickThread() const {
+		std::thread::id owner = tickThread.load(std::memory_order_relaxed);
+		return owner == std::thread::id() || owner == std::this_thread::get_id();
+	}
+
+	// adds the counts since the last sample to process
+	inline void sampleCounters(ProcessType process) {
+		if(hardwareCounters == nullptr || !hardwareCounters->isOpenOnThisThread()) return;
+		HardwareCounterValues curValues = hardwareCounters->read();
+		if(process != static_cast<ProcessType>(-1)) {
+			currentCounterTally[static_cast<size_t>(process)] += curValues - lastCounterValues;
+		}
+		lastCounterValues = curValues;
+	}
 
 public:
 	CircularBuffer<std::chrono::high_resolution_clock::time_point> tickHistory;
+	// the time of all marked processes of a tick, not the time between ticks
+	LatencyHistogram tickLatency;
+	LatencyHistogram processLatencies[static_cast<size_t>(ProcessType::COUNT)];
+	// the hardware counts of every process, one entry per tick that ended while hardware counters were set
+	CircularBuffer<ParallelArray<HardwareCounterValues, static_cast<size_t>(ProcessType::COUNT)>> counterHistory;
+	// the allocations of every process, one entry per tick that ended while tracking allocations with the allocationTracker enabled
+	CircularBuffer<ParallelArray<AllocationCounts, static_cast<size_t>(ProcessType::COUNT)>> allocationHistory;
+
+	inline BreakdownAverageProfiler(char const* const labels[static_cast<size_t>(ProcessType::COUNT)], size_t capacity) : HistoricTally<std::chrono::nanoseconds, ProcessType>(labels, capacity), tickHistory(capacity), counterHistory(capacity), allocationHistory(capacity) {}
+
+	// counters must be open on the thread that ticks, and outlive their use here, nullptr stops sampling
+	// new counters start a new counterHistory, nullptr keeps it for reading
+	inline void setHardwareCounters(HardwareCounters* counters) {
+		hardwareCounters = counters;
+		for(HardwareCounterValues& values : currentCounterTally) {
+			values = HardwareCounterValues();
+		}
+		if(counters != nullptr) {
+			counterHistory.clear();
+			lastCounterValues = counters->read();
+		}
+	}
 
-	inline BreakdownAverageProfiler(char const* const labels[static_cast<size_t>(ProcessType::COUNT)], size_t capacity) : HistoricTally<std::chrono::nanoseconds, ProcessType>(labels, capacity), tickHistory(capacity) {}
+	// starting to track starts a new allocationHistory, stopping keeps it for reading
+	inline void setTrackAllocations(bool track) {
+		if(track && !trackAllocations) {
+			allocationHistory.clear();
+		}
+		if(trackAllocations) {
+			allocationTracker.setPhase(-1);
+		}
+		trackAllocations = track;
+	}
 
 	inline void mark(ProcessType process) {
+		if(!isTickThread()) return;
 		std::chrono::high_resolution_clock::time_point curTime = std::chrono::high_resolution_clock::now();
 		if(currentProcess != static_cast<ProcessType>(-1)) {
 			HistoricTally<std::chrono::nanoseconds, ProcessType>::addToTally(currentProcess, curTime - startTime);
 		}
+		sampleCounters(currentProcess);
+		if(trackAllocations) allocationTracker.setPhase(static_cast<int>(process));
 		startTime = curTime;
 		currentProcess = process;
 	}
 
 	inline void mark(ProcessType process, ProcessType overrideOldProcess) {
+		if(!isTickThread()) return;
 		std::chrono::high_resolution_clock::time_point curTime = std::chrono::high_resolution_clock::now();
 		if(currentProcess != static_cast<ProcessType>(-1)) {
 			HistoricTally<std::chrono::nanoseconds, ProcessType>::addToTally(overrideOldProcess, curTime - startTime);
+			sampleCounters(overrideOldProcess);
+		} else {
+			sampleCounters(currentProcess);
 		}
+		if(trackAllocations) allocationTracker.setPhase(static_cast<int>(process));
 		startTime = curTime;
 		currentProcess = process;
 	}
 
 	inline void end() {
 		std::chrono::high_resolution_clock::time_point curTime = std::chrono::high_resolution_clock::now();
-		this->addToTally(currentProcess, curTime - startTime);
+		// end() without a mark since the last one only claims the profiler for this thread, it isn't a tick
+		bool wasTicking = currentProcess != static_cast<ProcessType>(-1);
+		if(wasTicking) {
+			this->addToTally(currentProcess, curTime - startTime);
+		}
+		sampleCounters(currentProcess);
+		if(trackAllocations) allocationTracker.setPhase(-1);
 		tickHistory.add(curTime);
 
 		currentProcess = static_cast<ProcessType>(-1);
 		this->nextTally();
+		tickThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+		if(wasTicking) {
+			const ParallelArray<std::chrono::nanoseconds, static_cast<size_t>(ProcessType::COUNT)>& tally = this->history.front();
+			std::chrono::nanoseconds tickTime(0);
+			for(size_t i = 0; i < static_cast<size_t>(ProcessType::COUNT); i++) {
+				processLatencies[i].record(tally.values[i]);
+				tickTime += tally.values[i];
+			}
+			tickLatency.record(tickTime);
+
+			if(hardwareCounters != nullptr && hardwareCounters->isOpenOnThisThread()) {
+				counterHistory.add(ParallelArray<HardwareCounterValues, static_cast<size_t>(ProcessType::COUNT)>(currentCounterTally));
+				for(HardwareCounterValues& values : currentCounterTally) {
+					values = HardwareCounterValues();
+				}
+			}
+
+			if(trackAllocations && allocationTracker.isEnabled()) {
+				AllocationCounts allocations[static_cast<size_t>(ProcessType::COUNT)];
+				allocationTracker.takeCounts(allocations, static_cast<size_t>(ProcessType::COUNT));
+				allocationHistory.add(ParallelArray<AllocationCounts, static_cast<size_t>(ProcessType::COUNT)>(allocations));
+			}
+		}
+	}
+
+	inline void clearLatencies() {
+		tickLatency.clear();
+		for(LatencyHistogram& histogram : processLatencies) {
+			histogram.clear();
+		}
 	}
 
 	inline double getAvgTPS() {
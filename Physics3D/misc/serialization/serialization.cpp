@@ -10,6 +10,7 @@
 #include "../../geometry/builtinShapeClasses.h"
 #include "../../geometry/shape.h"
 #include "../../geometry/shapeClass.h"
+#include "../../geometry/shapeCreation.h"
 #include "../../part.h"
 #include "../../world.h"
 #include "../../layer.h"
@@ -27,16 +28,36 @@ namespace P3D {
 
 #pragma region serializeComponents
 
-void serializePolyhedron(const Polyhedron& poly, std::ostream& ostream) {
-	serializeBasicTypes<int>(poly.vertexCount, ostream);
-	serializeBasicTypes<int>(poly.triangleCount, ostream);
+void serializeTriangleMesh(const TriangleMesh& mesh, std::ostream& ostream) {
+	serializeBasicTypes<int>(mesh.vertexCount, ostream);
+	serializeBasicTypes<int>(mesh.triangleCount, ostream);
+
+	for(int i = 0; i < mesh.vertexCount; i++) {
+		serializeBasicTypes<Vec3f>(mesh.getVertex(i), ostream);
+	}
+	for(int i = 0; i < mesh.triangleCount; i++) {
+		serializeBasicTypes<Triangle>(mesh.getTriangle(i), ostream);
+	}
+}
+TriangleMesh deserializeTriangleMesh(std::istream& istream) {
+	uint32_t vertexCount = deserializeBasicTypes<uint32_t>(istream);
+	uint32_t triangleCount = deserializeBasicTypes<uint32_t>(istream);
 
-	for(int i = 0; i < poly.vertexCount; i++) {
-		serializeBasicTypes<Vec3f>(poly.getVertex(i), ostream);
+	std::vector<Vec3f> vertices(vertexCount);
+	std::vector<Triangle> triangles(triangleCount);
+
+	for(uint32_t i = 0; i < vertexCount; i++) {
+		vertices[i] = deserializeBasicTypes<Vec3f>(istream);
 	}
-	for(int i = 0; i < poly.triangleCount; i++) {
-		serializeBasicTypes<Triangle>(poly.getTriangle(i), ostream);
+	for(uint32_t i = 0; i < triangleCount; i++) {
+		triangles[i] = deserializeBasicTypes<Triangle>(istream);
 	}
+
+	return TriangleMesh(vertexCount, triangleCount, vertices.data(), triangles.data());
+}
+
+void serializePolyhedron(const Polyhedron& poly, std::ostream& ostream) {
+	serializeTriangleMesh(poly, ostream);
 }
 Polyhedron deserializePolyhedron(std::istream& istream) {
 	uint32_t vertexCount = deserializeBasicTypes<uint32_t>(istream);
@@ -173,10 +194,44 @@ void serializePolyhedronShapeClass(const PolyhedronShapeClass& polyhedron, std::
 }
 PolyhedronShapeClass* deserializePolyhedronShapeClass(std::istream& istream) {
 	Polyhedron poly = deserializePolyhedron(istream);
-	PolyhedronShapeClass* result = new PolyhedronShapeClass(std::move(poly));
+	// the same class polyhedronShape would have picked, not the slower generic one
+	PolyhedronShapeClass* result = createPolyhedronShapeClass(std::move(poly));
 	return result;
 }
 
+void serializeTriangleMeshShapeClass(const TriangleMeshShapeClass& shape, std::ostream& ostream) {
+	serializeTriangleMesh(shape.getMesh(), ostream);
+}
+TriangleMeshShapeClass* deserializeTriangleMeshShapeClass(std::istream& istream) {
+	return new TriangleMeshShapeClass(deserializeTriangleMesh(istream));
+}
+
+// quantized heights are written as the heights they stand for, which quantize back to the same values
+void serializeHeightfieldShapeClass(const HeightfieldShapeClass& heightfield, std::ostream& ostream) {
+	serializeBasicTypes<int>(heightfield.getSampleCountX(), ostream);
+	serializeBasicTypes<int>(heightfield.getSampleCountZ(), ostream);
+	serializeBasicTypes<bool>(heightfield.isQuantized(), ostream);
+	for(int x = 0; x < heightfield.getSampleCountX(); x++) {
+		for(int z = 0; z < heightfield.getSampleCountZ(); z++) {
+			serializeBasicTypes<float>(heightfield.getHeight(x, z), ostream);
+		}
+	}
+}
+HeightfieldShapeClass* deserializeHeightfieldShapeClass(std::istream& istream) {
+	int sampleCountX = deserializeBasicTypes<int>(istream);
+	int sampleCountZ = deserializeBasicTypes<int>(istream);
+	bool quantized = deserializeBasicTypes<bool>(istream);
+	if(sampleCountX < 2 || sampleCountZ < 2) {
+		throw SerializationException("A heightfield needs at least 2 samples along x and z, not " + std::to_string(sampleCountX) + " x " + std::to_string(sampleCountZ));
+	}
+
+	std::vector<float> heights(static_cast<std::size_t>(sampleCountX) * sampleCountZ);
+	for(float& height : heights) {
+		height = deserializeBasicTypes<float>(istream);
+	}
+	return new HeightfieldShapeClass(sampleCountX, sampleCountZ, heights.data(), quantized);
+}
+
 void serializeDirectionalGravity(const DirectionalGravity& gravity, std::ostream& ostream) {
 	serializeBasicTypes<Vec3>(gravity.gravity, ostream);
 }
@@ -321,6 +376,7 @@ MotorizedPhysical* DeSerializationSessionPrototype::deserializeMotorizedPhysical
 
 	deserializeConnectionsOfPhysicalWithContext(layers, *mainPhys, istream);
 
+	mainPhys->markSubtreeDirty();
 	mainPhys->refreshPhysicalProperties();
 	return mainPhys;
 }
@@ -562,6 +618,10 @@ static DynamicSerializerRegistry<Constraint>::ConcreteDynamicSerializer<BarConst
 
 static DynamicSerializerRegistry<ShapeClass>::ConcreteDynamicSerializer<PolyhedronShapeClass> polyhedronSerializer
 (serializePolyhedronShapeClass, deserializePolyhedronShapeClass, 0);
+static DynamicSerializerRegistry<ShapeClass>::ConcreteDynamicSerializer<TriangleMeshShapeClass> triangleMeshSerializer
+(serializeTriangleMeshShapeClass, deserializeTriangleMeshShapeClass, 1);
+static DynamicSerializerRegistry<ShapeClass>::ConcreteDynamicSerializer<HeightfieldShapeClass> heightfieldSerializer
+(serializeHeightfieldShapeClass, deserializeHeightfieldShapeClass, 2);
 
 static DynamicSerializerRegistry<ExternalForce>::ConcreteDynamicSerializer<DirectionalGravity> gravitySerializer
 (serializeDirectionalGravity, deserializeDirectionalGravity, 0);
@@ -577,8 +637,16 @@ DynamicSerializerRegistry<HardConstraint> dynamicHardConstraintSerializer{
 	{typeid(SinusoidalPistonConstraint), &pistonConstraintSerializer},
 	{typeid(MotorConstraintTemplate<SineWaveController>), &sinusiodalMotorConstraintSerializer}
 };
+// polyhedronShape creates one of the optimized subclasses, which are all serialized as the polyhedron they hold
 DynamicSerializerRegistry<ShapeClass> dynamicShapeClassSerializer{
-	{typeid(PolyhedronShapeClass), &polyhedronSerializer}
+	{typeid(PolyhedronShapeClass), &polyhedronSerializer},
+	{typeid(PolyhedronShapeClassAVX), &polyhedronSerializer},
+	{typeid(PolyhedronShapeClassSSE), &polyhedronSerializer},
+	{typeid(PolyhedronShapeClassSSE4), &polyhedronSerializer},
+	{typeid(PolyhedronShapeClassFallback), &polyhedronSerializer},
+	{typeid(PolyhedronShapeClassHillClimbing), &polyhedronSerializer},
+	{typeid(TriangleMeshShapeClass), &triangleMeshSerializer},
+	{typeid(HeightfieldShapeClass), &heightfieldSerializer}
 };
 DynamicSerializerRegistry<ExternalForce> dynamicExternalForceSerializer{
 	{typeid(DirectionalGravity), &gravitySerializer}
@@ -30,6 +30,9 @@
 #include "dynamicSerialize.h"
 
 namespace P3D {
+void serializeTriangleMesh(const TriangleMesh& mesh, std::ostream& ostream);
+TriangleMesh deserializeTriangleMesh(std::istream& istream);
+// the same format as a TriangleMesh
 void serializePolyhedron(const Polyhedron& poly, std::ostream& ostream);
 Polyhedron deserializePolyhedron(std::istream& istream);
 
@@ -0,0 +1,406 @@
+#include "worldRecording.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "serialization.h"
+#include "../../world.h"
+#include "../../physical.h"
+#include "../../threading/threadPool.h"
+
+#define RECORDING_MAGIC 0x52443350
+#define RECORDING_VERSION 1
+#define NO_PART 0xFFFFFFFF
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+namespace P3D {
+#pragma region checksum
+
+static void hashBytes(std::uint64_t& hash, const void* data, std::size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for(std::size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+}
+
+std::uint64_t computeWorldChecksum(const WorldPrototype& world) {
+	std::uint64_t hash = FNV_OFFSET_BASIS;
+	std::uint64_t age = world.age;
+	hashBytes(hash, &age, sizeof(age));
+	for(const MotorizedPhysical* phys : world.physicals) {
+		GlobalCFrame cframe = phys->getMainPart()->getCFrame();
+		hashBytes(hash, &cframe, sizeof(cframe));
+		hashBytes(hash, &phys->motionOfCenterOfMass, sizeof(phys->motionOfCenterOfMass));
+	}
+	return hash;
+}
+
+#pragma endregion
+
+#pragma region WorldRecorder
+
+// gives every part the index it has in the stream
+class PartIDSerializationSession : public SerializationSessionPrototype {
+	std::unordered_map<const Part*, std::uint32_t>& partIDs;
+	std::uint32_t& nextPartID;
+
+protected:
+	virtual void serializePartExternalData(const Part& part, std::ostream&) override {
+		partIDs[&part] = nextPartID++;
+	}
+
+public:
+	PartIDSerializationSession(std::unordered_map<const Part*, std::uint32_t>& partIDs, std::uint32_t& nextPartID) : partIDs(partIDs), nextPartID(nextPartID) {}
+};
+
+WorldRecorder::WorldRecorder(WorldPrototype& world, std::ostream& ostream, bool recordChecksums, const MagnetForce* magnet) : world(world), ostream(ostream), recordChecksums(recordChecksums) {
+	serializeBasicTypes<std::uint32_t>(RECORDING_MAGIC, ostream);
+	serializeBasicTypes<std::uint32_t>(RECORDING_VERSION, ostream);
+
+	// the settings serializeWorld leaves out, but which change the simulation
+	serializeBasicTypes<double>(world.deltaT, ostream);
+	serializeBasicTypes<bool>(world.parallelColissionHandling, ostream);
+	serializeBasicTypes<bool>(world.adaptiveSubStepping, ostream);
+	serializeBasicTypes<std::int32_t>(world.maxSubSteps, ostream);
+	serializeBasicTypes<double>(world.subStepTravelFraction, ostream);
+	serializeBasicTypes<bool>(world.speculativeContacts, ostream);
+	serializeBasicTypes<double>(world.speculativeTravelFraction, ostream);
+	serializeBasicTypes<bool>(world.reuseRestingContacts, ostream);
+	serializeBasicTypes<double>(world.contactReuseTolerance, ostream);
+
+	std::vector<ExternalForce*> allForces = world.externalForces;
+	if(magnet != nullptr) {
+		world.externalForces.erase(std::remove(world.externalForces.begin(), world.externalForces.end(), magnet), world.externalForces.end());
+	}
+	try {
+		PartIDSerializationSession session(partIDs, nextPartID);
+		session.serializeWorld(world, ostream);
+	} catch(...) {
+		world.externalForces = std::move(allForces);
+		throw;
+	}
+	world.externalForces = std::move(allForces);
+
+	if(magnet != nullptr) {
+		recordMagnet(*magnet);
+	}
+}
+
+void WorldRecorder::writeEventHeader(RecordedEventType type) {
+	serializeBasicTypes<std::uint64_t>(world.age, ostream);
+	serializeBasicTypes<std::uint8_t>(static_cast<std::uint8_t>(type), ostream);
+}
+
+void WorldRecorder::writePartID(const Part& part) {
+	auto found = partIDs.find(&part);
+	if(found == partIDs.end()) {
+		throw SerializationException("This part is not part of the recording!");
+	}
+	serializeBasicTypes<std::uint32_t>(found->second, ostream);
+}
+
+void WorldRecorder::writeAddedPart(RecordedEventType type, Part* part, int layerIndex) {
+	writeEventHeader(type);
+	serializeBasicTypes<std::int32_t>(layerIndex, ostream);
+
+	// length prefixed, so the replayer can read it without deserializing it
+	std::stringstream partData;
+	const Part* partsToSerialize[]{part};
+	SerializationSessionPrototype session;
+	session.serializeParts(partsToSerialize, 1, partData);
+	std::string data = partData.str();
+	serializeBasicTypes<std::uint64_t>(data.size(), ostream);
+	serializeBasicTypes(data.c_str(), data.size(), ostream);
+
+	partIDs[part] = nextPartID++;
+}
+
+void WorldRecorder::addPart(Part* part, int layerIndex) {
+	writeAddedPart(RecordedEventType::ADD_PART, part, layerIndex);
+	world.addPart(part, layerIndex);
+}
+
+void WorldRecorder::addTerrainPart(Part* part, int layerIndex) {
+	writeAddedPart(RecordedEventType::ADD_TERRAIN_PART, part, layerIndex);
+	world.addTerrainPart(part, layerIndex);
+}
+
+void WorldRecorder::removePart(Part* part) {
+	writeEventHeader(RecordedEventType::REMOVE_PART);
+	writePartID(*part);
+	partIDs.erase(part);
+	world.removePart(part);
+}
+
+void WorldRecorder::setCFrame(Part& part, const GlobalCFrame& cframe) {
+	writeEventHeader(RecordedEventType::SET_CFRAME);
+	writePartID(part);
+	serializeBasicTypes<GlobalCFrame>(cframe, ostream);
+	part.setCFrame(cframe);
+}
+
+void WorldRecorder::setMotion(Part& part, Vec3 velocity, Vec3 angularVelocity) {
+	writeEventHeader(RecordedEventType::SET_MOTION);
+	writePartID(part);
+	serializeBasicTypes<Vec3>(velocity, ostream);
+	serializeBasicTypes<Vec3>(angularVelocity, ostream);
+	part.setMotion(velocity, angularVelocity);
+}
+
+static void applyProperties(Part& part, const PartProperties& properties) {
+	part.setDensity(properties.density);
+	part.setFriction(properties.friction);
+	part.setBouncyness(properties.bouncyness);
+	part.setConveyorEffect(properties.conveyorEffect);
+}
+
+void WorldRecorder::setProperties(Part& part, const PartProperties& properties) {
+	writeEventHeader(RecordedEventType::SET_PROPERTIES);
+	writePartID(part);
+	serializeBasicTypes<PartProperties>(properties, ostream);
+	applyProperties(part, properties);
+}
+
+void WorldRecorder::applyForce(Part& part, Vec3 relativeOrigin, Vec3 force) {
+	writeEventHeader(RecordedEventType::APPLY_FORCE);
+	writePartID(part);
+	serializeBasicTypes<Vec3>(relativeOrigin, ostream);
+	serializeBasicTypes<Vec3>(force, ostream);
+	part.applyForce(relativeOrigin, force);
+}
+
+void WorldRecorder::recordMagnet(const MagnetForce& magnet) {
+	writeEventHeader(RecordedEventType::SET_MAGNET);
+	// a part outside the recording can't be pulled in the replay, the magnet then holds nothing
+	auto found = magnet.selectedPart != nullptr ? partIDs.find(magnet.selectedPart) : partIDs.end();
+	serializeBasicTypes<std::uint32_t>(found != partIDs.end() ? found->second : NO_PART, ostream);
+	serializeBasicTypes<Vec3>(magnet.localSelectedPoint, ostream);
+	serializeBasicTypes<Position>(magnet.magnetPoint, ostream);
+	serializeBasicTypes<double>(magnet.pickerStrength, ostream);
+	serializeBasicTypes<double>(magnet.pickerSpeedStrength, ostream);
+}
+
+void WorldRecorder::afterTick() {
+	if(!recordChecksums) return;
+	writeEventHeader(RecordedEventType::CHECKSUM);
+	serializeBasicTypes<std::uint64_t>(computeWorldChecksum(world), ostream);
+}
+
+void WorldRecorder::finish() {
+	writeEventHeader(RecordedEventType::END);
+	ostream.flush();
+}
+
+#pragma endregion
+
+#pragma region WorldReplayer
+
+// collects the parts in the order they are in the stream, the same order PartIDSerializationSession numbers them in
+class PartIDDeSerializationSession : public DeSerializationSessionPrototype {
+	std::vector<Part*>& parts;
+
+protected:
+	virtual Part* deserializePartExternalData(Part&& part, std::istream&) override {
+		Part* result = new Part(std::move(part));
+		parts.push_back(result);
+		return result;
+	}
+
+public:
+	PartIDDeSerializationSession(std::vector<Part*>& parts) : parts(parts) {}
+};
+
+static RecordedEvent readEvent(std::istream& istream) {
+	RecordedEvent event;
+	event.age = deserializeBasicTypes<std::uint64_t>(istream);
+	event.type = static_cast<RecordedEventType>(deserializeBasicTypes<std::uint8_t>(istream));
+
+	switch(event.type) {
+		case RecordedEventType::ADD_PART:
+		case RecordedEventType::ADD_TERRAIN_PART: {
+			event.layerIndex = deserializeBasicTypes<std::int32_t>(istream);
+			std::uint64_t size = deserializeBasicTypes<std::uint64_t>(istream);
+			event.partData.resize(size);
+			deserializeBasicTypes(event.partData.data(), size, istream);
+			break;
+		}
+		case RecordedEventType::REMOVE_PART:
+			event.partID = deserializeBasicTypes<std::uint32_t>(istream);
+			break;
+		case RecordedEventType::SET_CFRAME:
+			event.partID = deserializeBasicTypes<std::uint32_t>(istream);
+			event.cframe = deserializeBasicTypes<GlobalCFrame>(istream);
+			break;
+		case RecordedEventType::SET_MOTION:
+		case RecordedEventType::APPLY_FORCE:
+			event.partID = deserializeBasicTypes<std::uint32_t>(istream);
+			event.vecA = deserializeBasicTypes<Vec3>(istream);
+			event.vecB = deserializeBasicTypes<Vec3>(istream);
+			break;
+		case RecordedEventType::SET_PROPERTIES:
+			event.partID = deserializeBasicTypes<std::uint32_t>(istream);
+			event.properties = deserializeBasicTypes<PartProperties>(istream);
+			break;
+		case RecordedEventType::SET_MAGNET:
+			event.partID = deserializeBasicTypes<std::uint32_t>(istream);
+			event.vecA = deserializeBasicTypes<Vec3>(istream);
+			event.position = deserializeBasicTypes<Position>(istream);
+			event.strength = deserializeBasicTypes<double>(istream);
+			event.speedStrength = deserializeBasicTypes<double>(istream);
+			break;
+		case RecordedEventType::CHECKSUM:
+			event.checksum = deserializeBasicTypes<std::uint64_t>(istream);
+			break;
+		case RecordedEventType::END:
+			break;
+		default:
+			throw SerializationException("Invalid recorded event type " + std::to_string(static_cast<int>(event.type)));
+	}
+	if(!istream) {
+		throw SerializationException("The recording ends before its END event!");
+	}
+	return event;
+}
+
+WorldReplayer::WorldReplayer(WorldPrototype& world, std::istream& istream) : world(world), magnet(0.0, 0.0) {
+	if(deserializeBasicTypes<std::uint32_t>(istream) != RECORDING_MAGIC) {
+		throw SerializationException("This is not a world recording!");
+	}
+	std::uint32_t version = deserializeBasicTypes<std::uint32_t>(istream);
+	if(version != RECORDING_VERSION) {
+		throw SerializationException("Recording version " + std::to_string(version) + " cannot be read, the current version is " + std::to_string(RECORDING_VERSION));
+	}
+
+	world.deltaT = deserializeBasicTypes<double>(istream);
+	world.parallelColissionHandling = deserializeBasicTypes<bool>(istream);
+	world.adaptiveSubStepping = deserializeBasicTypes<bool>(istream);
+	world.maxSubSteps = deserializeBasicTypes<std::int32_t>(istream);
+	world.subStepTravelFraction = deserializeBasicTypes<double>(istream);
+	world.speculativeContacts = deserializeBasicTypes<bool>(istream);
+	world.speculativeTravelFraction = deserializeBasicTypes<double>(istream);
+	world.reuseRestingContacts = deserializeBasicTypes<bool>(istream);
+	world.contactReuseTolerance = deserializeBasicTypes<double>(istream);
+
+	PartIDDeSerializationSession session(parts);
+	session.deserializeWorld(world, istream);
+	startAge = world.age;
+
+	while(true) {
+		RecordedEvent event = readEvent(istream);
+		if(event.type == RecordedEventType::END) {
+			endAge = event.age;
+			break;
+		}
+		events.push_back(std::move(event));
+	}
+}
+
+WorldReplayer::~WorldReplayer() {
+	if(magnetAdded && std::find(world.externalForces.begin(), world.externalForces.end(), &magnet) != world.externalForces.end()) {
+		world.removeExternalForce(&magnet);
+	}
+	for(Part* part : removedParts) {
+		delete part;
+	}
+}
+
+Part* WorldReplayer::getPart(std::uint32_t partID) const {
+	if(partID >= parts.size() || parts[partID] == nullptr) {
+		throw SerializationException("The recording refers to part " + std::to_string(partID) + " which is not in the world!");
+	}
+	return parts[partID];
+}
+
+void WorldReplayer::applyEvent(const RecordedEvent& event) {
+	switch(event.type) {
+		case RecordedEventType::ADD_PART:
+		case RecordedEventType::ADD_TERRAIN_PART: {
+			std::istringstream partData(event.partData);
+			DeSerializationSessionPrototype session;
+			Part* part = session.deserializeParts(partData)[0];
+			if(event.type == RecordedEventType::ADD_PART) {
+				world.addPart(part, event.layerIndex);
+			} else {
+				world.addTerrainPart(part, event.layerIndex);
+			}
+			parts.push_back(part);
+			break;
+		}
+		case RecordedEventType::REMOVE_PART: {
+			Part* part = getPart(event.partID);
+			world.removePart(part);
+			parts[event.partID] = nullptr;
+			removedParts.push_back(part);
+			break;
+		}
+		case RecordedEventType::SET_CFRAME:
+			getPart(event.partID)->setCFrame(event.cframe);
+			break;
+		case RecordedEventType::SET_MOTION:
+			getPart(event.partID)->setMotion(event.vecA, event.vecB);
+			break;
+		case RecordedEventType::SET_PROPERTIES:
+			applyProperties(*getPart(event.partID), event.properties);
+			break;
+		case RecordedEventType::APPLY_FORCE:
+			getPart(event.partID)->applyForce(event.vecA, event.vecB);
+			break;
+		case RecordedEventType::SET_MAGNET:
+			magnet.selectedPart = event.partID != NO_PART ? getPart(event.partID) : nullptr;
+			magnet.localSelectedPoint = event.vecA;
+			magnet.magnetPoint = event.position;
+			magnet.pickerStrength = event.strength;
+			magnet.pickerSpeedStrength = event.speedStrength;
+			if(!magnetAdded) {
+				world.addExternalForce(&magnet);
+				magnetAdded = true;
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+void WorldReplayer::applyEvents() {
+	while(nextEvent < events.size() && events[nextEvent].age <= world.age) {
+		// checksums of ticks that weren't checked are skipped
+		applyEvent(events[nextEvent]);
+		nextEvent++;
+	}
+}
+
+void WorldReplayer::checkTick() {
+	while(nextEvent < events.size() && events[nextEvent].age == world.age && events[nextEvent].type == RecordedEventType::CHECKSUM) {
+		if(events[nextEvent].checksum != computeWorldChecksum(world)) {
+			if(mismatchedTicks == 0) firstMismatchAge = world.age;
+			mismatchedTicks++;
+		}
+		checkedTicks++;
+		nextEvent++;
+	}
+}
+
+void WorldReplayer::tick() {
+	applyEvents();
+	world.tick();
+	checkTick();
+}
+
+void WorldReplayer::tick(ThreadPool& threadPool) {
+	applyEvents();
+	world.tick(threadPool);
+	checkTick();
+}
+
+bool WorldReplayer::isFinished() const {
+	return world.age >= endAge;
+}
+
+std::size_t WorldReplayer::getTickCount() const {
+	return static_cast<std::size_t>(endAge - startAge);
+}
+
+#pragma endregion
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../math/linalg/vec.h"
+#include "../../math/globalCFrame.h"
+#include "../../part.h"
+#include "../../externalforces/magnetForce.h"
+
+namespace P3D {
+class WorldPrototype;
+class ThreadPool;
+
+enum class RecordedEventType : std::uint8_t {
+	ADD_PART,
+	ADD_TERRAIN_PART,
+	REMOVE_PART,
+	SET_CFRAME,
+	SET_MOTION,
+	SET_PROPERTIES,
+	APPLY_FORCE,
+	SET_MAGNET,
+	CHECKSUM,
+	END
+};
+
+// a hash of the age of the world and the position and motion of every physical, equal only if the simulations are bit for bit the same
+std::uint64_t computeWorldChecksum(const WorldPrototype& world);
+
+/*
+	Records a world and everything done to it from outside, so the simulation can be replayed by a WorldReplayer
+	The world is written as serializeWorld does at construction, after that every change must be made through the recorder, which makes it and writes it down
+	Parts are referred to by the order serializeWorld writes them in, and by the order they are added after that
+	Events are stamped with the age of the world, so they are replayed before the same tick they happened before
+
+	Only the Part level of the world is recorded, the extra data of ExtendedParts is not
+	The MagnetForce of the picker changes every frame, it is left out of the serialized forces and recorded through recordMagnet instead
+	The picker and tools of the application don't go through a recorder yet, only worlds driven from code, like the world benchmarks with --record, can be recorded
+
+	The replayed world builds its colission trees from scratch, if colissions are then handled in another order than in the recorded world
+	the checksums can differ without anything being wrong. Recording a world loaded with deserializeWorld avoids that
+*/
+class WorldRecorder {
+	WorldPrototype& world;
+	std::ostream& ostream;
+	bool recordChecksums;
+	std::unordered_map<const Part*, std::uint32_t> partIDs;
+	std::uint32_t nextPartID = 0;
+
+	void writeEventHeader(RecordedEventType type);
+	void writePartID(const Part& part);
+	void writeAddedPart(RecordedEventType type, Part* part, int layerIndex);
+
+public:
+	// writes the world as it is now, magnet, if given, is left out of its forces
+	WorldRecorder(WorldPrototype& world, std::ostream& ostream, bool recordChecksums = false, const MagnetForce* magnet = nullptr);
+	WorldRecorder(const WorldRecorder&) = delete;
+	WorldRecorder& operator=(const WorldRecorder&) = delete;
+
+	void addPart(Part* part, int layerIndex = 0);
+	void addTerrainPart(Part* part, int layerIndex = 0);
+	// the part is only removed, like WorldPrototype::removePart
+	void removePart(Part* part);
+	void setCFrame(Part& part, const GlobalCFrame& cframe);
+	void setMotion(Part& part, Vec3 velocity, Vec3 angularVelocity);
+	void setProperties(Part& part, const PartProperties& properties);
+	void applyForce(Part& part, Vec3 relativeOrigin, Vec3 force);
+	// records the state of the magnet, call this after every change to it
+	void recordMagnet(const MagnetForce& magnet);
+
+	// call after every tick of the world
+	void afterTick();
+	// ends the recording, nothing may be recorded after this
+	void finish();
+};
+
+struct RecordedEvent {
+	std::uint64_t age;
+	RecordedEventType type;
+	std::uint32_t partID = 0;
+	std::int32_t layerIndex = 0;
+	GlobalCFrame cframe;
+	Vec3 vecA;
+	Vec3 vecB;
+	Position position;
+	PartProperties properties{};
+	double strength = 0.0;
+	double speedStrength = 0.0;
+	std::uint64_t checksum = 0;
+	// serializeParts of the added part
+	std::string partData;
+};
+
+/*
+	Replays a recording of a WorldRecorder on an empty world, without anything else than the physics engine
+	The recorded world is deserialized into the world at construction, the events are all read up front so replaying is only ticking
+	Parts added or removed during the replay are owned by the replayer
+*/
+class WorldReplayer {
+	WorldPrototype& world;
+	std::vector<RecordedEvent> events;
+	std::size_t nextEvent = 0;
+	// by the ID the recorder gave them, nullptr once removed
+	std::vector<Part*> parts;
+	std::vector<Part*> removedParts;
+	MagnetForce magnet;
+	bool magnetAdded = false;
+	std::uint64_t startAge = 0;
+	std::uint64_t endAge = 0;
+
+	std::size_t checkedTicks = 0;
+	std::size_t mismatchedTicks = 0;
+	std::uint64_t firstMismatchAge = 0;
+
+	Part* getPart(std::uint32_t partID) const;
+	void applyEvent(const RecordedEvent& event);
+
+public:
+	// throws a SerializationException if the stream is not a recording
+	WorldReplayer(WorldPrototype& world, std::istream& istream);
+	~WorldReplayer();
+	WorldReplayer(const WorldReplayer&) = delete;
+	WorldReplayer& operator=(const WorldReplayer&) = delete;
+
+	// applies what was done to the world before its next tick
+	void applyEvents();
+	// compares the world to the checksum recorded after its last tick, if there is one
+	void checkTick();
+	// applyEvents, a tick and checkTick
+	void tick();
+	void tick(ThreadPool& threadPool);
+
+	bool isFinished() const;
+	// the number of ticks the recording spans
+	std::size_t getTickCount() const;
+
+	inline std::size_t getCheckedTickCount() const { return checkedTicks; }
+	inline std::size_t getMismatchedTickCount() const { return mismatchedTicks; }
+	// only valid if there was a mismatch
+	inline std::uint64_t getFirstMismatchAge() const { return firstMismatchAge; }
+};
+};
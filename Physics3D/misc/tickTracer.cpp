@@ -0,0 +1,166 @@
+#include "tickTracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+
+#include "debug.h"
+
+namespace P3D {
+TickTracer tickTracer;
+
+TraceRingBuffer::TraceRingBuffer(std::size_t capacity, int threadIndex) : events(new TraceEvent[capacity]), capacity(capacity), threadIndex(threadIndex) {}
+
+std::vector<TraceEvent> TraceRingBuffer::copyEvents() const {
+	std::uint64_t end = head.load(std::memory_order_acquire);
+	std::uint64_t start = end > capacity ? end - capacity : 0;
+
+	std::vector<TraceEvent> result;
+	result.reserve(end - start);
+	for(std::uint64_t i = start; i < end; i++) {
+		result.push_back(events[i % capacity]);
+	}
+
+	// the owner may have kept recording while copying, the slot it writes next is the one of event newEnd - capacity
+	// the fence keeps the reads of the events above from being moved after the second read of head
+	std::atomic_thread_fence(std::memory_order_acquire);
+	std::uint64_t newEnd = head.load(std::memory_order_acquire);
+	if(newEnd + 1 > start + capacity) {
+		std::size_t overwritten = static_cast<std::size_t>(std::min<std::uint64_t>(newEnd + 1 - capacity - start, result.size()));
+		result.erase(result.begin(), result.begin() + overwritten);
+	}
+	return result;
+}
+
+void TraceRingBuffer::clear() {
+	head.store(0, std::memory_order_release);
+}
+
+TraceRingBuffer& TickTracer::getThreadBuffer() {
+	struct ThreadBuffer {
+		const TickTracer* owner = nullptr;
+		TraceRingBuffer* buffer = nullptr;
+	};
+	thread_local ThreadBuffer threadBuffer;
+
+	if(threadBuffer.owner != this) {
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		buffers.push_back(std::make_unique<TraceRingBuffer>(eventsPerThread, static_cast<int>(buffers.size())));
+		threadBuffer.owner = this;
+		threadBuffer.buffer = buffers.back().get();
+	}
+	return *threadBuffer.buffer;
+}
+
+void TickTracer::record(const char* name, TraceEventType type, long long value) {
+	long long timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	getThreadBuffer().add(TraceEvent{name, timestamp, currentTick.load(std::memory_order_relaxed), value, type});
+}
+
+void TickTracer::enable(std::size_t eventsPerThread) {
+	this->eventsPerThread = std::max<std::size_t>(eventsPerThread, 16);
+	enabled.store(true, std::memory_order_relaxed);
+}
+
+void TickTracer::disable() {
+	enabled.store(false, std::memory_order_relaxed);
+}
+
+void TickTracer::clear() {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	for(const std::unique_ptr<TraceRingBuffer>& buffer : buffers) {
+		buffer->clear();
+	}
+}
+
+void TickTracer::setLatencyBudget(std::chrono::nanoseconds budget, const std::string& filePrefix, int maxDumps) {
+	this->latencyBudget = budget;
+	this->spikeFilePrefix = filePrefix;
+	this->spikeDumpsLeft = maxDumps;
+}
+
+void TickTracer::beginTick() {
+	if(!isEnabled()) return;
+	currentTick.fetch_add(1, std::memory_order_relaxed);
+	tickStart = std::chrono::steady_clock::now();
+	record("tick", TraceEventType::BEGIN, -1);
+}
+
+void TickTracer::endTick() {
+	if(!isEnabled()) return;
+	record("tick", TraceEventType::END, -1);
+
+	if(latencyBudget.count() == 0 || spikeDumpsLeft <= 0) return;
+	std::chrono::nanoseconds tickTime = std::chrono::steady_clock::now() - tickStart;
+	if(tickTime > latencyBudget) {
+		spikeDumpsLeft--;
+		std::string fileName = spikeFilePrefix + std::to_string(getCurrentTick()) + ".json";
+		if(writeChromeTrace(fileName)) {
+			Debug::logWarn("Tick %llu took %lld us, trace written to %s\n", static_cast<unsigned long long>(getCurrentTick()), static_cast<long long>(tickTime.count() / 1000), fileName.c_str());
+		}
+	}
+}
+
+static void writeEventName(std::ostream& out, const char* name) {
+	out << '"';
+	for(const char* c = name; *c != '\0'; c++) {
+		if(*c == '"' || *c == '\\') out << '\\';
+		out << *c;
+	}
+	out << '"';
+}
+
+void TickTracer::writeChromeTrace(std::ostream& out) const {
+	std::stringstream ss;
+	ss << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	ss << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Physics3D\"}}";
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	for(const std::unique_ptr<TraceRingBuffer>& buffer : buffers) {
+		int tid = buffer->threadIndex;
+		ss << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":\"Thread " << tid << "\"}}";
+
+		// ends whose begin was overwritten in the ring buffer are dropped, so the spans of a thread stay nested
+		int depth = 0;
+		for(const TraceEvent& e : buffer->copyEvents()) {
+			if(e.type == TraceEventType::END) {
+				if(depth == 0) continue;
+				depth--;
+			} else if(e.type == TraceEventType::BEGIN) {
+				depth++;
+			}
+
+			const char* phase = e.type == TraceEventType::BEGIN ? "B" : e.type == TraceEventType::END ? "E" : "C";
+			ss << ",\n{\"name\":";
+			writeEventName(ss, e.name);
+			// timestamps are in microseconds
+			ss << ",\"ph\":\"" << phase << "\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << e.timestamp / 1000 << '.';
+			ss.width(3);
+			ss.fill('0');
+			ss << e.timestamp % 1000;
+			// every arg of a counter is drawn as a series, so those only get their value
+			if(e.type == TraceEventType::COUNTER) {
+				ss << ",\"args\":{\"value\":" << e.value << "}}";
+			} else {
+				ss << ",\"args\":{\"tick\":" << e.tick;
+				if(e.value != -1) ss << ",\"count\":" << e.value;
+				ss << "}}";
+			}
+		}
+	}
+	ss << "\n]}\n";
+
+	out << ss.str();
+}
+
+bool TickTracer::writeChromeTrace(const std::string& fileName) const {
+	std::ofstream file(fileName);
+	if(!file) {
+		Debug::logWarn("Could not open %s to write the trace\n", fileName.c_str());
+		return false;
+	}
+	writeChromeTrace(file);
+	return true;
+}
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace P3D {
+enum class TraceEventType : std::uint8_t {
+	BEGIN,
+	END,
+	COUNTER
+};
+
+/*
+	name must be a string literal or otherwise outlive the tracer, only the pointer is stored
+	value is the count attached to an END or the value of a COUNTER, -1 if there is none
+*/
+struct TraceEvent {
+	const char* name;
+	long long timestamp;
+	std::uint64_t tick;
+	long long value;
+	TraceEventType type;
+};
+
+/*
+	The events of one thread, only that thread writes to it so recording needs no locks
+	Old events are overwritten once the buffer is full
+	Readers copy the published events and drop the ones that may have been overwritten while copying
+*/
+class TraceRingBuffer {
+	std::unique_ptr<TraceEvent[]> events;
+	std::size_t capacity;
+	std::atomic<std::uint64_t> head{0};
+
+public:
+	const int threadIndex;
+
+	TraceRingBuffer(std::size_t capacity, int threadIndex);
+
+	inline void add(const TraceEvent& event) {
+		std::uint64_t index = head.load(std::memory_order_relaxed);
+		events[index % capacity] = event;
+		head.store(index + 1, std::memory_order_release);
+	}
+
+	// the events still in the buffer, oldest first
+	std::vector<TraceEvent> copyEvents() const;
+	// must not race with add
+	void clear();
+};
+
+/*
+	Optional tracing backend, records begin and end events per thread and writes them as Chrome Trace Event JSON
+	The result opens in chrome://tracing and ui.perfetto.dev and shows what every thread did within every tick
+	Recording does nothing but check a flag while the tracer is disabled
+	Every thread that records gets its own TraceRingBuffer the first time it does so, the buffers live as long as the tracer
+*/
+class TickTracer {
+	std::atomic<bool> enabled{false};
+	std::atomic<std::uint64_t> currentTick{0};
+	std::size_t eventsPerThread = 1 << 16;
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point tickStart;
+
+	std::chrono::nanoseconds latencyBudget{0};
+	std::string spikeFilePrefix;
+	int spikeDumpsLeft = 0;
+
+	// protects buffers, only taken when a thread records its first event
+	mutable std::mutex buffersMutex;
+	std::vector<std::unique_ptr<TraceRingBuffer>> buffers;
+
+	TraceRingBuffer& getThreadBuffer();
+	void record(const char* name, TraceEventType type, long long value);
+
+public:
+	inline bool isEnabled() const {
+		return enabled.load(std::memory_order_relaxed);
+	}
+	// eventsPerThread applies to threads that record for the first time after this call
+	void enable(std::size_t eventsPerThread = 1 << 16);
+	void disable();
+	// drops all recorded events, must not be called while other threads are recording
+	void clear();
+
+	/*
+		Once a tick takes longer than budget, the trace is written to <filePrefix><tick>.json, at most maxDumps times
+		A budget of zero turns this off
+	*/
+	void setLatencyBudget(std::chrono::nanoseconds budget, const std::string& filePrefix, int maxDumps = 10);
+
+	inline void begin(const char* name) {
+		if(isEnabled()) record(name, TraceEventType::BEGIN, -1);
+	}
+	inline void end(const char* name, long long count = -1) {
+		if(isEnabled()) record(name, TraceEventType::END, count);
+	}
+	inline void counter(const char* name, long long value) {
+		if(isEnabled()) record(name, TraceEventType::COUNTER, value);
+	}
+
+	// called by the thread that ticks the world, every event is tagged with the number of the tick it happened in
+	void beginTick();
+	void endTick();
+	inline std::uint64_t getCurrentTick() const {
+		return currentTick.load(std::memory_order_relaxed);
+	}
+
+	// the events of every thread, in the Chrome Trace Event format
+	void writeChromeTrace(std::ostream& out) const;
+	bool writeChromeTrace(const std::string& fileName) const;
+};
+
+extern TickTracer tickTracer;
+
+// traces the lifetime of this object on the current thread
+class TraceScope {
+	const char* name;
+	long long count = -1;
+
+public:
+	inline TraceScope(const char* name) : name(name) {
+		tickTracer.begin(name);
+	}
+	inline ~TraceScope() {
+		tickTracer.end(name, count);
+	}
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+	// attached to the end event, such as the number of pairs processed in this scope
+	inline void setCount(long long count) {
+		this->count = count;
+	}
+};
+};
@@ -12,6 +12,7 @@
 
 
 #include "layer.h"
+#include "world.h"
 
 namespace P3D {
 namespace {
@@ -26,6 +27,10 @@ void recalculateAndUpdateParent(Part* part, const Bounds& oldBounds) {
 		phys->notifyPartPropertiesChanged(part);
 	}
 	if(part->layer != nullptr) part->layer->notifyPartBoundsUpdated(part, oldBounds);
+
+	// cached intersections of the old hitbox no longer apply
+	WorldPrototype* world = part->getWorld();
+	if(world != nullptr) world->contactCache.forgetPart(part);
 }
 };
 
@@ -111,6 +116,29 @@ PartIntersection Part::intersects(const Part& other) const {
 	return PartIntersection();
 }
 
+PartIntersection Part::intersects(const Part& other, const Tetrahedron& gjkResult) const {
+	CFrame relativeTransform = this->cframe.globalToLocal(other.cframe);
+	std::optional<Intersection> result = intersectsTransformed(this->hitbox, other.hitbox, relativeTransform, gjkResult);
+	if(result) {
+		Position intersection = this->cframe.localToGlobal(result.value().intersection);
+		Vec3 exitVector = this->cframe.localToRelative(result.value().exitVector);
+
+		catchable_assert(isVecValid(exitVector));
+
+		return PartIntersection(intersection, exitVector);
+	}
+	return PartIntersection();
+}
+
+PartSeparation Part::getSeparation(const Part& other) const {
+	CFrame relativeTransform = this->cframe.globalToLocal(other.cframe);
+	std::optional<ClosestPoints> result = closestPointsTransformed(this->hitbox, other.hitbox, relativeTransform);
+	if(result) {
+		return PartSeparation(this->cframe.localToGlobal(result.value().onFirst), this->cframe.localToGlobal(result.value().onSecond));
+	}
+	return PartSeparation();
+}
+
 BoundingBox Part::getLocalBounds() const {
 	Vec3 v = Vec3(this->hitbox.scale[0], this->hitbox.scale[1], this->hitbox.scale[2]);
 	return BoundingBox(-v, v);
@@ -125,6 +153,18 @@ BoundsTemplate<float> Part::getBounds() const {
 	return BoundsTemplate<float>(boundsOfHitbox + getPosition());
 }
 
+BoundsTemplate<float> Part::getSweptBounds(double deltaT) const {
+	BoundsTemplate<float> currentBounds = this->getBounds();
+	Motion motion = this->getMotion();
+
+	// rotation can move no point of the part further than maxRadius away from it's rotated position
+	float rotationTravel = static_cast<float>(std::min(length(motion.getAngularVelocity()) * deltaT, 2.0) * this->maxRadius);
+	Vec3f travel(motion.getVelocity() * deltaT);
+	BoundsTemplate<float> predictedBounds(currentBounds.min + travel, currentBounds.max + travel);
+
+	return unionOfBounds(currentBounds, predictedBounds.expanded(rotationTravel));
+}
+
 void Part::scale(double scaleX, double scaleY, double scaleZ) {
 	Bounds oldBounds = this->getBounds();
 	this->hitbox = this->hitbox.scaled(scaleX, scaleY, scaleZ);
@@ -21,6 +21,8 @@ class WorldPrototype;
 #include "motion.h"
 
 namespace P3D {
+struct Tetrahedron;
+
 struct PartProperties {
 	double density;
 	double friction;
@@ -47,6 +49,18 @@ struct PartIntersection {
 		exitVector(exitVector) {}
 };
 
+struct PartSeparation {
+	bool separated;
+	Position closestOnFirst;
+	Position closestOnSecond;
+
+	PartSeparation() : separated(false) {}
+	PartSeparation(const Position& closestOnFirst, const Position& closestOnSecond) :
+		separated(true),
+		closestOnFirst(closestOnFirst),
+		closestOnSecond(closestOnSecond) {}
+};
+
 class Part {
 	friend class RigidBody;
 	friend class Physical;
@@ -78,10 +92,16 @@ public:
 	WorldPrototype* getWorld();
 
 	PartIntersection intersects(const Part& other) const;
+	// finishes an intersection test for which the GJK stage has already been run, see runGJKBatch
+	PartIntersection intersects(const Part& other, const Tetrahedron& gjkResult) const;
+	// nearest points of both parts, only if they do not intersect
+	PartSeparation getSeparation(const Part& other) const;
 	void scale(double scaleX, double scaleY, double scaleZ);
 	void setScale(const DiagonalMat3& scale);
 	
 	BoundsTemplate<float> getBounds() const;
+	// union of the current bounds and the bounds after moving deltaT with the part's current motion
+	BoundsTemplate<float> getSweptBounds(double deltaT) const;
 	BoundingBox getLocalBounds() const;
 
 	Position getPosition() const { return cframe.getPosition(); }
@@ -37,7 +37,9 @@ Physical::Physical(RigidBody&& rigidBody, MotorizedPhysical* mainPhysical) : rig
 Physical::Physical(Physical&& other) noexcept :
 	rigidBody(std::move(other.rigidBody)), 
 	mainPhysical(other.mainPhysical),
-	childPhysicals(std::move(other.childPhysicals)) {
+	childPhysicals(std::move(other.childPhysicals)),
+	subtree(other.subtree),
+	subtreeIsDirty(other.subtreeIsDirty) {
 	this->rigidBody.mainPart->setRigidBodyPhysical(this);
 	for(ConnectedPhysical& p : this->childPhysicals) {
 		p.parent = this;
@@ -48,6 +50,8 @@ Physical& Physical::operator=(Physical&& other) noexcept {
 	this->rigidBody = std::move(other.rigidBody);
 	this->mainPhysical = other.mainPhysical;
 	this->childPhysicals = std::move(other.childPhysicals);
+	this->subtree = other.subtree;
+	this->subtreeIsDirty = other.subtreeIsDirty;
 	this->rigidBody.mainPart->setRigidBodyPhysical(this);
 	for(ConnectedPhysical& p : this->childPhysicals) {
 		p.parent = this;
@@ -99,6 +103,7 @@ void Physical::makeMainPart(AttachedPart& newMainPart) {
 		ConnectedPhysical* self = (ConnectedPhysical*) this;
 		self->connectionToParent.attachOnChild = newCenterCFrame.globalToLocal(self->connectionToParent.attachOnChild);
 	}
+	markSubtreeDirty();
 }
 
 template<typename T>
@@ -106,6 +111,13 @@ static inline bool liesInVector(const std::vector<T>& vec, const T* ptr) {
 	return &vec[0] <= ptr && &vec[0]+vec.size() > ptr;
 }
 
+static void markAllSubtreesDirty(Physical& phys) {
+	phys.subtreeIsDirty = true;
+	for(ConnectedPhysical& child : phys.childPhysicals) {
+		markAllSubtreesDirty(child);
+	}
+}
+
 /*
 	We will build a new tree, starting from a copy of the current physical
 
@@ -192,6 +204,7 @@ void ConnectedPhysical::makeMainPhysical() {
 	*P = std::move(newTop);
 
 	MotorizedPhysical* OP = static_cast<MotorizedPhysical*>(P);
+	markAllSubtreesDirty(*OP);
 	OP->refreshPhysicalProperties();
 }
 
@@ -263,6 +276,7 @@ void Physical::attachPhysical(MotorizedPhysical* phys, HardConstraint* constrain
 
 	childPhysicals.back().refreshCFrameRecursive();
 
+	markSubtreeDirty();
 	mainPhysical->refreshPhysicalProperties();
 }
 
@@ -277,6 +291,7 @@ void Physical::attachPart(Part* part, HardConstraint* constraint, const CFrame&
 		}
 		childPhysicals.push_back(ConnectedPhysical(Physical(part, this->mainPhysical), this, constraint, attachToThat, attachToThis));
 		childPhysicals.back().refreshCFrame();
+		markSubtreeDirty();
 	}
 
 	mainPhysical->refreshPhysicalProperties();
@@ -326,6 +341,7 @@ void Physical::attachPhysical(MotorizedPhysical* phys, const CFrame& attachment)
 
 	delete phys;
 
+	markSubtreeDirty();
 	mainPhysical->refreshPhysicalProperties();
 }
 
@@ -350,6 +366,7 @@ void Physical::attachPart(Part* part, const CFrame& attachment) {
 		}
 		part->parent = this;
 		rigidBody.attach(part, attachment);
+		markSubtreeDirty();
 	}
 	this->mainPhysical->refreshPhysicalProperties();
 }
@@ -365,11 +382,13 @@ void Physical::detachAllChildPhysicals() {
 	}
 
 	childPhysicals.clear(); // calls the destructors on all (now invalid) children, deleting the constraints in the process
+	markSubtreeDirty();
 }
 
 void Physical::detachFromRigidBody(Part* part) {
 	part->parent = nullptr;
 	rigidBody.detach(part);
+	markSubtreeDirty();
 	WorldPrototype* world = this->getWorld();
 	// TODO?
 }
@@ -377,6 +396,7 @@ void Physical::detachFromRigidBody(Part* part) {
 void Physical::detachFromRigidBody(AttachedPart&& part) {
 	part.part->parent = nullptr;
 	rigidBody.detach(std::move(part));
+	markSubtreeDirty();
 }
 
 static void computeInternalRelativeMotionTree(MonotonicTreeBuilder<RelativeMotion>& builder, MonotonicTreeNode<RelativeMotion>& curNode, const ConnectedPhysical& conPhys, const RelativeMotion& motionOfParent) {
@@ -461,6 +481,7 @@ void Physical::detachPart(Part* part) {
 			if(world != nullptr) {
 				world->notifyPhysicalHasBeenSplit(mainPhys, newPhys);
 			}
+			self.parent->markSubtreeDirty();
 			self.parent->childPhysicals.remove(std::move(self)); // double move, but okay, since remove really only needs the address of self
 			mainPhys->refreshPhysicalProperties();
 		}
@@ -489,6 +510,7 @@ void Physical::removePart(Part* part) {
 		MotorizedPhysical* mainPhys = this->mainPhysical; // save main physical because it'll get deleted by parent->detachChild()
 		if(this != mainPhys) {
 			ConnectedPhysical& self = static_cast<ConnectedPhysical&>(*this);
+			self.parent->markSubtreeDirty();
 			self.parent->childPhysicals.remove(std::move(self));
 			mainPhys->refreshPhysicalProperties();
 		} else {
@@ -507,9 +529,26 @@ void Physical::removePart(Part* part) {
 	part->parent = nullptr;
 }
 
-// TODO: this seems to need to update the encompassing MotorizedPhysical as well
 void Physical::notifyPartPropertiesChanged(Part* part) {
 	rigidBody.refreshWithNewParts();
+	markSubtreeDirty();
+	mainPhysical->refreshPhysicalProperties();
+}
+
+void Physical::setAttachFor(Part* part, const CFrame& attach) {
+	rigidBody.setAttachFor(part, attach);
+	rigidBody.setCFrame(rigidBody.getCFrame());
+	markSubtreeDirty();
+	mainPhysical->refreshPhysicalProperties();
+}
+
+void Physical::markSubtreeDirty() {
+	Physical* cur = this;
+	while(true) {
+		cur->subtreeIsDirty = true;
+		if(cur->isMainPhysical()) break;
+		cur = static_cast<ConnectedPhysical*>(cur)->parent;
+	}
 }
 void Physical::notifyPartStdMoved(Part* oldPartPtr, Part* newPartPtr) noexcept {
 	rigidBody.notifyPartStdMoved(oldPartPtr, newPartPtr);
@@ -519,6 +558,9 @@ void Physical::updateConstraints(double deltaT) {
 	for(ConnectedPhysical& p : childPhysicals) {
 		p.connectionToParent.update(deltaT);
 		p.updateConstraints(deltaT);
+		if(p.subtreeIsDirty || p.connectionToParent.constraintWithParent->isMoving()) {
+			this->subtreeIsDirty = true;
+		}
 	}
 }
 
@@ -586,16 +628,71 @@ void MotorizedPhysical::translate(const Vec3& translation) {
 	translateUnsafeRecursive(translation);
 }
 
-void MotorizedPhysical::refreshPhysicalProperties() {
-	ALLOCA_COMMotionTree(cache, this, size);
+/*
+	Inward pass over the hard constraint tree, as in Featherstone's articulated body algorithm.
+	Hard constraints prescribe the motion of every joint, so the articulated inertia of a subtree reduces to it's composite inertia.
+	Each Physical combines it's RigidBody with the results of it's children, making this O(n) in the number of Physicals without any allocations
+	Only Physicals marked with subtreeIsDirty are recomputed, the static parts of a structure are reused from the previous refresh
+*/
+void Physical::refreshSubtreeProperties() {
+	if(!subtreeIsDirty) return;
 
-	this->totalCenterOfMass = cache.centerOfMass;
-	this->totalMass = cache.totalMass;
+	double totalMass = rigidBody.mass;
+	Vec3 totalMassMoment = rigidBody.localCenterOfMass * rigidBody.mass;
+	TranslationalMotion totalMomentum;
 
-	SymmetricMat3 totalInertia = cache.getInertia();
+	for(ConnectedPhysical& child : childPhysicals) {
+		child.refreshSubtreeProperties();
 
-	this->forceResponse = SymmetricMat3::IDENTITY() * (1 / cache.totalMass);
-	this->momentResponse = ~totalInertia;
+		SubtreeProperties& childTree = child.subtree;
+		RelativeMotion motionOfChildCenterOfMass(Motion(childTree.motionOfCenterOfMass), CFrame(childTree.centerOfMass));
+		childTree.relativeToParent = child.getRelativeMotionBetweenParentAndSelf() + motionOfChildCenterOfMass;
+
+		totalMass += childTree.mass;
+		totalMassMoment += childTree.relativeToParent.locationOfRelativeMotion.getPosition() * childTree.mass;
+		totalMomentum += childTree.relativeToParent.relativeMotion.translation * childTree.mass;
+	}
+
+	Vec3 centerOfMass = totalMassMoment * (1 / totalMass);
+	TranslationalMotion motionOfCenterOfMass = totalMomentum * (1 / totalMass);
+
+	Vec3 rigidBodyCOMOffset = rigidBody.localCenterOfMass - centerOfMass;
+	SymmetricMat3 inertia = getTranslatedInertiaAroundCenterOfMass(rigidBody.inertia, rigidBody.mass, rigidBodyCOMOffset);
+	Vec3 internalAngularMomentum = getAngularMomentumFromOffsetOnlyVelocity(rigidBodyCOMOffset, -motionOfCenterOfMass.getVelocity(), rigidBody.mass);
+
+	for(const ConnectedPhysical& child : childPhysicals) {
+		const SubtreeProperties& childTree = child.subtree;
+		const RelativeMotion& childMotion = childTree.relativeToParent;
+		Rotation childRotation = childMotion.locationOfRelativeMotion.getRotation();
+		Vec3 childCOMOffset = childMotion.locationOfRelativeMotion.getPosition() - centerOfMass;
+
+		inertia += getTransformedInertiaAroundCenterOfMass(childTree.inertia, childTree.mass, CFrame(childCOMOffset, childRotation));
+
+		internalAngularMomentum += getAngularMomentumFromOffset(
+			childCOMOffset,
+			childMotion.relativeMotion.getVelocity() - motionOfCenterOfMass.getVelocity(),
+			childMotion.relativeMotion.getAngularVelocity(),
+			childRotation.localToGlobal(childTree.inertia),
+			childTree.mass);
+		internalAngularMomentum += childRotation.localToGlobal(childTree.internalAngularMomentum);
+	}
+
+	subtree.mass = totalMass;
+	subtree.centerOfMass = centerOfMass;
+	subtree.motionOfCenterOfMass = motionOfCenterOfMass;
+	subtree.inertia = inertia;
+	subtree.internalAngularMomentum = internalAngularMomentum;
+	subtreeIsDirty = false;
+}
+
+void MotorizedPhysical::refreshPhysicalProperties() {
+	refreshSubtreeProperties();
+
+	this->totalCenterOfMass = subtree.centerOfMass;
+	this->totalMass = subtree.mass;
+
+	this->forceResponse = SymmetricMat3::IDENTITY() * (1 / subtree.mass);
+	this->momentResponse = ~subtree.inertia;
 }
 
 void ConnectedPhysical::refreshCFrame() {
@@ -614,6 +711,7 @@ void MotorizedPhysical::fullRefreshOfConnectedPhysicals() {
 	for(ConnectedPhysical& conPhys : childPhysicals) {
 		conPhys.refreshCFrameRecursive();
 	}
+	markAllSubtreesDirty(*this);
 }
 
 #pragma endregion
@@ -846,11 +944,8 @@ Vec3 MotorizedPhysical::getTotalImpulse() const {
 Vec3 MotorizedPhysical::getTotalAngularMomentum() const {
 	Rotation selfRot = this->getCFrame().getRotation();
 
-	ALLOCA_COMMotionTree(cache, this, size);
-
-	SymmetricMat3 totalInertia = selfRot.localToGlobal(cache.getInertia());
-	Vec3 localInternalAngularMomentum = cache.getInternalAngularMomentum();
-	Vec3 globalInternalAngularMomentum = selfRot.localToGlobal(localInternalAngularMomentum);
+	SymmetricMat3 totalInertia = selfRot.localToGlobal(subtree.inertia);
+	Vec3 globalInternalAngularMomentum = selfRot.localToGlobal(subtree.internalAngularMomentum);
 	
 	Vec3 externalAngularMomentum = totalInertia * this->motionOfCenterOfMass.getAngularVelocity();
 
@@ -866,12 +961,10 @@ Motion Physical::getMotion() const {
 }
 
 Motion MotorizedPhysical::getMotion() const {
-	ALLOCA_COMMotionTree(cache, this, size);
-
 	GlobalCFrame cf = this->getCFrame();
-	TranslationalMotion motionOfCom = localToGlobal(cf.getRotation(), cache.motionOfCenterOfMass);
+	TranslationalMotion motionOfCom = localToGlobal(cf.getRotation(), subtree.motionOfCenterOfMass);
 
-	return -motionOfCom + motionOfCenterOfMass.getMotionOfPoint(cf.localToRelative(-cache.centerOfMass));
+	return -motionOfCom + motionOfCenterOfMass.getMotionOfPoint(cf.localToRelative(-subtree.centerOfMass));
 }
 Motion ConnectedPhysical::getMotion() const {
 	// All motion and offset variables here are expressed in the global frame
@@ -30,11 +30,30 @@ class MotorizedPhysical;
 class InternalMotionTree;
 class COMMotionTree;
 
+/*
+	Mass properties of a Physical together with all of it's children, as computed by Physical::refreshSubtreeProperties()
+	All values are expressed in the local frame of the Physical they belong to,
+	motions only describe the internal motion caused by the hard constraints in the subtree
+*/
+struct SubtreeProperties {
+	double mass = 0.0;
+	Vec3 centerOfMass = Vec3(0.0, 0.0, 0.0);
+	// motion of centerOfMass relative to the Physical's frame
+	TranslationalMotion motionOfCenterOfMass;
+	// inertia around centerOfMass
+	SymmetricMat3 inertia;
+	// angular momentum around centerOfMass caused by the internal motion of the subtree
+	Vec3 internalAngularMomentum = Vec3(0.0, 0.0, 0.0);
+	// location and motion of centerOfMass relative to the parent Physical's frame, only used for ConnectedPhysicals
+	RelativeMotion relativeToParent;
+};
+
 class Physical {
 	void makeMainPart(AttachedPart& newMainPart);
 protected:
 	void updateAttachedPhysicals();
 	void updateConstraints(double deltaT);
+	void refreshSubtreeProperties();
 	void translateUnsafeRecursive(const Vec3Fix& translation);
 
 	void setMainPhysicalRecursive(MotorizedPhysical* newMainPhysical);
@@ -93,6 +112,10 @@ public:
 	MotorizedPhysical* mainPhysical;
 	UnorderedVector<ConnectedPhysical> childPhysicals;
 
+	// refreshed by MotorizedPhysical::refreshPhysicalProperties(), only for the Physicals marked dirty
+	SubtreeProperties subtree;
+	bool subtreeIsDirty = true;
+
 	Physical() = default;
 	Physical(Part* mainPart, MotorizedPhysical* mainPhysical);
 	Physical(RigidBody&& rigidBody, MotorizedPhysical* mainPhysical);
@@ -165,6 +188,10 @@ public:
 	size_t getNumberOfPartsInThisAndChildren() const;
 
 	void notifyPartPropertiesChanged(Part* part);
+	// moves part within this Physical's rigid body, use this instead of RigidBody::setAttachFor so the mass properties are refreshed
+	void setAttachFor(Part* part, const CFrame& attach);
+	// marks this Physical and all it's parents for recomputation of their SubtreeProperties
+	void markSubtreeDirty();
 	void notifyPartStdMoved(Part* oldPartPtr, Part* newPartPtr) noexcept;
 
 	bool isValid() const;
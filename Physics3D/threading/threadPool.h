@@ -6,6 +6,8 @@
 #include <mutex>
 #include <condition_variable>
 
+#include "../misc/tickTracer.h"
+
 namespace P3D {
 class ThreadPool {
 	std::function<void()> funcToRun = []() {};
@@ -68,10 +70,12 @@ public:
 		selfLock.unlock();
 		threadStarter.notify_all();// all threads start running
 		funcToRun();
+		tickTracer.begin("waitForPool");
 		selfLock.lock();
 		shouldStart = false;
 		threadsFinished.wait(selfLock, [this]() -> bool {return threadsWorking == 0; });
 		selfLock.unlock();
+		tickTracer.end("waitForPool");
 	}
 };
 };
\ No newline at end of file
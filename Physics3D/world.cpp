@@ -262,6 +262,7 @@ void WorldPrototype::clear() {
 		this->onPartRemoved(p);
 		this->deletePart(p);
 	}
+	this->contactCache.clear();
 }
 
 int WorldPrototype::getLayerCount() const {
@@ -10,6 +10,7 @@
 #include "softlinks/softLink.h"
 #include "externalforces/externalForce.h"
 #include "colissionBuffer.h"
+#include "contactCache.h"
 
 namespace P3D {
 class Physical;
@@ -63,10 +64,30 @@ public:
 	void addLink(SoftLink* link);
 
 	ColissionBuffer curColissions;
+	ContactCache contactCache;
 	size_t age = 0;
 	size_t objectCount = 0;
 	double deltaT;
 
+	// colissions are graph coloured and handled in parallel batches on the tick's ThreadPool, the result is identical to sequential handling
+	bool parallelColissionHandling = false;
+
+	// islands of colliding physicals that move or penetrate further than subStepTravelFraction * Part::maxRadius within one tick
+	// are integrated in up to maxSubSteps smaller steps, reusing the colission pairs found at the start of the tick
+	bool adaptiveSubStepping = false;
+	int maxSubSteps = 8;
+	double subStepTravelFraction = 0.25;
+
+	// parts that move further than speculativeTravelFraction * Part::maxRadius within one tick are checked against everything their swept bounds overlap,
+	// approaching parts are slowed down so they touch at the end of the tick instead of tunnelling through each other
+	bool speculativeContacts = false;
+	double speculativeTravelFraction = 0.5;
+
+	// colliding pairs whose parts moved less than contactReuseTolerance relative to each other since their intersection was computed
+	// reuse that intersection instead of running GJK and EPA again, settled piles then skip almost all narrowphase work
+	bool reuseRestingContacts = false;
+	double contactReuseTolerance = 0.001;
+
 
 	WorldPrototype(double deltaT);
 	~WorldPrototype();
@@ -2,6 +2,10 @@
 
 #include "world.h"
 #include "layer.h"
+#include "midphase.h"
+
+#include "geometry/batchedGJK.h"
+#include "geometry/shapeClass.h"
 
 #include "math/mathUtil.h"
 #include "math/linalg/vec.h"
@@ -9,12 +13,22 @@
 
 #include "misc/debug.h"
 #include "misc/physicsProfiler.h"
+#include "misc/tickTracer.h"
 
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <optional>
+#include <functional>
+#include <utility>
 
 #define COLLISSION_DEPTH_FORCE_MULTIPLIER 2000
+// batches smaller than this are handled on the calling thread, waking the pool costs more than it gains
+#define MIN_PARALLEL_COLISSION_BATCH_SIZE 32
+// speculative contacts stop approaching parts this fraction of the smallest maxRadius apart, the regular colission handling ignores barely touching parts
+#define SPECULATIVE_CONTACT_MARGIN 0.01
 
 namespace P3D {
 /*
@@ -177,10 +191,65 @@ void handleTerrainCollision(Part& part1, Part& part2, Position collisionPoint, V
 	assert(phys1.isValid());
 }
 
+/*
+	separation is the vector from the closest point on part1 to the closest point on part2, the parts do not intersect
+	Only removes the part of the approach speed that would close the gap within deltaT, the parts end the tick a small margin apart
+	and the regular colission handling takes over from there
+*/
+void handleSpeculativeCollision(Part& part1, Part& part2, Position contactPoint, Vec3 separation, double deltaT) {
+	MotorizedPhysical& phys1 = *part1.getPhysical()->mainPhysical;
+	MotorizedPhysical& phys2 = *part2.getPhysical()->mainPhysical;
+
+	double distance = length(separation);
+	if(distance <= 0.0) return;
+	Vec3 normal = separation / distance;
+	double margin = std::min(part1.maxRadius, part2.maxRadius) * SPECULATIVE_CONTACT_MARGIN;
+
+	Vec3 relativeVelocity = part1.getMotion().getVelocityOfPoint(contactPoint - part1.getPosition()) - part2.getMotion().getVelocityOfPoint(contactPoint - part2.getPosition());
+	double excessApproachSpeed = relativeVelocity * normal - std::max(distance - margin, 0.0) / deltaT;
+	if(excessApproachSpeed <= 0.0) return;
+
+	Vec3 collissionRelP1 = contactPoint - phys1.getCenterOfMass();
+	Vec3 collissionRelP2 = contactPoint - phys2.getCenterOfMass();
+
+	double inertia1A = phys1.getInertiaOfPointInDirectionRelative(collissionRelP1, normal);
+	double inertia2A = phys2.getInertiaOfPointInDirectionRelative(collissionRelP2, normal);
+	double combinedInertia = 1 / (1 / inertia1A + 1 / inertia2A);
+
+	Vec3 impulse = -normal * (excessApproachSpeed * combinedInertia);
+	phys1.applyImpulse(collissionRelP1, impulse);
+	phys2.applyImpulse(collissionRelP2, -impulse);
+}
+
+/*
+	separation is the vector from the closest point on part1 to the closest point on the terrain part part2
+*/
+void handleSpeculativeTerrainCollision(Part& part1, Part& part2, Position contactPoint, Vec3 separation, double deltaT) {
+	MotorizedPhysical& phys1 = *part1.getPhysical()->mainPhysical;
+
+	double distance = length(separation);
+	if(distance <= 0.0) return;
+	Vec3 normal = separation / distance;
+	double margin = std::min(part1.maxRadius, part2.maxRadius) * SPECULATIVE_CONTACT_MARGIN;
+
+	Vec3 velocity = part1.getMotion().getVelocityOfPoint(contactPoint - part1.getPosition());
+	double excessApproachSpeed = velocity * normal - std::max(distance - margin, 0.0) / deltaT;
+	if(excessApproachSpeed <= 0.0) return;
+
+	Vec3 collissionRelP1 = contactPoint - phys1.getCenterOfMass();
+	double inertia = phys1.getInertiaOfPointInDirectionRelative(collissionRelP1, normal);
+
+	phys1.applyImpulse(collissionRelP1, -normal * (excessApproachSpeed * inertia));
+}
+
 /*
 	===== World Tick =====
 */
 
+static long long getColissionCount(const ColissionBuffer& colissions) {
+	return static_cast<long long>(colissions.freePartColissions.size() + colissions.freeTerrainColissions.size() + colissions.speculativePartColissions.size() + colissions.speculativeTerrainColissions.size());
+}
+
 void WorldPrototype::tick(ThreadPool& threadPool) {
 	tickWorldUnsynchronized(*this, threadPool);
 }
@@ -191,52 +260,116 @@ void WorldPrototype::tick() {
 }
 
 void tickWorldUnsynchronized(WorldPrototype& world, ThreadPool& threadPool) {
+	tickTracer.beginTick();
+
 	physicsMeasure.mark(PhysicsProcess::COLISSION_OTHER);
+	tickTracer.begin("findColissions");
 	findColissionsParallel(world, world.curColissions, threadPool);
+	if(world.speculativeContacts) {
+		findSpeculativeColissions(world, world.curColissions);
+	}
+	tickTracer.end("findColissions", getColissionCount(world.curColissions));
 
 	physicsMeasure.mark(PhysicsProcess::EXTERNALS);
+	tickTracer.begin("externals");
 	applyExternalForces(world);
+	std::vector<AccumulatedForce> externalForces;
+	if(world.adaptiveSubStepping) {
+		externalForces = recordExternalForces(world);
+	}
+	tickTracer.end("externals");
 
 	physicsMeasure.mark(PhysicsProcess::COLISSION_HANDLING);
-	handleColissions(world.curColissions);
+	tickTracer.begin("handleColissions");
+	if(world.parallelColissionHandling) {
+		handleColissionsParallel(world.curColissions, threadPool);
+	} else {
+		handleColissions(world.curColissions);
+	}
+	handleSpeculativeColissions(world.curColissions, world.deltaT);
+	tickTracer.end("handleColissions");
 
 	physicsMeasure.mark(PhysicsProcess::OTHER);
 	intersectionStatistics.nextTally();
 
 	physicsMeasure.mark(PhysicsProcess::CONSTRAINTS);
+	tickTracer.begin("constraints");
 	handleConstraints(world);
+	tickTracer.end("constraints");
 
 	physicsMeasure.mark(PhysicsProcess::UPDATING);
-	update(world);
+	tickTracer.begin("update");
+	if(world.adaptiveSubStepping) {
+		updateWithSubSteps(world, externalForces);
+	} else {
+		update(world);
+	}
+	tickTracer.end("update");
+
+	tickTracer.endTick();
 }
 
 void tickWorldSynchronized(WorldPrototype& world, ThreadPool& threadPool, UpgradeableMutex& worldMutex) {
+	tickTracer.beginTick();
+
 	physicsMeasure.mark(PhysicsProcess::WAIT_FOR_LOCK);
+	tickTracer.begin("waitForLock");
 	worldMutex.lock_upgradeable();
+	tickTracer.end("waitForLock");
 
 	physicsMeasure.mark(PhysicsProcess::COLISSION_OTHER);
+	tickTracer.begin("findColissions");
 	findColissionsParallel(world, world.curColissions, threadPool);
+	if(world.speculativeContacts) {
+		findSpeculativeColissions(world, world.curColissions);
+	}
+	tickTracer.end("findColissions", getColissionCount(world.curColissions));
 
 	physicsMeasure.mark(PhysicsProcess::EXTERNALS);
+	tickTracer.begin("externals");
 	applyExternalForces(world);
+	std::vector<AccumulatedForce> externalForces;
+	if(world.adaptiveSubStepping) {
+		externalForces = recordExternalForces(world);
+	}
+	tickTracer.end("externals");
 
 	physicsMeasure.mark(PhysicsProcess::COLISSION_HANDLING);
-	handleColissions(world.curColissions);
+	tickTracer.begin("handleColissions");
+	if(world.parallelColissionHandling) {
+		handleColissionsParallel(world.curColissions, threadPool);
+	} else {
+		handleColissions(world.curColissions);
+	}
+	handleSpeculativeColissions(world.curColissions, world.deltaT);
+	tickTracer.end("handleColissions");
 
 	physicsMeasure.mark(PhysicsProcess::OTHER);
 	intersectionStatistics.nextTally();
 
 	physicsMeasure.mark(PhysicsProcess::CONSTRAINTS);
+	tickTracer.begin("constraints");
 	handleConstraints(world);
+	tickTracer.end("constraints");
 
 	physicsMeasure.mark(PhysicsProcess::WAIT_FOR_LOCK);
+	tickTracer.begin("waitForLock");
 	worldMutex.upgrade();
+	tickTracer.end("waitForLock");
 
 	physicsMeasure.mark(PhysicsProcess::UPDATING);
-	update(world);
+	tickTracer.begin("update");
+	if(world.adaptiveSubStepping) {
+		updateWithSubSteps(world, externalForces);
+	} else {
+		update(world);
+	}
+	tickTracer.end("update");
 
 	physicsMeasure.mark(PhysicsProcess::WAIT_FOR_LOCK);
 	worldMutex.unlock();
+
+	tickTracer.endTick();
 }
 
 void applyExternalForces(WorldPrototype& world) {
@@ -267,81 +400,163 @@ PartIntersection safeIntersects(const Part& p1, const Part& p2) {
 #endif
 }
 
-void refineColissions(std::vector<Colission>& colissions) {
-	for (size_t i = 0; i < colissions.size();) {
+PartIntersection safeIntersects(const Part& p1, const Part& p2, const Tetrahedron& gjkResult) {
+#ifdef CATCH_INTERSECTION_ERRORS
+	try {
+		return p1.intersects(p2, gjkResult);
+	} catch(const std::exception& err) {
+		Debug::logError("Error occurred during intersection: %s", err.what());
 
-		Colission& col = colissions[i];
+		Debug::saveIntersectionError(p1, p2, "colError");
 
-		PartIntersection result = safeIntersects(*col.p1, *col.p2);
+		throw err;
+	} catch(...) {
+		Debug::logError("Unknown error occured during intersection");
 
-		if (result.intersects) {
+		Debug::saveIntersectionError(p1, p2, "colError");
 
-			intersectionStatistics.addToTally(IntersectionResult::COLISSION, 1);
+		throw "exit";
+	}
+#else
+	return p1.intersects(p2, gjkResult);
+#endif
+}
 
-			// add extra information
-			col.intersection = result.intersection;
-			col.exitVector = result.exitVector;
+static bool isBatchableColission(const Colission& col) {
+	return isBatchableGJKClass(col.p1->hitbox.baseShape->intersectionClassID) && isBatchableGJKClass(col.p2->hitbox.baseShape->intersectionClassID);
+}
 
+/*
+	Moves colissions that can go through the batched GJK to the front, sorted by the shape classes involved
+	This way runs of colissions with the same shape classes fill whole GJK batches
+*/
+static void groupColissionsForBatching(std::vector<Colission>& colissions) {
+	auto batchableEnd = std::partition(colissions.begin(), colissions.end(), isBatchableColission);
+	std::sort(colissions.begin(), batchableEnd, [](const Colission& a, const Colission& b) {
+		std::pair<const ShapeClass*, const ShapeClass*> keyA(a.p1->hitbox.baseShape.get(), a.p2->hitbox.baseShape.get());
+		std::pair<const ShapeClass*, const ShapeClass*> keyB(b.p1->hitbox.baseShape.get(), b.p2->hitbox.baseShape.get());
+		return std::less<std::pair<const ShapeClass*, const ShapeClass*>>()(keyA, keyB);
+	});
+}
+
+/*
+	Computes the intersection of every colission of the given range
+	Consecutive batchable colissions with the same shape classes share a GJK batch, all others run one by one
+*/
+static void intersectColissions(const Colission* colissions, std::size_t count, PartIntersection* results) {
+	std::size_t i = 0;
+	while(i < count) {
+		if(!isBatchableColission(colissions[i])) {
+			results[i] = safeIntersects(*colissions[i].p1, *colissions[i].p2);
 			i++;
+			continue;
 		}
-		else {
 
-			intersectionStatistics.addToTally(IntersectionResult::GJK_REJECT, 1);
+		const ShapeClass* first = colissions[i].p1->hitbox.baseShape.get();
+		const ShapeClass* second = colissions[i].p2->hitbox.baseShape.get();
+		GJKBatch batch(first, second);
+		std::size_t batchStart = i;
+		while(i < count && !batch.isFull() && colissions[i].p1->hitbox.baseShape.get() == first && colissions[i].p2->hitbox.baseShape.get() == second) {
+			const Part& p1 = *colissions[i].p1;
+			const Part& p2 = *colissions[i].p2;
+			batch.add(p1.getCFrame().globalToLocal(p2.getCFrame()), p1.hitbox.scale, p2.hitbox.scale);
+			i++;
+		}
+
+		physicsMeasure.mark(PhysicsProcess::GJK_COL);
+		std::optional<Tetrahedron> gjkResults[GJKBatch::SIZE];
+		runGJKBatch(batch, gjkResults);
+		for(int lane = 0; lane < batch.size; lane++) {
+			const Colission& col = colissions[batchStart + lane];
+			if(gjkResults[lane]) {
+				results[batchStart + lane] = safeIntersects(*col.p1, *col.p2, gjkResults[lane].value());
+			} else {
+				results[batchStart + lane] = PartIntersection();
+			}
+		}
+	}
+}
 
-			col = std::move(colissions.back());
-			colissions.pop_back();
+// keeps only the intersecting colissions and fills in their intersection information
+static void applyIntersectionResults(std::vector<Colission>& colissions, const std::vector<PartIntersection>& results) {
+	std::size_t kept = 0;
+	for(std::size_t i = 0; i < colissions.size(); i++) {
+		if(results[i].intersects) {
+			intersectionStatistics.addToTally(IntersectionResult::COLISSION, 1);
 
+			// add extra information
+			Colission col = colissions[i];
+			col.intersection = results[i].intersection;
+			col.exitVector = results[i].exitVector;
+			colissions[kept++] = col;
+		} else {
+			intersectionStatistics.addToTally(IntersectionResult::GJK_REJECT, 1);
 		}
 	}
+	colissions.resize(kept);
+}
+
+void refineColissions(std::vector<Colission>& colissions) {
+	groupColissionsForBatching(colissions);
+
+	std::vector<PartIntersection> results(colissions.size());
+	intersectColissions(colissions.data(), colissions.size(), results.data());
+
+	applyIntersectionResults(colissions, results);
 }
 
 void parallelRefineColissions(ThreadPool& threadPool, std::vector<Colission>& colissions) {
-	std::vector<Colission> wantedColission;
+	groupColissionsForBatching(colissions);
+
+	std::vector<PartIntersection> results(colissions.size());
 	const size_t workEnd = colissions.size();
 	size_t currIndex = 0;
-	std::mutex colissionMutex, statsMutex, indexMutex, vecMutex;
+	std::mutex indexMutex;
 
 	threadPool.doInParallel([&] {
+		TraceScope trace("refineColissions");
+		long long refinedCount = 0;
 		while(true) {
 
+			// work is claimed a whole GJK batch at a time
 			indexMutex.lock();
 			size_t claimedWork = currIndex;
-			currIndex++;
+			currIndex += GJKBatch::SIZE;
 			indexMutex.unlock();
 
 			if(claimedWork >= workEnd) {
 				break;
 			}
 
-			Colission col = colissions[claimedWork];
-			PartIntersection result = safeIntersects(*col.p1, *col.p2);
-
-			if(result.intersects) {
-
-				statsMutex.lock();
-				intersectionStatistics.addToTally(IntersectionResult::COLISSION, 1);
-				statsMutex.unlock();
-
-
-				// add extra information
-				col.intersection = result.intersection;
-				col.exitVector = result.exitVector;
+			size_t claimedEnd = std::min(claimedWork + GJKBatch::SIZE, workEnd);
+			intersectColissions(colissions.data() + claimedWork, claimedEnd - claimedWork, results.data() + claimedWork);
+			refinedCount += claimedEnd - claimedWork;
+		}
+		trace.setCount(refinedCount);
+	});
 
+	applyIntersectionResults(colissions, results);
+}
 
-				vecMutex.lock();
-				wantedColission.push_back(col);
-				vecMutex.unlock();
-			} else {
+/*
+	Colissions whose parts barely moved relative to each other reuse their cached intersection, refine only runs on the others
+	Does nothing but refine if world.reuseRestingContacts is off
+*/
+template<typename Refine>
+static void refineColissionsCached(WorldPrototype& world, std::vector<Colission>& colissions, const Refine& refine) {
+	if(!world.reuseRestingContacts) {
+		refine(colissions);
+		return;
+	}
 
-				statsMutex.lock();
-				intersectionStatistics.addToTally(IntersectionResult::GJK_REJECT, 1);
-				statsMutex.unlock();
+	std::vector<Colission> reused;
+	world.contactCache.takeReusableColissions(colissions, reused, world.contactReuseTolerance, world.age);
+	intersectionStatistics.addToTally(IntersectionResult::CACHED_CONTACT, reused.size());
 
+	refine(colissions);
+	world.contactCache.storeColissions(colissions, world.age);
 
-			}
-		}
-	});
-	colissions.swap(wantedColission);
+	colissions.insert(colissions.end(), reused.begin(), reused.end());
 }
 
 void findColissions(WorldPrototype& world, ColissionBuffer& curColissions) {
@@ -357,8 +572,16 @@ void findColissions(WorldPrototype& world, ColissionBuffer& curColissions) {
 		getColissionsBetween(world.layers[collidingLayers.first], world.layers[collidingLayers.second], curColissions);
 	}
 
-	refineColissions(curColissions.freePartColissions);
-	refineColissions(curColissions.freeTerrainColissions);
+	filterColissionsMidphase(curColissions.freePartColissions);
+	filterColissionsMidphase(curColissions.freeTerrainColissions);
+
+	refineColissionsCached(world, curColissions.freePartColissions, [](std::vector<Colission>& colissions) {
+		refineColissions(colissions);
+	});
+	refineColissionsCached(world, curColissions.freeTerrainColissions, [](std::vector<Colission>& colissions) {
+		refineColissions(colissions);
+	});
+	world.contactCache.removeStaleEntries(world.age);
 }
 
 void findColissionsParallel(WorldPrototype& world, ColissionBuffer& curColissions, ThreadPool& threadPool) {
@@ -374,8 +597,16 @@ void findColissionsParallel(WorldPrototype& world, ColissionBuffer& curColission
 		getColissionsBetween(world.layers[collidingLayers.first], world.layers[collidingLayers.second], curColissions);
 	}
 
-	parallelRefineColissions(threadPool, curColissions.freePartColissions);
-	parallelRefineColissions(threadPool, curColissions.freeTerrainColissions);
+	filterColissionsMidphase(curColissions.freePartColissions);
+	filterColissionsMidphase(curColissions.freeTerrainColissions);
+
+	refineColissionsCached(world, curColissions.freePartColissions, [&threadPool](std::vector<Colission>& colissions) {
+		parallelRefineColissions(threadPool, colissions);
+	});
+	refineColissionsCached(world, curColissions.freeTerrainColissions, [&threadPool](std::vector<Colission>& colissions) {
+		parallelRefineColissions(threadPool, colissions);
+	});
+	world.contactCache.removeStaleEntries(world.age);
 }
 
 void handleColissions(ColissionBuffer& curColissions) {
@@ -387,19 +618,172 @@ void handleColissions(ColissionBuffer& curColissions) {
 	}
 }
 
+static void handleColouredColission(const ColouredColission& c) {
+	const Colission& col = *c.colission;
+	if(c.isTerrain) {
+		handleTerrainCollision(*col.p1, *col.p2, col.intersection, col.exitVector);
+	} else {
+		handleCollision(*col.p1, *col.p2, col.intersection, col.exitVector);
+	}
+}
+
+/*
+	Colours the contact graph, every MotorizedPhysical is a node, terrain parts do not constrain the colouring
+	A colission gets the colour one higher than the last colour assigned to either of its physicals,
+	so every physical receives its colissions in exactly the same order as handleColissions would apply them.
+	This keeps the result identical to the sequential version, regardless of the number of threads
+*/
+void colourColissions(ColissionBuffer& curColissions) {
+	std::vector<ColouredColission>& result = curColissions.colouredColissions;
+	std::vector<std::size_t>& batchStarts = curColissions.colourBatchStarts;
+
+	std::size_t colissionCount = curColissions.freePartColissions.size() + curColissions.freeTerrainColissions.size();
+
+	std::vector<std::size_t> colours(colissionCount);
+	std::unordered_map<const MotorizedPhysical*, std::size_t> nextFreeColour;
+	nextFreeColour.reserve(colissionCount);
+	std::size_t colourCount = 0;
+
+	std::size_t curIndex = 0;
+	for(const Colission& c : curColissions.freePartColissions) {
+		std::size_t& next1 = nextFreeColour[c.p1->getMainPhysical()];
+		std::size_t& next2 = nextFreeColour[c.p2->getMainPhysical()];
+		std::size_t colour = std::max(next1, next2);
+		next1 = colour + 1;
+		next2 = colour + 1;
+		colours[curIndex++] = colour;
+		colourCount = std::max(colourCount, colour + 1);
+	}
+	for(const Colission& c : curColissions.freeTerrainColissions) {
+		std::size_t& next = nextFreeColour[c.p1->getMainPhysical()];
+		std::size_t colour = next;
+		next = colour + 1;
+		colours[curIndex++] = colour;
+		colourCount = std::max(colourCount, colour + 1);
+	}
+
+	// counting sort the colissions by colour, stable so that each batch keeps the original order
+	batchStarts.assign(colourCount + 1, 0);
+	for(std::size_t colour : colours) {
+		batchStarts[colour + 1]++;
+	}
+	for(std::size_t i = 1; i <= colourCount; i++) {
+		batchStarts[i] += batchStarts[i - 1];
+	}
+
+	result.resize(colissionCount);
+	std::vector<std::size_t> insertionPoints(batchStarts.begin(), batchStarts.end() - 1);
+	curIndex = 0;
+	for(const Colission& c : curColissions.freePartColissions) {
+		result[insertionPoints[colours[curIndex++]]++] = ColouredColission{&c, false};
+	}
+	for(const Colission& c : curColissions.freeTerrainColissions) {
+		result[insertionPoints[colours[curIndex++]]++] = ColouredColission{&c, true};
+	}
+}
+
+/*
+	Handles the colissions batch by batch, colissions within a batch touch disjoint physicals and are spread over the threadPool without locks
+	Note: Debug log actions may be called from multiple threads at once in this mode
+*/
+void handleColissionsParallel(ColissionBuffer& curColissions, ThreadPool& threadPool) {
+	colourColissions(curColissions);
+
+	const std::vector<ColouredColission>& coloured = curColissions.colouredColissions;
+	std::size_t batchCount = curColissions.getColourBatchCount();
+	for(std::size_t batch = 0; batch < batchCount; batch++) {
+		std::size_t batchStart = curColissions.colourBatchStarts[batch];
+		std::size_t batchEnd = curColissions.colourBatchStarts[batch + 1];
+
+		if(batchEnd - batchStart < MIN_PARALLEL_COLISSION_BATCH_SIZE) {
+			for(std::size_t i = batchStart; i < batchEnd; i++) {
+				handleColouredColission(coloured[i]);
+			}
+		} else {
+			std::atomic<std::size_t> currIndex = batchStart;
+			threadPool.doInParallel([&] {
+				TraceScope trace("handleColissionBatch");
+				long long handledCount = 0;
+				while(true) {
+					std::size_t claimedWork = currIndex.fetch_add(1, std::memory_order_relaxed);
+					if(claimedWork >= batchEnd) {
+						break;
+					}
+					handleColouredColission(coloured[claimedWork]);
+					handledCount++;
+				}
+				trace.setCount(handledCount);
+			});
+		}
+	}
+}
+
+static double getTravelPerTick(const Part& part, double deltaT) {
+	Motion motion = part.getMotion();
+	return (length(motion.getVelocity()) + length(motion.getAngularVelocity()) * part.maxRadius) * deltaT;
+}
+
+bool isFastPart(const WorldPrototype& world, const Part& part) {
+	return getTravelPerTick(part, world.deltaT) > world.speculativeTravelFraction * part.maxRadius;
+}
+
+static void addSpeculativeColissions(const std::vector<Colission>& candidates, std::vector<Colission>& speculativeColissions, const WorldPrototype& world, bool isTerrain) {
+	for(const Colission& candidate : candidates) {
+		Part* fastPart = candidate.p1;
+		Part* other = candidate.p2;
+		if(!isTerrain) {
+			if(fastPart->getMainPhysical() == other->getMainPhysical()) continue;
+			// pairs of two fast parts are found from both sides, only keep one of them
+			if(other < fastPart && isFastPart(world, *other)) continue;
+		}
+
+		PartSeparation separation = fastPart->getSeparation(*other);
+		if(!separation.separated) continue; // intersecting parts are handled by the regular colission handling
+
+		Vec3 separationVector = separation.closestOnSecond - separation.closestOnFirst;
+		Position contactPoint = separation.closestOnFirst + separationVector * 0.5;
+		speculativeColissions.push_back(Colission{fastPart, other, contactPoint, separationVector});
+	}
+}
+
+/*
+	Queries the layers with the swept bounds of every fast part, and records the closest points of every non intersecting candidate
+	The regular colission search has no knowledge of these, as the part's own bounds in the trees are not swept
+*/
+void findSpeculativeColissions(WorldPrototype& world, ColissionBuffer& curColissions) {
+	std::vector<Colission> freeCandidates;
+	std::vector<Colission> terrainCandidates;
+	for(MotorizedPhysical* phys : world.physicals) {
+		phys->forEachPart([&](Part& part) {
+			if(part.layer == nullptr || !isFastPart(world, part)) return;
+			getSweptColissionCandidates(&part, part.getSweptBounds(world.deltaT), freeCandidates, terrainCandidates);
+		});
+	}
+
+	addSpeculativeColissions(freeCandidates, curColissions.speculativePartColissions, world, false);
+	addSpeculativeColissions(terrainCandidates, curColissions.speculativeTerrainColissions, world, true);
+}
+
+void handleSpeculativeColissions(ColissionBuffer& curColissions, double deltaT) {
+	for(const Colission& c : curColissions.speculativePartColissions) {
+		handleSpeculativeCollision(*c.p1, *c.p2, c.intersection, c.exitVector, deltaT);
+	}
+	for(const Colission& c : curColissions.speculativeTerrainColissions) {
+		handleSpeculativeTerrainCollision(*c.p1, *c.p2, c.intersection, c.exitVector, deltaT);
+	}
+}
+
 void handleConstraints(WorldPrototype& world) {
 	for(const ConstraintGroup& group : world.constraints) {
 		group.apply();
 	}
 }
-void update(WorldPrototype& world) {
-	for(MotorizedPhysical* physical : world.physicals) {
-		physical->update(world.deltaT);
-	}
-
+static void finishUpdate(WorldPrototype& world) {
+	tickTracer.begin("refreshTrees");
 	for(ColissionLayer& layer : world.layers) {
 		layer.refresh();
 	}
+	tickTracer.end("refreshTrees");
 	world.age++;
 
 	for(SoftLink* springLink : world.softLinks) {
@@ -407,6 +791,134 @@ void update(WorldPrototype& world) {
 	}
 }
 
+void update(WorldPrototype& world) {
+	for(MotorizedPhysical* physical : world.physicals) {
+		physical->update(world.deltaT);
+	}
+
+	finishUpdate(world);
+}
+
+/*
+	===== Adaptive sub-stepping =====
+*/
+
+// the external forces are reapplied for every sub step, colission and constraint forces are recomputed or only applied once
+std::vector<AccumulatedForce> recordExternalForces(const WorldPrototype& world) {
+	std::vector<AccumulatedForce> result;
+	result.reserve(world.physicals.size());
+	for(const MotorizedPhysical* phys : world.physicals) {
+		result.push_back(AccumulatedForce{phys->totalForce, phys->totalMoment});
+	}
+	return result;
+}
+
+static int clampSubSteps(const WorldPrototype& world, double travelRatio) {
+	if(!(travelRatio < world.maxSubSteps)) return world.maxSubSteps; // also catches NaN
+	return std::max(1, static_cast<int>(std::ceil(travelRatio)));
+}
+
+/*
+	The number of steps needed so that no part of phys moves further than subStepTravelFraction of it's maxRadius per step
+*/
+int getRequiredSubSteps(const WorldPrototype& world, const MotorizedPhysical& phys) {
+	double maxTravelRatio = 0.0;
+	phys.forEachPart([&](const Part& part) {
+		maxTravelRatio = std::max(maxTravelRatio, getTravelPerTick(part, world.deltaT) / (world.subStepTravelFraction * part.maxRadius));
+	});
+	return clampSubSteps(world, maxTravelRatio);
+}
+
+/*
+	The number of steps needed to resolve the penetration of a colission in steps no larger than subStepTravelFraction of the smallest part's maxRadius
+*/
+int getRequiredSubSteps(const WorldPrototype& world, const Colission& colission) {
+	double sizeOrder = std::min(colission.p1->maxRadius, colission.p2->maxRadius);
+	return clampSubSteps(world, length(colission.exitVector) / (world.subStepTravelFraction * sizeOrder));
+}
+
+static std::size_t findIsland(std::vector<std::size_t>& islandParents, std::size_t index) {
+	while(islandParents[index] != index) {
+		islandParents[index] = islandParents[islandParents[index]];
+		index = islandParents[index];
+	}
+	return index;
+}
+
+/*
+	Groups the physicals into islands connected by colissions, each island takes as many steps as it's most demanding physical or colission requires.
+	Calm islands are updated once with the full deltaT. For the other islands the first step uses the forces gathered this tick,
+	every following step reapplies the recorded external forces and recomputes the intersections of the island's colission pairs
+*/
+void updateWithSubSteps(WorldPrototype& world, const std::vector<AccumulatedForce>& externalForces) {
+	std::size_t physCount = world.physicals.size();
+	assert(externalForces.size() == physCount);
+
+	std::unordered_map<const MotorizedPhysical*, std::size_t> physIndices;
+	physIndices.reserve(physCount);
+	std::vector<std::size_t> islandParents(physCount);
+	for(std::size_t i = 0; i < physCount; i++) {
+		physIndices.emplace(world.physicals[i], i);
+		islandParents[i] = i;
+	}
+
+	const ColissionBuffer& colissions = world.curColissions;
+	for(const Colission& c : colissions.freePartColissions) {
+		std::size_t island1 = findIsland(islandParents, physIndices[c.p1->getMainPhysical()]);
+		std::size_t island2 = findIsland(islandParents, physIndices[c.p2->getMainPhysical()]);
+		islandParents[island2] = island1;
+	}
+
+	std::vector<int> islandSubSteps(physCount, 1);
+	for(std::size_t i = 0; i < physCount; i++) {
+		int& steps = islandSubSteps[findIsland(islandParents, i)];
+		steps = std::max(steps, getRequiredSubSteps(world, *world.physicals[i]));
+	}
+	for(const Colission& c : colissions.freePartColissions) {
+		int& steps = islandSubSteps[findIsland(islandParents, physIndices[c.p1->getMainPhysical()])];
+		steps = std::max(steps, getRequiredSubSteps(world, c));
+	}
+	for(const Colission& c : colissions.freeTerrainColissions) {
+		int& steps = islandSubSteps[findIsland(islandParents, physIndices[c.p1->getMainPhysical()])];
+		steps = std::max(steps, getRequiredSubSteps(world, c));
+	}
+
+	int maxSteps = 1;
+	for(std::size_t i = 0; i < physCount; i++) {
+		int steps = islandSubSteps[findIsland(islandParents, i)];
+		maxSteps = std::max(maxSteps, steps);
+		world.physicals[i]->update(world.deltaT / steps);
+	}
+
+	// islands share no colissions, so their remaining steps are simply interleaved, going over the colission lists once per step
+	for(int step = 1; step < maxSteps; step++) {
+		for(const Colission& c : colissions.freePartColissions) {
+			if(islandSubSteps[findIsland(islandParents, physIndices[c.p1->getMainPhysical()])] <= step) continue;
+			PartIntersection result = safeIntersects(*c.p1, *c.p2);
+			if(result.intersects) {
+				handleCollision(*c.p1, *c.p2, result.intersection, result.exitVector);
+			}
+		}
+		for(const Colission& c : colissions.freeTerrainColissions) {
+			if(islandSubSteps[findIsland(islandParents, physIndices[c.p1->getMainPhysical()])] <= step) continue;
+			PartIntersection result = safeIntersects(*c.p1, *c.p2);
+			if(result.intersects) {
+				handleTerrainCollision(*c.p1, *c.p2, result.intersection, result.exitVector);
+			}
+		}
+		for(std::size_t i = 0; i < physCount; i++) {
+			int steps = islandSubSteps[findIsland(islandParents, i)];
+			if(steps <= step) continue;
+			MotorizedPhysical* phys = world.physicals[i];
+			phys->totalForce += externalForces[i].force;
+			phys->totalMoment += externalForces[i].moment;
+			phys->update(world.deltaT / steps);
+		}
+	}
+
+	finishUpdate(world);
+}
+
 double WorldPrototype::getTotalKineticEnergy() const {
 	double total = 0.0;
 	for(const MotorizedPhysical* p : this->physicals) {
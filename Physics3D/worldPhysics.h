@@ -9,18 +9,37 @@
 #include "threading/upgradeableMutex.h"
 
 namespace P3D {
+struct AccumulatedForce {
+	Vec3 force;
+	Vec3 moment;
+};
+
 void handleCollision(Part& part1, Part& part2, Position collisionPoint, Vec3 exitVector);
 void handleTerrainCollision(Part& part1, Part& part2, Position collisionPoint, Vec3 exitVector);
 PartIntersection safeIntersects(const Part& p1, const Part& p2);
+// only runs EPA, on the result of a GJK run that found p1 and p2 to collide
+PartIntersection safeIntersects(const Part& p1, const Part& p2, const Tetrahedron& gjkResult);
 void refineColissions(std::vector<Colission>& colissions);
 void parallelRefineColissions(ThreadPool& threadPool, std::vector<Colission>& colissions);
 void findColissions(WorldPrototype& world, ColissionBuffer& curColissions);
 void findColissionsParallel(WorldPrototype& world, ColissionBuffer& curColissions, ThreadPool& threadPool);
 void applyExternalForces(WorldPrototype& world);
 void handleColissions(ColissionBuffer& curColissions);
+void colourColissions(ColissionBuffer& curColissions);
+void handleColissionsParallel(ColissionBuffer& curColissions, ThreadPool& threadPool);
+void handleSpeculativeCollision(Part& part1, Part& part2, Position contactPoint, Vec3 separation, double deltaT);
+void handleSpeculativeTerrainCollision(Part& part1, Part& part2, Position contactPoint, Vec3 separation, double deltaT);
+bool isFastPart(const WorldPrototype& world, const Part& part);
+void findSpeculativeColissions(WorldPrototype& world, ColissionBuffer& curColissions);
+void handleSpeculativeColissions(ColissionBuffer& curColissions, double deltaT);
 void handleConstraints(WorldPrototype& world);
 void update(WorldPrototype& world);
 
+std::vector<AccumulatedForce> recordExternalForces(const WorldPrototype& world);
+int getRequiredSubSteps(const WorldPrototype& world, const MotorizedPhysical& phys);
+int getRequiredSubSteps(const WorldPrototype& world, const Colission& colission);
+void updateWithSubSteps(WorldPrototype& world, const std::vector<AccumulatedForce>& externalForces);
+
 void tickWorldUnsynchronized(WorldPrototype& world, ThreadPool& threadPool);
 void tickWorldSynchronized(WorldPrototype& world, ThreadPool& threadPool, UpgradeableMutex& worldMutex);
 };
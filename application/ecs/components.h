@@ -485,7 +485,7 @@ namespace P3D::Application {
 			}
 
 			void setAttachment(const CFrame& cframe) {
-				to->getPhysical()->rigidBody.setAttachFor(getChildPart(), cframe);
+				to->getPhysical()->setAttachFor(getChildPart(), cframe);
 			}
 
 			ExtendedPart* getMainPart() {
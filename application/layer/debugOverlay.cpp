@@ -21,6 +21,9 @@
 
 #include "worlds.h"
 
+#include <sstream>
+#include <string>
+
 namespace P3D::Application {
 
 Graphics::BarChartClassInfo iterChartClasses[] {
@@ -32,6 +35,15 @@ Graphics::BarChartClassInfo iterChartClasses[] {
 Graphics::BarChart iterationChart("Iteration Statistics", "", GJKCollidesIterationStatistics.labels, iterChartClasses, Vec2f(-1.0f + 0.1f, -0.3f), Vec2f(0.8f, 0.6f), 3, 17);
 Graphics::SlidingChart fpsSlidingChart("Fps Fps", Vec2f(-0.3f, 0.2f), Vec2f(0.7f, 0.4f));
 
+static std::string formatLatencies(const LatencyHistogram& histogram) {
+	std::stringstream ss;
+	ss.precision(2);
+	ss << std::fixed;
+	ss << histogram.getPercentile(50.0).count() / 1000000.0 << " / " << histogram.getPercentile(99.0).count() / 1000000.0 << " / ";
+	ss << histogram.getPercentile(99.9).count() / 1000000.0 << " / " << histogram.getMax().count() / 1000000.0;
+	return ss.str();
+}
+
 void DebugOverlay::onInit(Engine::Registry64& registry) {
 	using namespace Graphics;
 	fpsSlidingChart.add(SlidingChartDataSetInfo("Fps 1", 100, Colors::ORANGE, 2.0));
@@ -77,6 +89,7 @@ void DebugOverlay::onRender(Engine::Registry64& registry) {
 	addDebugField(screen->dimension, GUI::font, "AVG Collide GJK Iterations", gjkCollideIterStats.avg(), "");
 	addDebugField(screen->dimension, GUI::font, "AVG No Collide GJK Iterations", gjkNoCollideIterStats.avg(), "");
 	addDebugField(screen->dimension, GUI::font, "TPS", physicsMeasure.getAvgTPS(), "");
+	addDebugField(screen->dimension, GUI::font, "Tick p50/p99/p99.9/max", formatLatencies(physicsMeasure.tickLatency), " ms");
 	addDebugField(screen->dimension, GUI::font, "FPS", Graphics::graphicsMeasure.getAvgTPS(), "");
 	/*addDebugField(screen->dimension, GUI::font, "World Kinetic Energy", screen->world->getTotalKineticEnergy(), "");
 	addDebugField(screen->dimension, GUI::font, "World Potential Energy", screen->world->getTotalPotentialEnergy(), "");
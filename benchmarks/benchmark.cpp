@@ -5,7 +5,11 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <fstream>
+#include <algorithm>
 
+#include "benchmarkResults.h"
+#include <Physics3D/misc/tickTracer.h>
 #include "../util/terminalColor.h"
 #include "../util/parseCPUIDArgs.h"
 
@@ -46,28 +50,60 @@ std::vector<std::string> split(std::string str, char splitChar) {
 	return substrings;
 }
 
-static void runBenchmark(Benchmark* bench) {
-	setColor(TerminalColor::CYAN);
+static double millisSince(std::chrono::high_resolution_clock::time_point start) {
+	return (std::chrono::high_resolution_clock::now() - start).count() / 1000000.0;
+}
 
-	auto createStart = std::chrono::high_resolution_clock::now();
-	bench->init();
-	auto createFinish = std::chrono::high_resolution_clock::now();
+/*
+	Runs init, run and cleanup warmupCount times without measuring, then repetitionCount times measuring run
+	printResults is called once, with the median run time
+*/
+static BenchmarkResult runBenchmark(Benchmark* bench, int warmupCount, int repetitionCount) {
+	setColor(TerminalColor::CYAN);
 	std::cout << bench->name << ": ";
 	std::cout.flush();
+
+	for(int i = 0; i < warmupCount; i++) {
+		bench->init();
+		bench->run();
+		bench->cleanup();
+	}
+
+	double initMillis = 0.0;
+	std::vector<double> runMillis;
+	for(int i = 0; i < repetitionCount; i++) {
+		auto createStart = std::chrono::high_resolution_clock::now();
+		bench->init();
+		initMillis += millisSince(createStart);
+
+		auto runStart = std::chrono::high_resolution_clock::now();
+		bench->run();
+		runMillis.push_back(millisSince(runStart));
+
+		// the last repetition is kept around for printResults
+		if(i + 1 < repetitionCount) bench->cleanup();
+	}
+
+	BenchmarkResult result(bench->name, initMillis / repetitionCount, std::move(runMillis));
+
 	setColor(TerminalColor::YELLOW);
-	std::cout << '(' << (createFinish - createStart).count() / 1000000.0 << "ms)";
-	std::cout.flush();
-	auto runStart = std::chrono::high_resolution_clock::now();
-	bench->run();
-	auto runFinish = std::chrono::high_resolution_clock::now();
-	double deltaTimeMS = (runFinish - runStart).count() / 1000000.0;
+	std::cout << '(' << result.initMillis << "ms)";
 	setColor(TerminalColor::GREEN);
-	std::cout << "  (" << deltaTimeMS << "ms)\n";
+	std::cout << "  (" << result.median << "ms)";
+	if(repetitionCount > 1) {
+		setColor(TerminalColor::WHITE);
+		std::cout << "  p5 " << result.p5 << "ms  p95 " << result.p95 << "ms  stddev " << result.stddev << "ms";
+	}
+	std::cout << "\n";
 	std::cout.flush();
-	bench->printResults(deltaTimeMS);
+	bench->printResults(result.median);
+	bench->reportMetrics(result.metrics);
+	bench->cleanup();
+
+	return result;
 }
 
-static void runBenchmarks(const std::vector<std::string>& benchmarks) {
+static std::vector<BenchmarkResult> runBenchmarks(const std::vector<std::string>& benchmarks, int warmupCount, int repetitionCount) {
 	setColor(TerminalColor::CYAN);
 	std::cout << "[NAME]";
 	setColor(TerminalColor::YELLOW);
@@ -76,20 +112,45 @@ static void runBenchmarks(const std::vector<std::string>& benchmarks) {
 	std::cout << " [RUNTIME]\n";
 	setColor(TerminalColor::WHITE);
 
+	std::vector<BenchmarkResult> results;
 	for(const std::string& c : benchmarks) {
 		Benchmark* b = getBenchFor(c);
 		if(b != nullptr) {
-			runBenchmark(b);
+			results.push_back(runBenchmark(b, warmupCount, repetitionCount));
 		}
 	}
+	return results;
+}
+
+static int parseIntOption(const Util::ParsedArgs& pa, const char* key, int defaultValue) {
+	std::string value = pa.getOptional(key);
+	return value.empty() ? defaultValue : std::max(0, std::stoi(value));
 }
 
+/*
+	Usage: benchmarks [names or indices] [--warmup N] [--reps N] [--json file] [--csv file] [--compare baseline.json] [--threshold percent] [--trace file] [--traceBudget us] [-counters] [-allocations] [--record file] [--replay file] [-AVX ...]
+	With --compare the exit code is 1 if any benchmark regressed beyond the threshold, 5% by default
+	With --trace the ticks are traced and written to the file as Chrome Trace Event JSON at the end
+	--traceBudget additionally writes the trace of every tick slower than that many microseconds next to it, up to 10 of them
+	-counters samples CPU hardware counters per physics phase in the world benchmarks, through perf_event_open on Linux
+	-allocations counts the heap allocations of every tick per physics phase in the world benchmarks
+	--record writes the first run of every world benchmark as a recording with checksums, to the file with the name of the benchmark added, rec.bin becomes rec_basicWorld.bin
+	The replay benchmark replays the file given with --replay and checks it
+	Benchmarks may read further options through parseArgs, such as --threads for the thread scaling benchmarks
+*/
 int main(int argc, const char** args) {
 	Util::ParsedArgs pa(argc, args);
 	std::cout << Util::printAndParseCPUIDArgs(pa).c_str() << "\n";
 
+	int warmupCount = parseIntOption(pa, "warmup", 0);
+	int repetitionCount = std::max(1, parseIntOption(pa, "reps", 1));
+	for(Benchmark* b : *knownBenchmarks) {
+		b->parseArgs(pa);
+	}
+
+	std::vector<std::string> commands;
 	if(pa.argCount() >= 1) {
-		runBenchmarks(pa.args());
+		commands = pa.args();
 	} else {
 		setColor(TerminalColor::WHITE);
 		std::cout << "The following benchmarks are available:\n";
@@ -110,9 +171,51 @@ int main(int argc, const char** args) {
 		}
 		cmd.append(";");
 
-		std::vector<std::string> commands = split(cmd, ';');
+		commands = split(cmd, ';');
+	}
+
+	std::string traceFile = pa.getOptional("trace");
+	if(!traceFile.empty()) {
+		P3D::tickTracer.enable();
+		std::string budget = pa.getOptional("traceBudget");
+		if(!budget.empty()) {
+			std::string prefix = traceFile.size() > 5 && traceFile.compare(traceFile.size() - 5, 5, ".json") == 0 ? traceFile.substr(0, traceFile.size() - 5) : traceFile;
+			P3D::tickTracer.setLatencyBudget(std::chrono::microseconds(std::stoll(budget)), prefix + "_tick");
+		}
+	}
+
+	std::vector<BenchmarkResult> results = runBenchmarks(commands, warmupCount, repetitionCount);
+	setColor(TerminalColor::WHITE);
+
+	if(!traceFile.empty()) {
+		P3D::tickTracer.writeChromeTrace(traceFile);
+	}
+
+	BenchmarkEnvironment environment(warmupCount, repetitionCount);
+	std::string jsonFile = pa.getOptional("json");
+	if(!jsonFile.empty()) {
+		std::ofstream out(jsonFile);
+		writeResultsJSON(out, environment, results);
+	}
+	std::string csvFile = pa.getOptional("csv");
+	if(!csvFile.empty()) {
+		std::ofstream out(csvFile);
+		writeResultsCSV(out, environment, results);
+	}
 
-		runBenchmarks(commands);
+	std::string baselineFile = pa.getOptional("compare");
+	if(!baselineFile.empty()) {
+		std::ifstream in(baselineFile);
+		if(!in) {
+			std::cout << "Could not open baseline " << baselineFile << "\n";
+			return 2;
+		}
+		std::string threshold = pa.getOptional("threshold");
+		int regressionCount = compareToBaseline(results, readBaselineJSON(in), threshold.empty() ? 5.0 : std::stod(threshold));
+		if(regressionCount != 0) {
+			std::cout << regressionCount << " benchmark(s) regressed\n";
+			return 1;
+		}
 	}
 
 	return 0;
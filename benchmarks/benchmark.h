@@ -1,11 +1,33 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
+namespace Util {
+class ParsedArgs;
+};
+
+// a named number a benchmark measured besides its run time, written to the --json output
+struct BenchmarkMetric {
+	std::string name;
+	double value;
+};
+
 class Benchmark {
 public:
 	const char* name;
 	Benchmark(const char* name);
 	virtual ~Benchmark() {}
+	// lets a benchmark read its own options, called for every benchmark before any of them runs
+	virtual void parseArgs(const Util::ParsedArgs&) {}
 	virtual void init() {}
 	virtual void run() = 0;
+	// called after every repetition, so the next init starts from the same state as the first
+	virtual void cleanup() {}
 	virtual void printResults(double timeTaken) {}
+	// called after printResults
+	virtual void reportMetrics(std::vector<BenchmarkMetric>&) const {}
 };
+
+// finds a benchmark by name or by its index in the list, nullptr if there is none
+Benchmark* getBenchFor(std::string id);
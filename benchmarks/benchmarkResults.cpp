@@ -0,0 +1,227 @@
+#include "benchmarkResults.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <utility>
+
+#include <Physics3D/misc/cpuid.h>
+
+#include "../util/terminalColor.h"
+
+static double percentile(const std::vector<double>& sorted, double fraction) {
+	if(sorted.empty()) return 0.0;
+	double position = fraction * (sorted.size() - 1);
+	std::size_t below = static_cast<std::size_t>(position);
+	if(below + 1 >= sorted.size()) return sorted.back();
+	double weight = position - below;
+	return sorted[below] * (1.0 - weight) + sorted[below + 1] * weight;
+}
+
+BenchmarkResult::BenchmarkResult(std::string name, double initMillis, std::vector<double> runMillis) : name(std::move(name)), initMillis(initMillis), runMillis(std::move(runMillis)) {
+	if(this->runMillis.empty()) return;
+
+	std::vector<double> sorted = this->runMillis;
+	std::sort(sorted.begin(), sorted.end());
+	median = percentile(sorted, 0.5);
+	p5 = percentile(sorted, 0.05);
+	p95 = percentile(sorted, 0.95);
+	min = sorted.front();
+	max = sorted.back();
+
+	double total = 0.0;
+	for(double t : sorted) total += t;
+	mean = total / sorted.size();
+
+	// sample standard deviation, 0 for a single sample
+	if(sorted.size() > 1) {
+		double squares = 0.0;
+		for(double t : sorted) squares += (t - mean) * (t - mean);
+		stddev = std::sqrt(squares / (sorted.size() - 1));
+	}
+}
+
+BenchmarkEnvironment::BenchmarkEnvironment(int warmupCount, int repetitionCount) :
+	cpuModel(P3D::CPUIDCheck::getBrandString()),
+	warmupCount(warmupCount),
+	repetitionCount(repetitionCount) {
+
+	for(int i = 0; i < P3D::CPUIDCheck::TECHNOLOGY_COUNT; i++) {
+		if(P3D::CPUIDCheck::hasTechnology(1U << i)) technologies.push_back(P3D::CPUIDCheck::NAMES[i]);
+	}
+}
+
+static std::string escapeJSON(const std::string& str) {
+	std::string result;
+	for(char c : str) {
+		if(c == '"' || c == '\\') result.push_back('\\');
+		result.push_back(c);
+	}
+	return result;
+}
+
+void writeResultsJSON(std::ostream& out, const BenchmarkEnvironment& environment, const std::vector<BenchmarkResult>& results) {
+	std::stringstream ss;
+	ss.precision(6);
+	ss << std::fixed;
+
+	ss << "{\n";
+	ss << "\t\"cpu\": \"" << escapeJSON(environment.cpuModel) << "\",\n";
+	ss << "\t\"technologies\": [";
+	for(std::size_t i = 0; i < environment.technologies.size(); i++) {
+		ss << (i == 0 ? "" : ", ") << '"' << environment.technologies[i] << '"';
+	}
+	ss << "],\n";
+	ss << "\t\"warmup\": " << environment.warmupCount << ",\n";
+	ss << "\t\"repetitions\": " << environment.repetitionCount << ",\n";
+	ss << "\t\"benchmarks\": [\n";
+	for(std::size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& r = results[i];
+		ss << "\t\t{\n";
+		ss << "\t\t\t\"name\": \"" << escapeJSON(r.name) << "\",\n";
+		ss << "\t\t\t\"init\": " << r.initMillis << ",\n";
+		ss << "\t\t\t\"median\": " << r.median << ",\n";
+		ss << "\t\t\t\"p5\": " << r.p5 << ",\n";
+		ss << "\t\t\t\"p95\": " << r.p95 << ",\n";
+		ss << "\t\t\t\"mean\": " << r.mean << ",\n";
+		ss << "\t\t\t\"stddev\": " << r.stddev << ",\n";
+		ss << "\t\t\t\"min\": " << r.min << ",\n";
+		ss << "\t\t\t\"max\": " << r.max << ",\n";
+		ss << "\t\t\t\"samples\": [";
+		for(std::size_t j = 0; j < r.runMillis.size(); j++) {
+			ss << (j == 0 ? "" : ", ") << r.runMillis[j];
+		}
+		ss << "]";
+		if(!r.metrics.empty()) {
+			// pairs instead of an object, so benchmark objects stay free of nested objects
+			ss << ",\n\t\t\t\"metrics\": [";
+			for(std::size_t j = 0; j < r.metrics.size(); j++) {
+				ss << (j == 0 ? "\n" : ",\n") << "\t\t\t\t[\"" << escapeJSON(r.metrics[j].name) << "\", " << r.metrics[j].value << "]";
+			}
+			ss << "\n\t\t\t]";
+		}
+		ss << "\n";
+		ss << "\t\t}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	ss << "\t]\n";
+	ss << "}\n";
+
+	out << ss.str();
+}
+
+void writeResultsCSV(std::ostream& out, const BenchmarkEnvironment& environment, const std::vector<BenchmarkResult>& results) {
+	std::string technologies;
+	for(const std::string& t : environment.technologies) {
+		technologies.append(technologies.empty() ? "" : " ").append(t);
+	}
+
+	std::stringstream ss;
+	ss.precision(6);
+	ss << std::fixed;
+	ss << "name,repetitions,init_ms,median_ms,p5_ms,p95_ms,mean_ms,stddev_ms,min_ms,max_ms,cpu,technologies\n";
+	for(const BenchmarkResult& r : results) {
+		ss << r.name << ',' << r.runMillis.size() << ',' << r.initMillis << ',' << r.median << ',' << r.p5 << ',' << r.p95 << ',' << r.mean << ',' << r.stddev << ',' << r.min << ',' << r.max;
+		ss << ",\"" << environment.cpuModel << "\"," << technologies << '\n';
+	}
+
+	out << ss.str();
+}
+
+// finds the number after "key": within [start, end), returns false if the key isn't there
+static bool findNumber(const std::string& text, std::size_t start, std::size_t end, const char* key, double& value) {
+	std::string quotedKey = std::string("\"") + key + "\"";
+	std::size_t keyPos = text.find(quotedKey, start);
+	if(keyPos == std::string::npos || keyPos >= end) return false;
+	std::size_t colon = text.find(':', keyPos + quotedKey.size());
+	if(colon == std::string::npos || colon >= end) return false;
+	const char* numberStart = text.c_str() + colon + 1;
+	char* numberEnd;
+	value = std::strtod(numberStart, &numberEnd);
+	return numberEnd != numberStart;
+}
+
+static bool findString(const std::string& text, std::size_t start, std::size_t end, const char* key, std::string& value) {
+	std::string quotedKey = std::string("\"") + key + "\"";
+	std::size_t keyPos = text.find(quotedKey, start);
+	if(keyPos == std::string::npos || keyPos >= end) return false;
+	std::size_t open = text.find('"', text.find(':', keyPos + quotedKey.size()));
+	if(open == std::string::npos || open >= end) return false;
+
+	value.clear();
+	for(std::size_t i = open + 1; i < end; i++) {
+		if(text[i] == '\\' && i + 1 < end) {
+			value.push_back(text[++i]);
+		} else if(text[i] == '"') {
+			return true;
+		} else {
+			value.push_back(text[i]);
+		}
+	}
+	return false;
+}
+
+std::vector<BaselineEntry> readBaselineJSON(std::istream& in) {
+	std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	std::vector<BaselineEntry> result;
+
+	std::size_t list = text.find("\"benchmarks\"");
+	if(list == std::string::npos) return result;
+
+	// benchmark objects contain no nested objects, so every one of them ends at the first closing brace
+	std::size_t pos = list;
+	while((pos = text.find('{', pos)) != std::string::npos) {
+		std::size_t end = text.find('}', pos);
+		if(end == std::string::npos) break;
+
+		BaselineEntry entry;
+		if(findString(text, pos, end, "name", entry.name) && findNumber(text, pos, end, "median", entry.median)) {
+			if(!findNumber(text, pos, end, "p5", entry.p5)) entry.p5 = entry.median;
+			if(!findNumber(text, pos, end, "p95", entry.p95)) entry.p95 = entry.median;
+			result.push_back(entry);
+		}
+		pos = end;
+	}
+	return result;
+}
+
+int compareToBaseline(const std::vector<BenchmarkResult>& results, const std::vector<BaselineEntry>& baseline, double thresholdPercent) {
+	int regressionCount = 0;
+
+	setColor(TerminalColor::MAGENTA);
+	std::cout << "\n[Comparison to baseline, threshold " << thresholdPercent << "%]\n";
+	for(const BenchmarkResult& r : results) {
+		auto found = std::find_if(baseline.begin(), baseline.end(), [&r](const BaselineEntry& e) { return e.name == r.name; });
+		if(found == baseline.end()) {
+			setColor(TerminalColor::WHITE);
+			std::cout << r.name << ": not in baseline\n";
+			continue;
+		}
+
+		double change = found->median != 0.0 ? (r.median - found->median) / found->median * 100.0 : 0.0;
+		bool slower = change > thresholdPercent && r.p5 > found->p95;
+		bool faster = change < -thresholdPercent && r.p95 < found->p5;
+
+		std::stringstream ss;
+		ss.precision(3);
+		ss << std::fixed;
+		ss << r.name << ": " << found->median << "ms -> " << r.median << "ms (" << (change >= 0.0 ? "+" : "") << change << "%)";
+
+		if(slower) {
+			setColor(TerminalColor::RED);
+			std::cout << ss.str() << " REGRESSION\n";
+			regressionCount++;
+		} else if(faster) {
+			setColor(TerminalColor::GREEN);
+			std::cout << ss.str() << " improvement\n";
+		} else {
+			setColor(TerminalColor::WHITE);
+			std::cout << ss.str() << " within noise\n";
+		}
+	}
+	setColor(TerminalColor::WHITE);
+
+	return regressionCount;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+#include "benchmark.h"
+
+/*
+	Timings of all repetitions of one benchmark, in milliseconds
+	Percentiles interpolate linearly between the sorted samples
+*/
+struct BenchmarkResult {
+	std::string name;
+	double initMillis = 0.0;
+	std::vector<double> runMillis;
+	std::vector<BenchmarkMetric> metrics;
+
+	double median = 0.0;
+	double p5 = 0.0;
+	double p95 = 0.0;
+	double mean = 0.0;
+	double stddev = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+
+	BenchmarkResult() = default;
+	BenchmarkResult(std::string name, double initMillis, std::vector<double> runMillis);
+};
+
+// the machine and settings a set of results was measured with, written along with them so baselines can be checked for comparability
+struct BenchmarkEnvironment {
+	std::string cpuModel;
+	std::vector<std::string> technologies;
+	int warmupCount;
+	int repetitionCount;
+
+	BenchmarkEnvironment(int warmupCount, int repetitionCount);
+};
+
+void writeResultsJSON(std::ostream& out, const BenchmarkEnvironment& environment, const std::vector<BenchmarkResult>& results);
+void writeResultsCSV(std::ostream& out, const BenchmarkEnvironment& environment, const std::vector<BenchmarkResult>& results);
+
+struct BaselineEntry {
+	std::string name;
+	double median;
+	double p5;
+	double p95;
+};
+
+// reads the benchmarks of a file written by writeResultsJSON, entries without a median are skipped
+std::vector<BaselineEntry> readBaselineJSON(std::istream& in);
+
+/*
+	Prints every result next to its baseline, and returns the number of regressions
+	A benchmark regressed if its median is more than thresholdPercent slower than the baseline median
+	and its p5 is slower than the baseline p95, so differences within the noise of either run don't count
+*/
+int compareToBaseline(const std::vector<BenchmarkResult>& results, const std::vector<BaselineEntry>& baseline, double thresholdPercent);
@@ -0,0 +1,358 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Physics3D/boundstree/boundsTree.h>
+
+#include "../util/cmdParser.h"
+#include "../util/terminalColor.h"
+
+// size of the second tree forEachColissionWith(tree) is measured against, as a fraction of the main tree
+#define OTHER_TREE_FRACTION 4
+#define QUERY_COUNT 1000
+// region queries of the filtered iteration cover this fraction of the side of the scene
+#define REGION_QUERY_FRACTION 0.1f
+#define CLUSTER_COUNT 20
+
+namespace P3D {
+enum class BoundsDistribution {
+	// similar boxes spread evenly over the scene
+	UNIFORM,
+	// similar boxes packed around a few centers
+	CLUSTERED,
+	// rods along a random axis up to a quarter of the scene long
+	LONG_THIN,
+	// boxes with sizes spread over several orders of magnitude
+	SIZE_VARIATION
+};
+
+static const char* distributionNames[]{"uniform", "clustered", "thin", "varied"};
+
+// side of the cube the objects are spread over, grows with the object count so the density is the same for all sizes
+static float getSceneSide(int objectCount) {
+	return 4.0f * std::cbrt(static_cast<float>(objectCount));
+}
+
+static std::vector<BasicBounded> generateBounds(BoundsDistribution distribution, int objectCount, std::mt19937& random) {
+	float side = getSceneSide(objectCount);
+	std::uniform_real_distribution<float> inScene(-side / 2, side / 2);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<PositionTemplate<float>> clusterCenters;
+	for(int i = 0; i < CLUSTER_COUNT; i++) {
+		clusterCenters.push_back(PositionTemplate<float>(inScene(random), inScene(random), inScene(random)));
+	}
+
+	std::vector<BasicBounded> result;
+	result.reserve(objectCount);
+	for(int i = 0; i < objectCount; i++) {
+		PositionTemplate<float> center(inScene(random), inScene(random), inScene(random));
+		Vec3f halfSize(0.25f + 0.75f * unit(random), 0.25f + 0.75f * unit(random), 0.25f + 0.75f * unit(random));
+
+		switch(distribution) {
+		case BoundsDistribution::UNIFORM:
+			break;
+		case BoundsDistribution::CLUSTERED: {
+			// sum of uniforms, so the clusters are dense in the middle and thin out
+			float clusterRadius = side / CLUSTER_COUNT;
+			Vec3f offset((unit(random) + unit(random) + unit(random) - 1.5f) * clusterRadius, (unit(random) + unit(random) + unit(random) - 1.5f) * clusterRadius, (unit(random) + unit(random) + unit(random) - 1.5f) * clusterRadius);
+			center = clusterCenters[i % CLUSTER_COUNT] + offset;
+			break;
+		}
+		case BoundsDistribution::LONG_THIN: {
+			float length = side / 8 * unit(random);
+			halfSize = Vec3f(0.1f, 0.1f, 0.1f);
+			halfSize[i % 3] = std::max(0.1f, length);
+			break;
+		}
+		case BoundsDistribution::SIZE_VARIATION: {
+			// log uniform between 0.05 and side / 20
+			float size = 0.05f * std::pow(side / 20 / 0.05f, unit(random));
+			halfSize = Vec3f(size, size, size);
+			break;
+		}
+		}
+		result.push_back(BasicBounded{BoundsTemplate<float>(center - halfSize, center + halfSize)});
+	}
+	return result;
+}
+
+// passes the subnodes overlapping region, and counts the trunks it was asked about
+struct RegionFilter {
+	BoundsTemplate<float> region;
+	long long* trunkVisits;
+
+	std::array<bool, BRANCH_FACTOR> operator()(const TreeTrunk& trunk, int trunkSize) const {
+		(*trunkVisits)++;
+		std::array<bool, BRANCH_FACTOR> results;
+		for(int i = 0; i < trunkSize; i++) {
+			results[i] = intersects(region, trunk.getBoundsOfSubNode(i));
+		}
+		return results;
+	}
+};
+
+/*
+	Shape of a tree, to compare tuning of BRANCH_FACTOR and computeCost
+	cost is the sum of computeCost over the bounds of all nodes below the base trunk, lower is better for queries
+	fill is the average number of subnodes per trunk over BRANCH_FACTOR
+*/
+struct TreeQuality {
+	double averageDepth = 0.0;
+	int maxDepth = 0;
+	double cost = 0.0;
+	double fill = 0.0;
+};
+
+static void computeQualityRecursive(const TreeTrunk& trunk, int trunkSize, int depth, TreeQuality& quality, long long& objectCount, long long& trunkCount, long long& subNodeCount) {
+	trunkCount++;
+	subNodeCount += trunkSize;
+	for(int i = 0; i < trunkSize; i++) {
+		quality.cost += computeCost(trunk.getBoundsOfSubNode(i));
+		const TreeNodeRef& subNode = trunk.subNodes[i];
+		if(subNode.isTrunkNode()) {
+			computeQualityRecursive(subNode.asTrunk(), subNode.getTrunkSize(), depth + 1, quality, objectCount, trunkCount, subNodeCount);
+		} else {
+			objectCount++;
+			quality.averageDepth += depth;
+			quality.maxDepth = std::max(quality.maxDepth, depth);
+		}
+	}
+}
+
+static TreeQuality computeQuality(const BoundsTreePrototype& tree) {
+	TreeQuality quality;
+	std::pair<const TreeTrunk&, int> baseTrunk = tree.getBaseTrunk();
+	if(baseTrunk.second == 0) return quality;
+
+	long long objectCount = 0;
+	long long trunkCount = 0;
+	long long subNodeCount = 0;
+	computeQualityRecursive(baseTrunk.first, baseTrunk.second, 1, quality, objectCount, trunkCount, subNodeCount);
+	quality.averageDepth /= objectCount;
+	quality.fill = static_cast<double>(subNodeCount) / (trunkCount * BRANCH_FACTOR);
+	return quality;
+}
+
+template<typename Func>
+static double nanosPerOp(long long opCount, const Func& func) {
+	auto start = std::chrono::high_resolution_clock::now();
+	func();
+	return static_cast<double>((std::chrono::high_resolution_clock::now() - start).count()) / std::max(1LL, opCount);
+}
+
+/*
+	Measures every BoundsTree operation the broadphase uses on generated bounds, for every combination of the options
+	Options: --treeSizes 1000,100000                      object counts, 1000,10000,100000 by default
+	         --distributions uniform,clustered,thin,varied  all of them by default
+	All latencies are in ns, per object for insert, remove and recalculateBounds, per call for the rest
+	Region queries count the trunks the filter visited, the lower that is the better the tree separates space
+*/
+class BoundsTreeBenchmark : public Benchmark {
+	struct TreeRun {
+		BoundsDistribution distribution;
+		int objectCount;
+
+		double insertNanos;
+		double removeNanos;
+		double recalculateNanos;
+		double improveNanos;
+		double colissionNanos;
+		long long colissionCount;
+		double colissionWithTreeNanos;
+		double colissionWithObjectNanos;
+		double filteredNanos;
+		double iterFilteredNanos;
+		double trunkVisitsPerQuery;
+		double trunkVisitsPerQueryImproved;
+
+		TreeQuality built;
+		TreeQuality improved;
+
+		std::string getName() const {
+			return std::to_string(objectCount) + "/" + distributionNames[static_cast<int>(distribution)];
+		}
+	};
+
+	std::vector<int> objectCounts;
+	std::vector<BoundsDistribution> distributions;
+	std::vector<TreeRun> runs;
+	// results are summed in here so the compiler can't drop the loops
+	long long sink = 0;
+
+	double measureRegionQueries(const BoundsTree<BasicBounded>& tree, const std::vector<BoundsTemplate<float>>& regions, long long& trunkVisits) {
+		trunkVisits = 0;
+		return nanosPerOp(regions.size(), [&]() {
+			for(const BoundsTemplate<float>& region : regions) {
+				tree.forEachFiltered(RegionFilter{region, &trunkVisits}, [&](BasicBounded&) { sink++; });
+			}
+		});
+	}
+
+	TreeRun measure(BoundsDistribution distribution, int objectCount) {
+		TreeRun run;
+		run.distribution = distribution;
+		run.objectCount = objectCount;
+
+		std::mt19937 random(1234);
+		std::vector<BasicBounded> objects = generateBounds(distribution, objectCount, random);
+		std::vector<BasicBounded> otherObjects = generateBounds(distribution, std::max(1, objectCount / OTHER_TREE_FRACTION), random);
+		std::vector<BasicBounded> queryObjects = generateBounds(distribution, QUERY_COUNT, random);
+
+		float side = getSceneSide(objectCount);
+		float regionSide = side * REGION_QUERY_FRACTION;
+		std::uniform_real_distribution<float> inScene(-side / 2, side / 2 - regionSide);
+		std::vector<BoundsTemplate<float>> regions;
+		for(int i = 0; i < QUERY_COUNT; i++) {
+			PositionTemplate<float> corner(inScene(random), inScene(random), inScene(random));
+			regions.push_back(BoundsTemplate<float>(corner, corner + Vec3f(regionSide, regionSide, regionSide)));
+		}
+
+		BoundsTree<BasicBounded> tree;
+		run.insertNanos = nanosPerOp(objectCount, [&]() {
+			for(BasicBounded& obj : objects) tree.add(&obj);
+		});
+		run.built = computeQuality(tree.getPrototype());
+
+		BoundsTree<BasicBounded> otherTree;
+		for(BasicBounded& obj : otherObjects) otherTree.add(&obj);
+
+		long long colissionCount = 0;
+		run.colissionNanos = nanosPerOp(1, [&]() {
+			tree.forEachColission([&](BasicBounded*, BasicBounded*) { colissionCount++; });
+		});
+		run.colissionCount = colissionCount;
+
+		run.colissionWithTreeNanos = nanosPerOp(1, [&]() {
+			tree.forEachColissionWith(otherTree, [&](BasicBounded*, BasicBounded*) { sink++; });
+		});
+
+		run.colissionWithObjectNanos = nanosPerOp(QUERY_COUNT, [&]() {
+			for(BasicBounded& query : queryObjects) {
+				tree.forEachColissionWith(&query, query.bounds, [&](BasicBounded*, BasicBounded*) { sink++; });
+			}
+		});
+
+		long long trunkVisits = 0;
+		run.filteredNanos = measureRegionQueries(tree, regions, trunkVisits);
+		run.trunkVisitsPerQuery = static_cast<double>(trunkVisits) / QUERY_COUNT;
+
+		run.iterFilteredNanos = nanosPerOp(QUERY_COUNT, [&]() {
+			for(const BoundsTemplate<float>& region : regions) {
+				for(BasicBounded& obj : tree.iterFiltered(RegionFilter{region, &trunkVisits})) {
+					(void) obj;
+					sink++;
+				}
+			}
+		});
+
+		// every object moves a bit, like parts between two ticks
+		std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+		for(BasicBounded& obj : objects) {
+			Vec3f offset(jitter(random), jitter(random), jitter(random));
+			obj.bounds = BoundsTemplate<float>(obj.bounds.min + offset, obj.bounds.max + offset);
+		}
+		run.recalculateNanos = nanosPerOp(objectCount, [&]() {
+			tree.recalculateBounds();
+		});
+
+		run.improveNanos = nanosPerOp(1, [&]() {
+			tree.improveStructure();
+		});
+		run.improved = computeQuality(tree.getPrototype());
+		measureRegionQueries(tree, regions, trunkVisits);
+		run.trunkVisitsPerQueryImproved = static_cast<double>(trunkVisits) / QUERY_COUNT;
+
+		std::vector<BasicBounded*> removeOrder;
+		for(BasicBounded& obj : objects) removeOrder.push_back(&obj);
+		std::shuffle(removeOrder.begin(), removeOrder.end(), random);
+		run.removeNanos = nanosPerOp(objectCount, [&]() {
+			for(BasicBounded* obj : removeOrder) tree.remove(obj);
+		});
+
+		return run;
+	}
+
+public:
+	BoundsTreeBenchmark() : Benchmark("boundsTree") {}
+
+	void parseArgs(const Util::ParsedArgs& args) override {
+		objectCounts.clear();
+		std::stringstream ss(args.getOptional("treeSizes"));
+		std::string item;
+		while(std::getline(ss, item, ',')) {
+			if(!item.empty()) objectCounts.push_back(std::max(1, std::stoi(item)));
+		}
+		if(objectCounts.empty()) objectCounts = {1000, 10000, 100000};
+
+		distributions.clear();
+		std::stringstream ds(args.getOptional("distributions"));
+		while(std::getline(ds, item, ',')) {
+			for(int i = 0; i < 4; i++) {
+				if(item == distributionNames[i]) distributions.push_back(static_cast<BoundsDistribution>(i));
+			}
+		}
+		if(distributions.empty()) distributions = {BoundsDistribution::UNIFORM, BoundsDistribution::CLUSTERED, BoundsDistribution::LONG_THIN, BoundsDistribution::SIZE_VARIATION};
+	}
+
+	void run() override {
+		runs.clear();
+		for(int objectCount : objectCounts) {
+			for(BoundsDistribution distribution : distributions) {
+				runs.push_back(measure(distribution, objectCount));
+			}
+		}
+	}
+
+	void printResults(double) override {
+		std::stringstream ss;
+		ss.precision(1);
+		ss << std::fixed;
+
+		ss << "tree\tinsert\tremove\trecalc\timprove\tcolission\tpairs\twithTree\twithObj\tfiltered\titerFiltered\n";
+		for(const TreeRun& r : runs) {
+			ss << r.getName() << "\t" << r.insertNanos << "\t" << r.removeNanos << "\t" << r.recalculateNanos << "\t" << r.improveNanos << "\t" << r.colissionNanos << "\t" << r.colissionCount << "\t" << r.colissionWithTreeNanos << "\t" << r.colissionWithObjectNanos << "\t" << r.filteredNanos << "\t" << r.iterFilteredNanos << "\n";
+		}
+
+		ss.precision(3);
+		ss << "\ntree\tdepth avg/max\tcost\tfill\ttrunks/query\timproved: depth avg/max\tcost\tfill\ttrunks/query\n";
+		for(const TreeRun& r : runs) {
+			ss << r.getName() << "\t" << r.built.averageDepth << "/" << r.built.maxDepth << "\t" << r.built.cost << "\t" << r.built.fill << "\t" << r.trunkVisitsPerQuery;
+			ss << "\t" << r.improved.averageDepth << "/" << r.improved.maxDepth << "\t" << r.improved.cost << "\t" << r.improved.fill << "\t" << r.trunkVisitsPerQueryImproved << "\n";
+		}
+
+		setColor(TerminalColor::MAGENTA);
+		std::cout << "\n[BoundsTree, ns per op]\n";
+		setColor(TerminalColor::WHITE);
+		std::cout << ss.str();
+	}
+
+	void reportMetrics(std::vector<BenchmarkMetric>& metrics) const override {
+		for(const TreeRun& r : runs) {
+			std::string prefix = r.getName() + "/";
+			metrics.push_back(BenchmarkMetric{prefix + "insertNanos", r.insertNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "removeNanos", r.removeNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "recalculateBoundsNanos", r.recalculateNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "improveStructureNanos", r.improveNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "forEachColissionNanos", r.colissionNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "forEachColissionWithTreeNanos", r.colissionWithTreeNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "forEachColissionWithObjectNanos", r.colissionWithObjectNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "forEachFilteredNanos", r.filteredNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "iterFilteredNanos", r.iterFilteredNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "averageDepth", r.built.averageDepth});
+			metrics.push_back(BenchmarkMetric{prefix + "cost", r.built.cost});
+			metrics.push_back(BenchmarkMetric{prefix + "fill", r.built.fill});
+			metrics.push_back(BenchmarkMetric{prefix + "trunksPerQuery", r.trunkVisitsPerQuery});
+			metrics.push_back(BenchmarkMetric{prefix + "improvedCost", r.improved.cost});
+			metrics.push_back(BenchmarkMetric{prefix + "improvedTrunksPerQuery", r.trunkVisitsPerQueryImproved});
+		}
+	}
+} boundsTree;
+};
@@ -0,0 +1,264 @@
+#include "benchmark.h"
+
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Physics3D/geometry/shape.h>
+#include <Physics3D/geometry/shapeClass.h>
+#include <Physics3D/geometry/shapeCreation.h>
+#include <Physics3D/geometry/shapeLibrary.h>
+#include <Physics3D/geometry/intersection.h>
+#include <Physics3D/geometry/genericIntersection.h>
+#include <Physics3D/geometry/computationBuffer.h>
+#include <Physics3D/misc/physicsProfiler.h>
+#include <Physics3D/math/rotation.h>
+
+#include "../util/cmdParser.h"
+#include "../util/terminalColor.h"
+
+// relative transforms every shape pair is tested with, every one of them is measured narrowphaseReps times
+#define NARROWPHASE_TRANSFORM_COUNT 64
+// steps of the bisection for the distance at which two shapes touch
+#define TOUCH_SEARCH_STEPS 40
+
+namespace P3D {
+enum class PairConfiguration {
+	// second shape pushed into the first up to 80% of the touching distance
+	OVERLAPPING,
+	// penetrating 0.1% of the touching distance
+	TOUCHING,
+	// 20% further apart than touching
+	SEPARATED,
+	COUNT
+};
+
+static const char* configurationNames[]{"overlapping", "touching", "separated"};
+static const double configurationDistances[]{0.8, 0.999, 1.2};
+
+struct NamedShape {
+	const char* name;
+	Shape shape;
+};
+
+struct PairMeasurement {
+	std::string pair;
+	PairConfiguration configuration;
+	double gjkNanos;
+	// 0 if GJK found no intersection for any transform
+	double epaNanos;
+	double fullNanos;
+	double gjkIterations;
+	double epaIterations;
+};
+
+static bool gjkCollides(const Shape& first, const Shape& second, const CFrame& relativeTransform) {
+	ColissionPair info{*first.baseShape, *second.baseShape, relativeTransform, first.scale, second.scale};
+	return runGJKTransformed(info, -relativeTransform.position).has_value();
+}
+
+// distance along direction at which second, rotated by rotation, just touches first
+static double findTouchingDistance(const Shape& first, const Shape& second, const Rotation& rotation, const Vec3& direction) {
+	double low = 0.0;
+	double high = first.getMaxRadius() + second.getMaxRadius();
+	for(int i = 0; i < TOUCH_SEARCH_STEPS; i++) {
+		double mid = (low + high) / 2;
+		if(gjkCollides(first, second, CFrame(direction * mid, rotation))) {
+			low = mid;
+		} else {
+			high = mid;
+		}
+	}
+	return (low + high) / 2;
+}
+
+// the average of the iteration counts tallied since the last nextTally, counting the 15+ bucket as 15 and the iteration limit as its bucket index
+static double averageIterations(HistoricTally<long long, IterationTime>& tally) {
+	tally.nextTally();
+	const auto& counts = tally.history.front();
+	double total = 0.0;
+	double weighted = 0.0;
+	for(std::size_t i = 0; i < tally.size(); i++) {
+		total += counts.values[i];
+		weighted += counts.values[i] * static_cast<double>(i);
+	}
+	return total != 0.0 ? weighted / total : 0.0;
+}
+
+template<typename Func>
+static double nanosPerCall(int callCount, const Func& func) {
+	auto start = std::chrono::high_resolution_clock::now();
+	func();
+	return static_cast<double>((std::chrono::high_resolution_clock::now() - start).count()) / callCount;
+}
+
+/*
+	Measures GJK, EPA and the full intersectsTransformed call for every pair of builtin shapes and polyhedra of increasing vertex count
+	in overlapping, touching and separated configurations, each over NARROWPHASE_TRANSFORM_COUNT random orientations
+	GJK and EPA are run directly on the shape classes, the full call also includes the collision LOD test and profiler marks
+	Options: --narrowphaseReps N  times every transform is repeated, 50 by default
+*/
+class NarrowphaseBenchmark : public Benchmark {
+	int repetitions = 50;
+	std::vector<NamedShape> shapes;
+	std::vector<PairMeasurement> measurements;
+	ComputationBuffers buffers{1000, 2000};
+	// results are summed in here so the compiler can't drop the calls
+	double sink = 0.0;
+
+	void measurePair(const NamedShape& first, const NamedShape& second) {
+		struct TestCase {
+			CFrame transform;
+			PairConfiguration configuration;
+		};
+
+		// the same pseudo random orientations for every pair, so pairs are comparable
+		std::vector<TestCase> cases;
+		unsigned int seed = 12345;
+		auto nextRandom = [&seed]() {
+			seed = seed * 1103515245 + 12345;
+			return ((seed >> 8) & 0xFFFF) / 65535.0 * 2.0 - 1.0;
+		};
+		for(int i = 0; i < NARROWPHASE_TRANSFORM_COUNT; i++) {
+			Rotation rotation = Rotation::fromEulerAngles(nextRandom() * 3.14, nextRandom() * 3.14, nextRandom() * 3.14);
+			Vec3 direction = normalize(Vec3(nextRandom(), nextRandom(), nextRandom()) + Vec3(0.01, 0.0, 0.0));
+			double touching = findTouchingDistance(first.shape, second.shape, rotation, direction);
+			for(int c = 0; c < static_cast<int>(PairConfiguration::COUNT); c++) {
+				cases.push_back(TestCase{CFrame(direction * (touching * configurationDistances[c]), rotation), static_cast<PairConfiguration>(c)});
+			}
+		}
+
+		for(int c = 0; c < static_cast<int>(PairConfiguration::COUNT); c++) {
+			PairConfiguration configuration = static_cast<PairConfiguration>(c);
+			std::vector<CFrame> transforms;
+			for(const TestCase& t : cases) {
+				if(t.configuration == configuration) transforms.push_back(t.transform);
+			}
+			int callCount = static_cast<int>(transforms.size()) * repetitions;
+
+			GJKCollidesIterationStatistics.clearCurrentTally();
+			GJKNoCollidesIterationStatistics.clearCurrentTally();
+			EPAIterationStatistics.clearCurrentTally();
+
+			std::vector<Tetrahedron> gjkResults;
+			std::vector<CFrame> collidingTransforms;
+			for(const CFrame& transform : transforms) {
+				ColissionPair info{*first.shape.baseShape, *second.shape.baseShape, transform, first.shape.scale, second.shape.scale};
+				std::optional<Tetrahedron> result = runGJKTransformed(info, -transform.position);
+				if(result) {
+					gjkResults.push_back(result.value());
+					collidingTransforms.push_back(transform);
+				}
+			}
+
+			PairMeasurement m;
+			m.pair = std::string(first.name) + "-" + second.name;
+			m.configuration = configuration;
+
+			m.gjkNanos = nanosPerCall(callCount, [&]() {
+				for(int r = 0; r < repetitions; r++) {
+					for(const CFrame& transform : transforms) {
+						ColissionPair info{*first.shape.baseShape, *second.shape.baseShape, transform, first.shape.scale, second.shape.scale};
+						std::optional<Tetrahedron> result = runGJKTransformed(info, -transform.position);
+						if(result) sink += result.value().A.p.x;
+					}
+				}
+			});
+
+			m.epaNanos = 0.0;
+			if(!gjkResults.empty()) {
+				m.epaNanos = nanosPerCall(static_cast<int>(gjkResults.size()) * repetitions, [&]() {
+					for(int r = 0; r < repetitions; r++) {
+						for(std::size_t i = 0; i < gjkResults.size(); i++) {
+							ColissionPair info{*first.shape.baseShape, *second.shape.baseShape, collidingTransforms[i], first.shape.scale, second.shape.scale};
+							Vec3f intersection;
+							Vec3f exitVector;
+							if(runEPATransformed(info, gjkResults[i], intersection, exitVector, buffers)) sink += exitVector.x;
+						}
+					}
+				});
+			}
+
+			// GJK ran repetitions + 1 times per transform, the average is the same
+			m.gjkIterations = configuration == PairConfiguration::SEPARATED ? averageIterations(GJKNoCollidesIterationStatistics) : averageIterations(GJKCollidesIterationStatistics);
+			m.epaIterations = averageIterations(EPAIterationStatistics);
+			if(configuration != PairConfiguration::SEPARATED) GJKNoCollidesIterationStatistics.nextTally();
+
+			m.fullNanos = nanosPerCall(callCount, [&]() {
+				for(int r = 0; r < repetitions; r++) {
+					for(const CFrame& transform : transforms) {
+						std::optional<Intersection> result = intersectsTransformed(first.shape, second.shape, transform);
+						if(result) sink += result.value().exitVector.x;
+					}
+				}
+			});
+
+			measurements.push_back(m);
+		}
+	}
+
+public:
+	NarrowphaseBenchmark() : Benchmark("narrowphase") {}
+
+	void parseArgs(const Util::ParsedArgs& args) override {
+		std::string reps = args.getOptional("narrowphaseReps");
+		if(!reps.empty()) repetitions = std::max(1, std::stoi(reps));
+	}
+
+	void init() override {
+		shapes = {
+			NamedShape{"box", boxShape(2.0, 2.0, 2.0)},
+			NamedShape{"sphere", sphereShape(1.0)},
+			NamedShape{"cylinder", cylinderShape(1.0, 2.0)},
+			NamedShape{"wedge", wedgeShape(2.0, 2.0, 2.0)},
+			NamedShape{"corner", cornerShape(2.0, 2.0, 2.0)},
+			NamedShape{"poly12", polyhedronShape(ShapeLibrary::createSphere(1.0f, 0))},
+			NamedShape{"poly42", polyhedronShape(ShapeLibrary::createSphere(1.0f, 1))},
+			NamedShape{"poly162", polyhedronShape(ShapeLibrary::createSphere(1.0f, 2))},
+			NamedShape{"poly642", polyhedronShape(ShapeLibrary::createSphere(1.0f, 3))},
+		};
+	}
+
+	void run() override {
+		measurements.clear();
+		for(std::size_t i = 0; i < shapes.size(); i++) {
+			for(std::size_t j = i; j < shapes.size(); j++) {
+				measurePair(shapes[i], shapes[j]);
+			}
+		}
+	}
+
+	void cleanup() override {
+		shapes.clear();
+	}
+
+	void printResults(double timeTaken) override {
+		std::stringstream ss;
+		ss.precision(1);
+		ss << std::fixed;
+		ss << "pair\tconfiguration\tGJK ns\tEPA ns\tfull ns\tGJK iters\tEPA iters\n";
+		for(const PairMeasurement& m : measurements) {
+			ss << m.pair << "\t" << configurationNames[static_cast<int>(m.configuration)] << "\t" << m.gjkNanos << "\t" << m.epaNanos << "\t" << m.fullNanos << "\t" << m.gjkIterations << "\t" << m.epaIterations << "\n";
+		}
+
+		setColor(TerminalColor::MAGENTA);
+		std::cout << "\n[Narrowphase]\n";
+		setColor(TerminalColor::WHITE);
+		std::cout << ss.str();
+	}
+
+	void reportMetrics(std::vector<BenchmarkMetric>& metrics) const override {
+		for(const PairMeasurement& m : measurements) {
+			std::string prefix = m.pair + "/" + configurationNames[static_cast<int>(m.configuration)] + "/";
+			metrics.push_back(BenchmarkMetric{prefix + "gjkNanos", m.gjkNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "epaNanos", m.epaNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "fullNanos", m.fullNanos});
+			metrics.push_back(BenchmarkMetric{prefix + "gjkIterations", m.gjkIterations});
+			metrics.push_back(BenchmarkMetric{prefix + "epaIterations", m.epaIterations});
+		}
+	}
+} narrowphase;
+};
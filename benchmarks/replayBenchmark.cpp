@@ -0,0 +1,96 @@
+#include "worldBenchmark.h"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <Physics3D/misc/serialization/serializeBasicTypes.h>
+#include <Physics3D/misc/serialization/worldRecording.h>
+
+#include "../util/cmdParser.h"
+#include "../util/terminalColor.h"
+
+namespace P3D {
+/*
+	Replays a recording, such as one made by a world benchmark with --record, with everything the world benchmarks measure
+	Recordings with checksums are checked tick by tick, a difference means the engine no longer simulates the recording the same way
+*/
+class ReplayBenchmark : public WorldBenchmark {
+	std::string replayFile;
+	std::unique_ptr<WorldReplayer> replayer;
+
+public:
+	ReplayBenchmark() : WorldBenchmark("replay", 0) {}
+
+	void parseArgs(const Util::ParsedArgs& args) override {
+		WorldBenchmark::parseArgs(args);
+		// the replayed events don't go through a recorder, so a recording of the replay would miss them
+		recordFile.clear();
+		replayFile = args.getOptional("replay");
+	}
+
+	void init() override {
+		if(replayFile.empty()) {
+			std::cout << "The replay benchmark needs --replay file, a recording made with --record\n";
+			return;
+		}
+		std::ifstream file(replayFile, std::ios::binary);
+		if(!file) {
+			std::cout << "Could not open " << replayFile << "\n";
+			return;
+		}
+
+		// the recording brings its own forces, and replaces the gravity of the constructor
+		world.clear();
+		try {
+			replayer = std::make_unique<WorldReplayer>(world, file);
+		} catch(const SerializationException& e) {
+			std::cout << "Could not read " << replayFile << ": " << e.what() << "\n";
+			world.clear();
+			return;
+		}
+		tickCount = static_cast<int>(replayer->getTickCount());
+	}
+
+	void run() override {
+		if(replayer == nullptr || world.physicals.empty()) return;
+		WorldBenchmark::run();
+	}
+
+	void tickWorld() override {
+		replayer->applyEvents();
+		WorldBenchmark::tickWorld();
+		replayer->checkTick();
+	}
+
+	void cleanup() override {
+		// the replayer takes its magnet out of the world before it is cleared
+		replayer.reset();
+		WorldBenchmark::cleanup();
+	}
+
+	void printResults(double timeTaken) override {
+		if(replayer == nullptr) return;
+		WorldBenchmark::printResults(timeTaken);
+
+		if(replayer->getCheckedTickCount() == 0) return;
+		if(replayer->getMismatchedTickCount() == 0) {
+			setColor(TerminalColor::GREEN);
+			std::cout << "All " << replayer->getCheckedTickCount() << " checksums match the recording\n";
+		} else {
+			setColor(TerminalColor::RED);
+			std::cout << replayer->getMismatchedTickCount() << "/" << replayer->getCheckedTickCount() << " checksums differ from the recording, the first at age " << replayer->getFirstMismatchAge() << "\n";
+		}
+		setColor(TerminalColor::WHITE);
+	}
+
+	void reportMetrics(std::vector<BenchmarkMetric>& metrics) const override {
+		if(replayer == nullptr) return;
+		WorldBenchmark::reportMetrics(metrics);
+		if(replayer->getCheckedTickCount() != 0) {
+			metrics.push_back(BenchmarkMetric{"mismatchedTicks", static_cast<double>(replayer->getMismatchedTickCount())});
+		}
+	}
+} replayBench;
+};
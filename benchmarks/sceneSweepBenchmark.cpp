@@ -0,0 +1,292 @@
+#include "worldBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <Physics3D/externalforces/directionalGravity.h>
+#include <Physics3D/geometry/shapeCreation.h>
+#include <Physics3D/geometry/shapeLibrary.h>
+#include <Physics3D/threading/threadPool.h>
+#include <Physics3D/misc/physicsProfiler.h>
+
+#include "../util/cmdParser.h"
+#include "../util/terminalColor.h"
+
+namespace P3D {
+enum class ShapeMix {
+	BOXES,
+	SPHERES,
+	POLYHEDRA,
+	MIXED
+};
+
+enum class SceneDensity {
+	// parts on a wide grid, falling onto the floor one layer deep
+	SPARSE,
+	// columns of parts resting on each other
+	STACKED
+};
+
+enum class LayerSetup {
+	SINGLE,
+	// parts spread over several layers that all collide with each other
+	MULTI,
+	// parts spread over several layers that only collide with their own floor
+	ISOLATED
+};
+
+static const char* shapeMixNames[]{"boxes", "spheres", "polyhedra", "mixed"};
+static const char* densityNames[]{"sparse", "stacked"};
+static const char* layerSetupNames[]{"single", "multi", "isolated"};
+
+#define SWEEP_LAYER_COUNT 4
+#define STACK_HEIGHT 10
+
+struct SceneSettings {
+	int partCount;
+	ShapeMix shapes;
+	SceneDensity density;
+	LayerSetup layers;
+
+	std::string getName() const {
+		return std::to_string(partCount) + "/" + shapeMixNames[static_cast<int>(shapes)] + "/" + densityNames[static_cast<int>(density)] + "/" + layerSetupNames[static_cast<int>(layers)];
+	}
+};
+
+// every part of a shape kind shares one Shape, so the shape classes don't dominate the memory of large scenes
+static std::vector<Shape> createShapePalette(ShapeMix mix) {
+	std::vector<Shape> boxes{boxShape(0.9, 0.9, 0.9)};
+	std::vector<Shape> spheres{sphereShape(0.45)};
+	std::vector<Shape> polyhedra{
+		polyhedronShape(ShapeLibrary::createPrism(6, 0.45f, 0.9f)),
+		polyhedronShape(ShapeLibrary::createSphere(0.45f, 1)),
+		polyhedronShape(ShapeLibrary::createPointyPrism(5, 0.45f, 0.6f, 0.15f, 0.15f))
+	};
+
+	switch(mix) {
+	case ShapeMix::BOXES: return boxes;
+	case ShapeMix::SPHERES: return spheres;
+	case ShapeMix::POLYHEDRA: return polyhedra;
+	default: break;
+	}
+	std::vector<Shape> result{boxes[0], spheres[0], cylinderShape(0.45, 0.9)};
+	result.insert(result.end(), polyhedra.begin(), polyhedra.end());
+	return result;
+}
+
+static void buildScene(WorldPrototype& world, const SceneSettings& settings) {
+	world.addExternalForce(new DirectionalGravity(Vec3(0, -10, 0)));
+
+	int layerCount = settings.layers == LayerSetup::SINGLE ? 1 : SWEEP_LAYER_COUNT;
+	for(int i = 1; i < layerCount; i++) {
+		world.createLayer(true, settings.layers == LayerSetup::MULTI);
+	}
+
+	int columnHeight = settings.density == SceneDensity::STACKED ? STACK_HEIGHT : 1;
+	double spacing = settings.density == SceneDensity::STACKED ? 1.0 : 3.0;
+	int columnCount = (settings.partCount + columnHeight - 1) / columnHeight;
+	int gridSide = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(columnCount))));
+	double halfWidth = gridSide * spacing / 2;
+
+	// terrain never collides with terrain, so every layer can have its own floor
+	for(int layer = 0; layer < layerCount; layer++) {
+		world.addTerrainPart(new Part(boxShape(2 * halfWidth + 4.0, 1.0, 2 * halfWidth + 4.0), GlobalCFrame(0.0, -0.5, 0.0), basicProperties), layer);
+	}
+
+	std::vector<Shape> palette = createShapePalette(settings.shapes);
+	for(int i = 0; i < settings.partCount; i++) {
+		int column = i / columnHeight;
+		int level = i % columnHeight;
+		double x = (column % gridSide) * spacing - halfWidth;
+		double z = (column / gridSide) * spacing - halfWidth;
+		// sparse parts start at different heights, so they don't all land on the same tick
+		double y = settings.density == SceneDensity::STACKED ? 0.46 + level * 0.92 : 1.0 + (column % 7) * 0.5;
+		world.addPart(new Part(palette[i % palette.size()], GlobalCFrame(x, y, z), basicProperties), i % layerCount);
+	}
+}
+
+// resident memory of this process, 0 where it can't be read
+static std::size_t getResidentBytes() {
+#ifdef __linux__
+	std::FILE* statm = std::fopen("/proc/self/statm", "r");
+	if(statm == nullptr) return 0;
+	unsigned long totalPages = 0;
+	unsigned long residentPages = 0;
+	int read = std::fscanf(statm, "%lu %lu", &totalPages, &residentPages);
+	std::fclose(statm);
+	return read == 2 ? residentPages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+	return 0;
+#endif
+}
+
+static void releaseFreedMemory() {
+#ifdef __GLIBC__
+	malloc_trim(0);
+#endif
+}
+
+template<typename Enum>
+static std::vector<Enum> parseEnumList(const std::string& list, const char* const* names, int nameCount, std::vector<Enum> defaultValue) {
+	if(list.empty()) return defaultValue;
+	std::vector<Enum> result;
+	std::stringstream ss(list);
+	std::string item;
+	while(std::getline(ss, item, ',')) {
+		for(int i = 0; i < nameCount; i++) {
+			if(item == names[i]) result.push_back(static_cast<Enum>(i));
+		}
+	}
+	return result.empty() ? defaultValue : result;
+}
+
+/*
+	Builds a generated scene for every combination of the options, ticks it and records ticks per second, time per PhysicsProcess and memory per part
+	Options: --parts 1000,1000000      part counts, 1000,10000,100000 by default
+	         --shapes boxes,mixed      any of boxes, spheres, polyhedra, mixed, mixed by default
+	         --density sparse,stacked  sparse, stacked or both, both by default
+	         --layers single,isolated  any of single, multi, isolated, single by default
+	         --sweepTicks N            ticks per scene, 20 by default
+	         --sweepThreads N          size of the ThreadPool the scenes are ticked on, 1 by default
+	Memory per part is the growth of the resident memory of the process while building the scene and running its ticks, it is only measured on Linux
+*/
+class SceneSweepBenchmark : public Benchmark {
+	static constexpr std::size_t PHASE_COUNT = static_cast<std::size_t>(PhysicsProcess::COUNT);
+
+	struct SweepResult {
+		SceneSettings settings;
+		double buildMillis;
+		double ticksPerSecond;
+		double phaseMillisPerTick[PHASE_COUNT];
+		double bytesPerPart;
+	};
+
+	std::vector<SceneSettings> scenes;
+	int tickCount = 20;
+	unsigned int threadCount = 1;
+	std::vector<SweepResult> results;
+
+public:
+	SceneSweepBenchmark() : Benchmark("sceneSweep") {}
+
+	void parseArgs(const Util::ParsedArgs& args) override {
+		std::vector<int> partCounts;
+		std::stringstream ss(args.getOptional("parts"));
+		std::string item;
+		while(std::getline(ss, item, ',')) {
+			if(!item.empty()) partCounts.push_back(std::max(1, std::stoi(item)));
+		}
+		if(partCounts.empty()) partCounts = {1000, 10000, 100000};
+
+		std::vector<ShapeMix> mixes = parseEnumList(args.getOptional("shapes"), shapeMixNames, 4, std::vector<ShapeMix>{ShapeMix::MIXED});
+		std::vector<SceneDensity> densities = parseEnumList(args.getOptional("density"), densityNames, 2, std::vector<SceneDensity>{SceneDensity::SPARSE, SceneDensity::STACKED});
+		std::vector<LayerSetup> layerSetups = parseEnumList(args.getOptional("layers"), layerSetupNames, 3, std::vector<LayerSetup>{LayerSetup::SINGLE});
+
+		// smallest scenes first, so a sweep that is cut short still produced the cheap results
+		scenes.clear();
+		for(int partCount : partCounts) {
+			for(ShapeMix mix : mixes) {
+				for(SceneDensity density : densities) {
+					for(LayerSetup layers : layerSetups) {
+						scenes.push_back(SceneSettings{partCount, mix, density, layers});
+					}
+				}
+			}
+		}
+
+		std::string ticks = args.getOptional("sweepTicks");
+		if(!ticks.empty()) tickCount = std::max(1, std::stoi(ticks));
+		std::string threads = args.getOptional("sweepThreads");
+		if(!threads.empty()) threadCount = static_cast<unsigned int>(std::max(1, std::stoi(threads)));
+	}
+
+	void run() override {
+		results.clear();
+		ThreadPool pool(threadCount);
+
+		for(const SceneSettings& settings : scenes) {
+			releaseFreedMemory();
+			std::size_t memoryBefore = getResidentBytes();
+
+			SweepResult result;
+			result.settings = settings;
+
+			auto buildStart = std::chrono::high_resolution_clock::now();
+			std::unique_ptr<WorldPrototype> world = std::make_unique<WorldPrototype>(0.005);
+			buildScene(*world, settings);
+			result.buildMillis = (std::chrono::high_resolution_clock::now() - buildStart).count() / 1000000.0;
+
+			std::chrono::nanoseconds phaseTotals[PHASE_COUNT]{};
+			physicsMeasure.end();
+			auto tickStart = std::chrono::high_resolution_clock::now();
+			for(int i = 0; i < tickCount; i++) {
+				profiledTick(*world, &pool, phaseTotals);
+			}
+			double tickSeconds = (std::chrono::high_resolution_clock::now() - tickStart).count() / 1000000000.0;
+
+			std::size_t memoryAfter = getResidentBytes();
+			result.ticksPerSecond = tickCount / tickSeconds;
+			for(std::size_t phase = 0; phase < PHASE_COUNT; phase++) {
+				result.phaseMillisPerTick[phase] = phaseTotals[phase].count() / 1000000.0 / tickCount;
+			}
+			result.bytesPerPart = memoryAfter > memoryBefore ? static_cast<double>(memoryAfter - memoryBefore) / settings.partCount : 0.0;
+			results.push_back(result);
+
+			setColor(TerminalColor::WHITE);
+			std::cout << "\n" << settings.getName() << ": " << result.ticksPerSecond << " ticks/s";
+			std::cout.flush();
+		}
+		std::cout << "\n";
+	}
+
+	void printResults(double timeTaken) override {
+		std::stringstream ss;
+		ss.precision(3);
+		ss << std::fixed;
+
+		ss << "scene\tbuild ms\tticks/s\tbytes/part";
+		for(std::size_t phase = 0; phase < PHASE_COUNT; phase++) {
+			ss << "\t" << physicsMeasure.labels[phase];
+		}
+		ss << "\n";
+		for(const SweepResult& r : results) {
+			ss << r.settings.getName() << "\t" << r.buildMillis << "\t" << r.ticksPerSecond << "\t" << r.bytesPerPart;
+			for(std::size_t phase = 0; phase < PHASE_COUNT; phase++) {
+				ss << "\t" << r.phaseMillisPerTick[phase];
+			}
+			ss << "\n";
+		}
+
+		setColor(TerminalColor::MAGENTA);
+		std::cout << "\n[Scene Sweep, phases in ms/tick]\n";
+		setColor(TerminalColor::WHITE);
+		std::cout << ss.str();
+	}
+
+	void reportMetrics(std::vector<BenchmarkMetric>& metrics) const override {
+		for(const SweepResult& r : results) {
+			std::string prefix = r.settings.getName() + "/";
+			metrics.push_back(BenchmarkMetric{prefix + "buildMillis", r.buildMillis});
+			metrics.push_back(BenchmarkMetric{prefix + "ticksPerSecond", r.ticksPerSecond});
+			metrics.push_back(BenchmarkMetric{prefix + "bytesPerPart", r.bytesPerPart});
+			for(std::size_t phase = 0; phase < PHASE_COUNT; phase++) {
+				metrics.push_back(BenchmarkMetric{prefix + physicsMeasure.labels[phase], r.phaseMillisPerTick[phase]});
+			}
+		}
+	}
+} sceneSweep;
+};
@@ -0,0 +1,136 @@
+#include "worldBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Physics3D/threading/threadPool.h>
+#include <Physics3D/misc/physicsProfiler.h>
+
+#include "../util/cmdParser.h"
+#include "../util/terminalColor.h"
+
+namespace P3D {
+/*
+	Ticks one of the world benchmarks through tick(ThreadPool&) once for every thread count, and reports the speedup over one thread per PhysicsProcess
+	Options: --threads 1,2,8 overrides the thread counts, which default to the powers of two up to hardware_concurrency and hardware_concurrency itself
+	         --ticks N overrides the number of ticks per thread count, which defaults to at most 1000
+	Only the ticking thread is profiled, so GJK and EPA show its own share of the narrowphase, and its wait for the helper threads counts as Collision
+*/
+class ThreadScalingBenchmark : public Benchmark {
+	static constexpr std::size_t PHASE_COUNT = static_cast<std::size_t>(PhysicsProcess::COUNT);
+
+	struct ScalingRun {
+		unsigned int threadCount;
+		double millisPerTick;
+		double phaseMillisPerTick[PHASE_COUNT];
+	};
+
+	const char* sceneName;
+	std::vector<unsigned int> threadCounts;
+	int tickCount = 0;
+	std::vector<ScalingRun> runs;
+
+public:
+	ThreadScalingBenchmark(const char* name, const char* sceneName) : Benchmark(name), sceneName(sceneName) {}
+
+	void parseArgs(const Util::ParsedArgs& args) override {
+		std::string threads = args.getOptional("threads");
+		std::stringstream ss(threads);
+		std::string item;
+		while(std::getline(ss, item, ',')) {
+			if(!item.empty()) threadCounts.push_back(static_cast<unsigned int>(std::max(1, std::stoi(item))));
+		}
+		if(threadCounts.empty()) {
+			unsigned int maxThreads = std::max(1U, std::thread::hardware_concurrency());
+			for(unsigned int count = 1; count < maxThreads; count *= 2) {
+				threadCounts.push_back(count);
+			}
+			threadCounts.push_back(maxThreads);
+		}
+
+		std::string ticks = args.getOptional("ticks");
+		if(!ticks.empty()) tickCount = std::max(1, std::stoi(ticks));
+	}
+
+	void run() override {
+		runs.clear();
+		WorldBenchmark* scene = dynamic_cast<WorldBenchmark*>(getBenchFor(sceneName));
+		if(scene == nullptr) return;
+
+		int originalTickCount = scene->tickCount;
+		scene->tickCount = tickCount != 0 ? tickCount : std::min(originalTickCount, 1000);
+
+		for(unsigned int threadCount : threadCounts) {
+			ThreadPool pool(threadCount);
+			scene->threadPool = &pool;
+			scene->init();
+
+			// claims the profiler for this thread, so the helper threads of the pool don't mix up its phases
+			physicsMeasure.end();
+
+			auto start = std::chrono::high_resolution_clock::now();
+			scene->run();
+			double millis = (std::chrono::high_resolution_clock::now() - start).count() / 1000000.0;
+
+			ScalingRun result;
+			result.threadCount = threadCount;
+			result.millisPerTick = millis / scene->tickCount;
+			for(std::size_t phase = 0; phase < PHASE_COUNT; phase++) {
+				result.phaseMillisPerTick[phase] = scene->phaseTotals[phase].count() / 1000000.0 / scene->tickCount;
+			}
+			runs.push_back(result);
+
+			scene->cleanup();
+			scene->threadPool = nullptr;
+		}
+
+		scene->tickCount = originalTickCount;
+	}
+
+	void printResults(double timeTaken) override {
+		if(runs.empty()) return;
+		const ScalingRun& base = runs[0];
+
+		std::stringstream ss;
+		ss.precision(3);
+		ss << std::fixed;
+
+		ss << "threads  ms/tick   speedup  efficiency\n";
+		for(const ScalingRun& r : runs) {
+			double speedup = base.millisPerTick / r.millisPerTick;
+			double efficiency = speedup * base.threadCount / r.threadCount;
+			ss << r.threadCount << "\t " << r.millisPerTick << "\t   " << speedup << "\t    " << efficiency * 100.0 << "%\n";
+		}
+
+		// every column is ms/tick of that phase followed by its speedup over the first thread count
+		ss << "\nphase ms/tick (speedup)";
+		for(const ScalingRun& r : runs) {
+			ss << "\t" << r.threadCount << " threads";
+		}
+		ss << "\n";
+		for(std::size_t phase = 0; phase < PHASE_COUNT; phase++) {
+			if(base.phaseMillisPerTick[phase] == 0.0) continue;
+			ss << physicsMeasure.labels[phase] << ":";
+			for(const ScalingRun& r : runs) {
+				double speedup = r.phaseMillisPerTick[phase] != 0.0 ? base.phaseMillisPerTick[phase] / r.phaseMillisPerTick[phase] : 0.0;
+				ss << "\t" << r.phaseMillisPerTick[phase] << " (" << speedup << ")";
+			}
+			ss << "\n";
+		}
+
+		setColor(TerminalColor::MAGENTA);
+		std::cout << "\n[Thread Scaling of " << sceneName << "]\n";
+		setColor(TerminalColor::WHITE);
+		std::cout << ss.str();
+	}
+};
+
+ThreadScalingBenchmark basicWorldScaling("basicWorldScaling", "basicWorld");
+ThreadScalingBenchmark manyCubesScaling("manyCubesScaling", "manyCubes");
+ThreadScalingBenchmark complexObjectScaling("complexObjectScaling", "complexObject");
+};
@@ -1,10 +1,12 @@
 #include "worldBenchmark.h"
 
 #include "../util/log.h"
+#include "../util/cmdParser.h"
 #include "../util/terminalColor.h"
 #include <iostream>
 #include <sstream>
 #include <cstddef>
+#include <cstring>
 #include <Physics3D/externalforces/directionalGravity.h>
 
 #include <Physics3D/geometry/shape.h>
@@ -17,17 +19,74 @@
 
 #include <Physics3D/world.h>
 #include <Physics3D/worldIteration.h>
+#include <Physics3D/threading/threadPool.h>
+#include <Physics3D/misc/serialization/worldRecording.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
 
 namespace P3D {
 WorldBenchmark::WorldBenchmark(const char* name, int tickCount) : Benchmark(name), world(0.005), tickCount(tickCount) {
 	world.addExternalForce(new DirectionalGravity(Vec3(0, -10, 0)));
 }
 
+void WorldBenchmark::parseArgs(const Util::ParsedArgs& args) {
+	useHardwareCounters = args.hasFlag("counters");
+	trackAllocations = args.hasFlag("allocations");
+	recordFile = args.getOptional("record");
+}
+
+// file.bin becomes file_name.bin, so every benchmark run with --record writes its own recording
+static std::string getRecordFileFor(const std::string& recordFile, const char* name) {
+	std::size_t extension = recordFile.find_last_of('.');
+	std::size_t directory = recordFile.find_last_of("/\\");
+	if(extension == std::string::npos || (directory != std::string::npos && extension < directory)) {
+		return recordFile + "_" + name;
+	}
+	return recordFile.substr(0, extension) + "_" + name + recordFile.substr(extension);
+}
+
 void WorldBenchmark::run() {
+	for(std::chrono::nanoseconds& total : phaseTotals) total = std::chrono::nanoseconds(0);
+	physicsMeasure.clearLatencies();
+
+	HardwareCounters counters;
+	if(useHardwareCounters) {
+		if(counters.open()) {
+			physicsMeasure.setHardwareCounters(&counters);
+		} else {
+			Log::warn("Hardware counters are unavailable, perf_event_open may not be allowed here\n");
+		}
+		for(std::size_t i = 0; i < HARDWARE_COUNTER_COUNT; i++) {
+			countersAvailable[i] = counters.isAvailable(static_cast<HardwareCounter>(i));
+		}
+	}
+	if(trackAllocations) {
+		physicsMeasure.setTrackAllocations(true);
+		allocationTracker.enable();
+	}
+
+	// only the first run is recorded, the checksums slow down the ticks, so use --warmup to keep it out of the measured runs
+	std::ofstream recordStream;
+	std::unique_ptr<WorldRecorder> recorder;
+	if(!recordFile.empty() && !recorded) {
+		recorded = true;
+		std::string fileName = getRecordFileFor(recordFile, name);
+		recordStream.open(fileName, std::ios::binary);
+		if(recordStream) {
+			Log::print("Recording %s to %s\n", name, fileName.c_str());
+			recorder = std::make_unique<WorldRecorder>(world, recordStream, true);
+		} else {
+			Log::warn("Could not open %s for recording\n", fileName.c_str());
+		}
+	}
+
 	world.isValid();
 	Part& partToTrack = *world.physicals[0]->getMainPart();
+	int logInterval = std::max(1, tickCount / 8);
 	for(int i = 0; i < tickCount; i++) {
-		if(i % (tickCount / 8) == 0) {
+		if(i % logInterval == 0) {
 			Log::print("Tick %d\n", i);
 			Position pos = partToTrack.getCFrame().getPosition();
 			Log::print("Location of object: %.5f %.5f %.5f\n", double(pos.x), double(pos.y), double(pos.z));
@@ -40,17 +99,46 @@ void WorldBenchmark::run() {
 			Log::print("%d/%d parts out of bounds!\n", partsOutOfBounds, world.getPartCount());
 		}
 
-		physicsMeasure.mark(PhysicsProcess::OTHER);
+		tickWorld();
+		if(recorder != nullptr) recorder->afterTick();
+	}
+	world.isValid();
+	if(recorder != nullptr) recorder->finish();
+
+	physicsMeasure.setHardwareCounters(nullptr);
+	if(trackAllocations) {
+		allocationTracker.disable();
+		physicsMeasure.setTrackAllocations(false);
+	}
+}
 
-		world.tick();
+void WorldBenchmark::tickWorld() {
+	profiledTick(world, threadPool, phaseTotals);
+}
 
-		physicsMeasure.end();
+void profiledTick(WorldPrototype& world, ThreadPool* threadPool, std::chrono::nanoseconds* phaseTotals) {
+	physicsMeasure.mark(PhysicsProcess::OTHER);
 
-		GJKCollidesIterationStatistics.nextTally();
-		GJKNoCollidesIterationStatistics.nextTally();
-		EPAIterationStatistics.nextTally();
+	if(threadPool != nullptr) {
+		world.tick(*threadPool);
+	} else {
+		world.tick();
 	}
-	world.isValid();
+
+	physicsMeasure.end();
+	for(std::size_t phase = 0; phase < physicsMeasure.size(); phase++) {
+		phaseTotals[phase] += physicsMeasure.history.front()[phase];
+	}
+
+	GJKCollidesIterationStatistics.nextTally();
+	GJKNoCollidesIterationStatistics.nextTally();
+	EPAIterationStatistics.nextTally();
+}
+
+void WorldBenchmark::cleanup() {
+	// clear also removes the gravity added by the constructor
+	world.clear();
+	world.addExternalForce(new DirectionalGravity(Vec3(0, -10, 0)));
 }
 
 static const std::size_t LABEL_LENGTH = 23;
@@ -149,6 +237,118 @@ void printBreakdown(const T* values, const char** labels, std::size_t N, std::st
 
 }
 
+static double toMillis(std::chrono::nanoseconds duration) {
+	return duration.count() / 1000000.0;
+}
+
+static void printLatencies() {
+	std::stringstream ss;
+	ss.precision(3);
+	ss << std::fixed;
+	ss << "ms\t\tp50\tp99\tp99.9\tmax\n";
+
+	const LatencyHistogram& tick = physicsMeasure.tickLatency;
+	ss << "Tick:\t\t" << toMillis(tick.getPercentile(50.0)) << "\t" << toMillis(tick.getPercentile(99.0)) << "\t" << toMillis(tick.getPercentile(99.9)) << "\t" << toMillis(tick.getMax()) << "\n";
+	for(std::size_t i = 0; i < physicsMeasure.size(); i++) {
+		const LatencyHistogram& process = physicsMeasure.processLatencies[i];
+		if(process.getMax().count() == 0) continue;
+		ss << physicsMeasure.labels[i] << ":" << (std::strlen(physicsMeasure.labels[i]) < 7 ? "\t\t" : "\t");
+		ss << toMillis(process.getPercentile(50.0)) << "\t" << toMillis(process.getPercentile(99.0)) << "\t" << toMillis(process.getPercentile(99.9)) << "\t" << toMillis(process.getMax()) << "\n";
+	}
+
+	setColor(TerminalColor::WHITE);
+	std::cout << "\n";
+	setColor(TerminalColor::MAGENTA);
+	std::cout << "[Tick Latency over " << tick.getCount() << " ticks]\n";
+	setColor(TerminalColor::WHITE);
+	std::cout << ss.str();
+}
+
+// per 1000 instructions
+static double perKiloInstruction(long long count, long long instructions) {
+	return instructions != 0 ? 1000.0 * count / instructions : 0.0;
+}
+
+/*
+	The average counts per tick of every process, only those of the thread that ticks
+	Misses are given per 1000 instructions, so phases of different length compare
+*/
+static void printHardwareCounters(const bool* available) {
+	auto counterBreakdown = physicsMeasure.counterHistory.avg();
+
+	std::stringstream ss;
+	ss.precision(2);
+	ss << std::fixed;
+	ss << "per tick	kcycles	kinstr	IPC";
+	if(available[static_cast<std::size_t>(HardwareCounter::CACHE_MISSES)]) ss << "	cache/ki";
+	if(available[static_cast<std::size_t>(HardwareCounter::BRANCH_MISSES)]) ss << "	branch/ki";
+	if(available[static_cast<std::size_t>(HardwareCounter::DTLB_MISSES)]) ss << "	dTLB/ki";
+	ss << "\n";
+
+	for(std::size_t i = 0; i < physicsMeasure.size(); i++) {
+		const HardwareCounterValues& values = counterBreakdown.values[i];
+		long long cycles = values[HardwareCounter::CYCLES];
+		long long instructions = values[HardwareCounter::INSTRUCTIONS];
+		if(cycles == 0 && instructions == 0) continue;
+
+		ss << physicsMeasure.labels[i] << ":" << (std::strlen(physicsMeasure.labels[i]) < 7 ? "\t\t" : "\t");
+		ss << cycles / 1000.0 << "\t" << instructions / 1000.0 << "\t" << (cycles != 0 ? double(instructions) / cycles : 0.0);
+		if(available[static_cast<std::size_t>(HardwareCounter::CACHE_MISSES)]) ss << "\t" << perKiloInstruction(values[HardwareCounter::CACHE_MISSES], instructions);
+		if(available[static_cast<std::size_t>(HardwareCounter::BRANCH_MISSES)]) ss << "\t" << perKiloInstruction(values[HardwareCounter::BRANCH_MISSES], instructions);
+		if(available[static_cast<std::size_t>(HardwareCounter::DTLB_MISSES)]) ss << "\t" << perKiloInstruction(values[HardwareCounter::DTLB_MISSES], instructions);
+		ss << "\n";
+	}
+
+	setColor(TerminalColor::WHITE);
+	std::cout << "\n";
+	setColor(TerminalColor::MAGENTA);
+	std::cout << "[Hardware Counters over " << physicsMeasure.counterHistory.size() << " ticks]\n";
+	setColor(TerminalColor::WHITE);
+	std::cout << ss.str();
+}
+
+// the most allocations any tick in allocationHistory made
+static long long getMaxAllocationsPerTick() {
+	long long result = 0;
+	for(const ParallelArray<AllocationCounts, static_cast<std::size_t>(PhysicsProcess::COUNT)>& tick : physicsMeasure.allocationHistory) {
+		long long allocations = 0;
+		for(const AllocationCounts& counts : tick.values) {
+			allocations += counts.allocations;
+		}
+		result = std::max(result, allocations);
+	}
+	return result;
+}
+
+// the average allocations per tick of every process, made by any thread while the ticking thread was in it
+static void printAllocations() {
+	// summed rather than averaged, a phase that allocates once every few ticks must not show up as 0
+	auto allocationSums = physicsMeasure.allocationHistory.sum();
+	double tickCount = static_cast<double>(physicsMeasure.allocationHistory.size());
+	AllocationCounts total;
+
+	std::stringstream ss;
+	ss.precision(2);
+	ss << std::fixed;
+	ss << "per tick\tallocs\tfrees\tbytes\n";
+	for(std::size_t i = 0; i < physicsMeasure.size(); i++) {
+		const AllocationCounts& counts = allocationSums.values[i];
+		total += counts;
+		if(counts.allocations == 0 && counts.frees == 0) continue;
+		ss << physicsMeasure.labels[i] << ":" << (std::strlen(physicsMeasure.labels[i]) < 7 ? "\t\t" : "\t");
+		ss << counts.allocations / tickCount << "\t" << counts.frees / tickCount << "\t" << counts.bytes / tickCount << "\n";
+	}
+	ss << "Total:\t\t" << total.allocations / tickCount << "\t" << total.frees / tickCount << "\t" << total.bytes / tickCount << "\n";
+	ss << "Most allocations in one tick: " << getMaxAllocationsPerTick() << "\n";
+
+	setColor(TerminalColor::WHITE);
+	std::cout << "\n";
+	setColor(TerminalColor::MAGENTA);
+	std::cout << "[Allocations over " << physicsMeasure.allocationHistory.size() << " ticks]\n";
+	setColor(TerminalColor::WHITE);
+	std::cout << ss.str();
+}
+
 void WorldBenchmark::printResults(double timeTakenMillis) {
 	double tickTime = (timeTakenMillis) / tickCount;
 	Log::print("%d ticks at %f ticks per second\n", tickCount, 1000 / tickTime);
@@ -167,6 +367,14 @@ void WorldBenchmark::printResults(double timeTakenMillis) {
 	std::cout << "[Physics Profiler]\n";
 	printBreakdown(millis, physicsMeasure.labels, physicsMeasure.size(), "ms");
 
+	printLatencies();
+	if(useHardwareCounters && physicsMeasure.counterHistory.size() != 0) {
+		printHardwareCounters(countersAvailable);
+	}
+	if(trackAllocations && physicsMeasure.allocationHistory.size() != 0) {
+		printAllocations();
+	}
+
 	setColor(TerminalColor::WHITE);
 	std::cout << "\n";
 	setColor(TerminalColor::MAGENTA);
@@ -183,4 +391,42 @@ void WorldBenchmark::createFloor(double w, double h, double wallHeight) {
 	world.addTerrainPart(new Part(boxShape(w, wallHeight, 0.8), GlobalCFrame(0.0, wallHeight / 2, h), basicProperties));
 	world.addTerrainPart(new Part(boxShape(w, wallHeight, 0.8), GlobalCFrame(0.0, wallHeight / 2, -h), basicProperties));
 }
-};
+
+void WorldBenchmark::reportMetrics(std::vector<BenchmarkMetric>& metrics) const {
+	const LatencyHistogram& tick = physicsMeasure.tickLatency;
+	metrics.push_back(BenchmarkMetric{"tickP50Millis", toMillis(tick.getPercentile(50.0))});
+	metrics.push_back(BenchmarkMetric{"tickP99Millis", toMillis(tick.getPercentile(99.0))});
+	metrics.push_back(BenchmarkMetric{"tickP999Millis", toMillis(tick.getPercentile(99.9))});
+	metrics.push_back(BenchmarkMetric{"tickMaxMillis", toMillis(tick.getMax())});
+	for(std::size_t i = 0; i < physicsMeasure.size(); i++) {
+		const LatencyHistogram& process = physicsMeasure.processLatencies[i];
+		if(process.getMax().count() == 0) continue;
+		metrics.push_back(BenchmarkMetric{std::string(physicsMeasure.labels[i]) + "/p99Millis", toMillis(process.getPercentile(99.0))});
+		metrics.push_back(BenchmarkMetric{std::string(physicsMeasure.labels[i]) + "/maxMillis", toMillis(process.getMax())});
+	}
+
+	if(useHardwareCounters && physicsMeasure.counterHistory.size() != 0) {
+		auto counterBreakdown = physicsMeasure.counterHistory.avg();
+		for(std::size_t i = 0; i < physicsMeasure.size(); i++) {
+			const HardwareCounterValues& values = counterBreakdown.values[i];
+			if(values[HardwareCounter::CYCLES] == 0) continue;
+			for(std::size_t c = 0; c < HARDWARE_COUNTER_COUNT; c++) {
+				if(!countersAvailable[c]) continue;
+				metrics.push_back(BenchmarkMetric{std::string(physicsMeasure.labels[i]) + "/" + hardwareCounterLabels[c], static_cast<double>(values.values[c])});
+			}
+		}
+	}
+
+	if(trackAllocations && physicsMeasure.allocationHistory.size() != 0) {
+		auto allocationSums = physicsMeasure.allocationHistory.sum();
+		double tickCount = static_cast<double>(physicsMeasure.allocationHistory.size());
+		AllocationCounts total;
+		for(std::size_t i = 0; i < physicsMeasure.size(); i++) {
+			total += allocationSums.values[i];
+		}
+		metrics.push_back(BenchmarkMetric{"allocationsPerTick", total.allocations / tickCount});
+		metrics.push_back(BenchmarkMetric{"allocatedBytesPerTick", total.bytes / tickCount});
+		metrics.push_back(BenchmarkMetric{"maxAllocationsPerTick", static_cast<double>(getMaxAllocationsPerTick())});
+	}
+}
+};
\ No newline at end of file
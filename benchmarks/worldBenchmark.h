@@ -2,20 +2,51 @@
 
 #include "benchmark.h"
 #include <Physics3D/world.h>
+#include <Physics3D/misc/physicsProfiler.h>
+#include <Physics3D/misc/hardwareCounters.h>
+
+#include <chrono>
+#include <string>
 
 namespace P3D {
+class ThreadPool;
+
 static const PartProperties basicProperties{1.0, 0.7, 0.5};
 class WorldBenchmark : public Benchmark {
+	friend class ThreadScalingBenchmark;
+
 protected:
 	WorldPrototype world;
 	int tickCount;
+	// ticks are run on this pool if set, otherwise through world.tick() on a single thread
+	ThreadPool* threadPool = nullptr;
+	// time spent in every PhysicsProcess, summed over all ticks of the last run
+	std::chrono::nanoseconds phaseTotals[static_cast<std::size_t>(PhysicsProcess::COUNT)];
+	// -counters, samples the CPU counters of the ticking thread per PhysicsProcess where perf_event_open is allowed
+	bool useHardwareCounters = false;
+	bool countersAvailable[HARDWARE_COUNTER_COUNT]{};
+	// -allocations, counts the heap allocations of every tick per PhysicsProcess
+	bool trackAllocations = false;
+	// --record file, writes the first run as a WorldRecording with checksums, which the replay benchmark can replay
+	// every benchmark writes its own file, with its name added to the given one
+	std::string recordFile;
+	bool recorded = false;
+
+	// one profiled tick of the world
+	virtual void tickWorld();
 
 public:
 	WorldBenchmark(const char* name, int tickCount);
 
+	virtual void parseArgs(const Util::ParsedArgs& args) override;
 	virtual void run() override;
+	virtual void cleanup() override;
 	virtual void printResults(double timeTaken) override;
+	virtual void reportMetrics(std::vector<BenchmarkMetric>& metrics) const override;
 
 	void createFloor(double w, double h, double wallHeight);
 };
+
+// ticks world on threadPool, or on a single thread if it is nullptr, with the profiler running, and adds the time of every PhysicsProcess to phaseTotals
+void profiledTick(WorldPrototype& world, ThreadPool* threadPool, std::chrono::nanoseconds* phaseTotals);
 };
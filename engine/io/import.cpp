@@ -485,6 +485,12 @@ Graphics::ExtendedTriangleMesh OBJImport::load(const std::string& file, bool bin
 	return shape;
 }
 
+std::vector<Polyhedron> OBJImport::loadConvexDecomposition(const std::string& file, const ConvexDecompositionSettings& settings) {
+	Graphics::ExtendedTriangleMesh mesh = load(file);
+
+	return decomposeConvex(mesh, settings);
+}
+
 /*
 	End of OBJImport
 */
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <istream>
+#include <vector>
+
+#include <Physics3D/geometry/convexDecomposition.h>
 
 namespace P3D::Graphics {
 struct ExtendedTriangleMesh;
@@ -30,6 +33,9 @@ namespace OBJImport {
 	Graphics::ExtendedTriangleMesh load(std::istream& file, bool binary = false);
 	Graphics::ExtendedTriangleMesh load(const std::string& file, bool binary);
 	Graphics::ExtendedTriangleMesh load(const std::string& file);
+
+	// Loads a closed mesh and splits it into convex hulls for collision, see decomposeConvex
+	std::vector<Polyhedron> loadConvexDecomposition(const std::string& file, const ConvexDecompositionSettings& settings = ConvexDecompositionSettings());
 };
 
 };
\ No newline at end of file
@@ -13,11 +13,21 @@
 #include <Physics3D/geometry/shape.h>
 
 #include <Physics3D/geometry/shapeLibrary.h>
+#include <Physics3D/geometry/shapeCreation.h>
+#include <Physics3D/geometry/intersection.h>
+#include <Physics3D/geometry/batchedGJK.h>
+#include <Physics3D/geometry/triangleBVH.h>
+#include <Physics3D/geometry/convexDecomposition.h>
+#include <Physics3D/geometry/quickhull.h>
+#include <Physics3D/threading/threadPool.h>
+#include <Physics3D/part.h>
+#include <Physics3D/world.h>
 
 #include "testValues.h"
 #include "generators.h"
 
 #include <Physics3D/misc/cpuid.h>
+#include <Physics3D/misc/physicsProfiler.h>
 #include <Physics3D/geometry/builtinShapeClasses.h>
 
 using namespace P3D;
@@ -293,3 +303,578 @@ TEST_CASE(testTriangleMeshOptimizedFurthestInDirection) {
 	}
 }
 
+TEST_CASE(hillClimbingFurthestIndexInDirection) {
+	Polyhedron sphere = ShapeLibrary::createSphere(1.0, 4);
+	VertexAdjacency adjacency = sphere.computeVertexAdjacency();
+
+	int startIndex = 0;
+	for(int iter = 0; iter < 1000; iter++) {
+		Vec3f dir = generateVec3f();
+		int reference = sphere.furthestIndexInDirectionFallback(dir);
+		startIndex = sphere.furthestIndexInDirectionHillClimb(dir, adjacency, startIndex);
+		ASSERT(sphere.getVertex(reference) * dir == sphere.getVertex(startIndex) * dir);
+	}
+}
+
+TEST_CASE(largePolyhedronShapeUsesHillClimbing) {
+	Shape sphere = polyhedronShape(ShapeLibrary::createSphere(1.0, 4));
+	ASSERT_TRUE(dynamic_cast<const PolyhedronShapeClassHillClimbing*>(sphere.baseShape.get()) != nullptr);
+
+	Polyhedron reference = sphere.baseShape->asPolyhedron();
+	for(int iter = 0; iter < 100; iter++) {
+		Vec3f dir = generateVec3f();
+		ASSERT(reference.furthestInDirectionFallback(dir) * dir == sphere.baseShape->furthestInDirection(dir) * dir);
+	}
+
+	int searchState = 0;
+	for(int iter = 0; iter < 100; iter++) {
+		Vec3f dir = generateVec3f();
+		ASSERT(reference.furthestInDirectionFallback(dir) * dir == sphere.baseShape->furthestInDirectionFrom(dir, searchState) * dir);
+	}
+}
+
+
+static long long getLatestTallyTotal(HistoricTally<long long, IterationTime>& tally) {
+	tally.nextTally();
+	long long total = 0;
+	for(long long count : tally.history.front().values) {
+		total += count;
+	}
+	return total;
+}
+
+TEST_CASE(batchedGJKMatchesScalarGJK) {
+	const ShapeClass* classes[2]{&CubeClass::instance, &SphereClass::instance};
+	for(const ShapeClass* first : classes) {
+		for(const ShapeClass* second : classes) {
+			for(int iter = 0; iter < 50; iter++) {
+				GJKBatch batch(first, second);
+				// the float rotations of the batch don't convert back into valid double rotations, so the reference keeps its own
+				CFrame transforms[GJKBatch::SIZE];
+				DiagonalMat3 scalesFirst[GJKBatch::SIZE];
+				DiagonalMat3 scalesSecond[GJKBatch::SIZE];
+				int batchSize = generateInt(GJKBatch::SIZE) + 1;
+				for(int lane = 0; lane < batchSize; lane++) {
+					transforms[lane] = CFrame(Vec3(generateDouble(-2.5, 2.5), generateDouble(-2.5, 2.5), generateDouble(-2.5, 2.5)), generateRotation());
+					scalesFirst[lane] = DiagonalMat3{generateDouble(0.2, 1.5), generateDouble(0.2, 1.5), generateDouble(0.2, 1.5)};
+					scalesSecond[lane] = DiagonalMat3{generateDouble(0.2, 1.5), generateDouble(0.2, 1.5), generateDouble(0.2, 1.5)};
+					batch.add(CFramef(transforms[lane]), DiagonalMat3f(scalesFirst[lane]), DiagonalMat3f(scalesSecond[lane]));
+				}
+
+				std::optional<Tetrahedron> reference[GJKBatch::SIZE];
+				std::optional<Tetrahedron> batched[GJKBatch::SIZE];
+				GJKCollidesIterationStatistics.clearCurrentTally();
+				GJKNoCollidesIterationStatistics.clearCurrentTally();
+				runGJKBatchFallback(batch, reference);
+				long long referenceCollides = getLatestTallyTotal(GJKCollidesIterationStatistics);
+				long long referenceNoCollides = getLatestTallyTotal(GJKNoCollidesIterationStatistics);
+				runGJKBatch(batch, batched);
+				ASSERT_STRICT(getLatestTallyTotal(GJKCollidesIterationStatistics) == referenceCollides);
+				ASSERT_STRICT(getLatestTallyTotal(GJKNoCollidesIterationStatistics) == referenceNoCollides);
+
+				for(int lane = 0; lane < batch.size; lane++) {
+					ASSERT_STRICT(reference[lane].has_value() == batched[lane].has_value());
+					if(batched[lane]) {
+						std::optional<Intersection> expected = intersectsTransformed(*first, *second, transforms[lane], scalesFirst[lane], scalesSecond[lane], reference[lane].value());
+						std::optional<Intersection> actual = intersectsTransformed(*first, *second, transforms[lane], scalesFirst[lane], scalesSecond[lane], batched[lane].value());
+						ASSERT_STRICT(expected.has_value() == actual.has_value());
+						if(actual) {
+							ASSERT_TOLERANT(length(expected.value().exitVector) == length(actual.value().exitVector), 0.01);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE(closestPointsOfSeparatedBoxes) {
+	Shape box = boxShape(2.0, 2.0, 2.0);
+	std::optional<ClosestPoints> result = closestPointsTransformed(box, box, CFrame(3.5, 0.3, -0.2));
+
+	ASSERT_TRUE(result.has_value());
+	ASSERT_TOLERANT(result.value().onFirst.x == 1.0, 0.001);
+	ASSERT_TOLERANT(result.value().onSecond.x == 2.5, 0.001);
+	ASSERT_TOLERANT(length(result.value().onSecond - result.value().onFirst) == 1.5, 0.001);
+}
+
+TEST_CASE(closestPointsOfRotatedSpheres) {
+	Shape sphere = sphereShape(1.0);
+	Shape smallSphere = sphereShape(0.5);
+	Vec3 offset(2.0, -3.0, 1.5);
+	std::optional<ClosestPoints> result = closestPointsTransformed(sphere, smallSphere, CFrame(offset, Rotation::fromEulerAngles(0.3, 1.2, -0.7)));
+
+	ASSERT_TRUE(result.has_value());
+	ASSERT_TOLERANT(length(result.value().onSecond - result.value().onFirst) == length(offset) - 1.5, 0.01);
+	ASSERT_TOLERANT(result.value().onFirst == normalize(offset), 0.01);
+}
+
+TEST_CASE(closestPointsOfIntersectingBoxes) {
+	Shape box = boxShape(2.0, 2.0, 2.0);
+	ASSERT_FALSE(closestPointsTransformed(box, box, CFrame(1.5, 0.3, -0.2, Rotation::fromEulerAngles(0.2, 0.1, 0.4))).has_value());
+}
+
+TEST_CASE(triangleBVHMatchesBruteForce) {
+	Polyhedron sphere = ShapeLibrary::createSphere(1.0, 3);
+	TriangleBVH bvh(sphere);
+
+	for(int iter = 0; iter < 100; iter++) {
+		Vec3f center(generateFloat(-1.2f, 1.2f), generateFloat(-1.2f, 1.2f), generateFloat(-1.2f, 1.2f));
+		Vec3f halfSize(generateFloat(0.0f, 0.5f), generateFloat(0.0f, 0.5f), generateFloat(0.0f, 0.5f));
+		BoundingBoxTemplate<float> query(center - halfSize, center + halfSize);
+
+		std::vector<bool> found(sphere.triangleCount, false);
+		bvh.forEachTriangleInBounds(query, [&](int triangle) { found[triangle] = true; });
+
+		for(int i = 0; i < sphere.triangleCount; i++) {
+			Triangle t = sphere.getTriangle(i);
+			Vec3f a = sphere.getVertex(t.firstIndex);
+			BoundingBoxTemplate<float> triangleBounds = BoundingBoxTemplate<float>(a, a).expanded(sphere.getVertex(t.secondIndex)).expanded(sphere.getVertex(t.thirdIndex));
+			ASSERT_TRUE(found[i] || !triangleBounds.intersects(query));
+		}
+	}
+
+	for(int iter = 0; iter < 100; iter++) {
+		Vec3 origin = generateVec3() * 3.0;
+		Vec3 direction = generateVec3();
+		double reference = sphere.getIntersectionDistance(origin, direction);
+		double distance;
+		int triangle = bvh.getFirstIntersectedTriangle(sphere, origin, direction, distance);
+		if(reference == std::numeric_limits<double>::max()) {
+			ASSERT_TRUE(triangle == -1);
+		} else {
+			ASSERT_TRUE(triangle != -1);
+			ASSERT(distance == reference);
+		}
+	}
+}
+
+TEST_CASE(meshRaycastMatchesFallback) {
+	// the torus is large enough to be raycast through its BVH, the sphere is tested triangle by triangle
+	Polyhedron torus = ShapeLibrary::createTorus(1.0f, 0.3f, 48, 24);
+	Polyhedron sphere = ShapeLibrary::createSphere(1.0f, 1);
+	Polyhedron torusCopy = torus;
+
+	for(const Polyhedron* mesh : {&torus, &sphere, &torusCopy}) {
+		int hitCount = 0;
+		for(int iter = 0; iter < 300; iter++) {
+			Vec3 origin = generateVec3() * 3.0;
+			Vec3 direction = generateVec3() * 0.5 - origin;
+			double reference = mesh->getIntersectionDistanceFallback(origin, direction);
+			ASSERT_TRUE(mesh->getIntersectionDistance(origin, direction) == reference);
+			if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2 | CPUIDCheck::FMA)) {
+				ASSERT_TRUE(mesh->getIntersectionDistanceAVX(origin, direction) == reference);
+			}
+			if(reference != std::numeric_limits<double>::max()) hitCount++;
+		}
+		ASSERT_TRUE(hitCount > 0);
+	}
+}
+
+TEST_CASE(concaveMeshIgnoresItsConvexHull) {
+	// a valley with sloped sides going through the origin, its bounds center lies at (0, 1, 0)
+	Vec3f vertices[6]{Vec3f(-2.0f, 2.0f, -1.0f), Vec3f(-2.0f, 2.0f, 1.0f), Vec3f(0.0f, 0.0f, -1.0f), Vec3f(0.0f, 0.0f, 1.0f), Vec3f(2.0f, 2.0f, -1.0f), Vec3f(2.0f, 2.0f, 1.0f)};
+	Triangle triangles[4]{{0, 1, 2}, {1, 3, 2}, {2, 3, 4}, {3, 5, 4}};
+	Shape valley = triangleMeshShape(TriangleMesh(6, 4, vertices, triangles));
+	Shape box = boxShape(0.4, 0.4, 0.4);
+
+	// floating in the valley, inside the convex hull but away from the slopes
+	ASSERT_FALSE(intersectsTransformed(valley, box, CFrame(0.0, 0.2, 0.0)).has_value());
+	ASSERT_FALSE(intersectsTransformed(box, valley, CFrame(0.0, -0.2, 0.0)).has_value());
+
+	// resting on the bottom, the corners of the box dig into both slopes
+	std::optional<Intersection> result = intersectsTransformed(valley, box, CFrame(0.0, -0.85, 0.0));
+	ASSERT_TRUE(result.has_value());
+	ASSERT_TRUE(result.value().exitVector.y != 0.0);
+}
+
+TEST_CASE(concaveMeshClosestPointsIgnoreItsConvexHull) {
+	// the valley of concaveMeshIgnoresItsConvexHull, its slopes are the lines y = -x and y = x
+	Vec3f vertices[6]{Vec3f(-2.0f, 2.0f, -1.0f), Vec3f(-2.0f, 2.0f, 1.0f), Vec3f(0.0f, 0.0f, -1.0f), Vec3f(0.0f, 0.0f, 1.0f), Vec3f(2.0f, 2.0f, -1.0f), Vec3f(2.0f, 2.0f, 1.0f)};
+	Triangle triangles[4]{{0, 1, 2}, {1, 3, 2}, {2, 3, 4}, {3, 5, 4}};
+	Shape valley = triangleMeshShape(TriangleMesh(6, 4, vertices, triangles));
+	Shape sphere = sphereShape(0.2);
+
+	// floating in the valley, inside the convex hull, slightly closer to the right slope
+	Vec3 center(0.1, 0.8, 0.0);
+	double expectedDistance = (center.y - center.x) / std::sqrt(2.0) - 0.2;
+	CFrame sphereInValley(center - Vec3(0.0, 1.0, 0.0));
+	std::optional<ClosestPoints> result = closestPointsTransformed(valley, sphere, sphereInValley);
+	ASSERT_TRUE(result.has_value());
+	ASSERT_TOLERANT(length(result.value().onSecond - result.value().onFirst) == expectedDistance, 0.01);
+
+	std::optional<ClosestPoints> swapped = closestPointsTransformed(sphere, valley, ~sphereInValley);
+	ASSERT_TRUE(swapped.has_value());
+	ASSERT_TOLERANT(length(swapped.value().onSecond - swapped.value().onFirst) == expectedDistance, 0.01);
+	ASSERT_TRUE(swapped.value().onSecond.x > 0.0);
+
+	ASSERT_FALSE(closestPointsTransformed(valley, sphere, CFrame(0.7, -0.3, 0.0)).has_value());
+}
+
+TEST_CASE(flatMeshCollidesLikeBox) {
+	Vec3f vertices[4]{Vec3f(-2.0f, 0.0f, -2.0f), Vec3f(2.0f, 0.0f, -2.0f), Vec3f(2.0f, 0.0f, 2.0f), Vec3f(-2.0f, 0.0f, 2.0f)};
+	Triangle triangles[2]{{0, 3, 2}, {0, 2, 1}};
+	Shape floorMesh = triangleMeshShape(TriangleMesh(4, 2, vertices, triangles));
+	Shape floorBox = boxShape(4.0, 1.0, 4.0);
+	Shape box = boxShape(1.0, 1.0, 1.0);
+
+	CFrame boxOnMesh(0.3, 0.4, -0.2);
+	CFrame boxOnFloorBox(0.3, 0.9, -0.2);
+
+	std::optional<Intersection> meshResult = intersectsTransformed(floorMesh, box, boxOnMesh);
+	std::optional<Intersection> boxResult = intersectsTransformed(floorBox, box, boxOnFloorBox);
+	ASSERT_TRUE(meshResult.has_value() && boxResult.has_value());
+	ASSERT_TOLERANT(meshResult.value().exitVector == boxResult.value().exitVector, 0.01);
+
+	std::optional<Intersection> swappedMeshResult = intersectsTransformed(box, floorMesh, ~boxOnMesh);
+	std::optional<Intersection> swappedBoxResult = intersectsTransformed(box, floorBox, ~boxOnFloorBox);
+	ASSERT_TRUE(swappedMeshResult.has_value() && swappedBoxResult.has_value());
+	ASSERT_TOLERANT(swappedMeshResult.value().exitVector == swappedBoxResult.value().exitVector, 0.01);
+
+	ASSERT_FALSE(intersectsTransformed(floorMesh, box, CFrame(0.3, 0.6, -0.2)).has_value());
+}
+
+TEST_CASE(heightfieldMatchesItsPolyhedron) {
+	// 3x3 tiles, every other tile stays low so rays and queries skip it
+	const int sampleCountX = 41;
+	const int sampleCountZ = 37;
+	const int tileSize = HeightfieldShapeClass::TILE_SIZE;
+	std::vector<float> heights(sampleCountX * sampleCountZ);
+	for(int x = 0; x < sampleCountX; x++) {
+		for(int z = 0; z < sampleCountZ; z++) {
+			heights[x * sampleCountZ + z] = (x / tileSize + z / tileSize) % 2 == 0 ? generateFloat(-1.0f, 1.0f) : generateFloat(-1.0f, -0.5f);
+		}
+	}
+	HeightfieldShapeClass heightfield(sampleCountX, sampleCountZ, heights.data(), false);
+	Polyhedron solid = heightfield.asPolyhedron();
+
+	for(int iter = 0; iter < 50; iter++) {
+		Vec3f corner(generateFloat(-1.2f, 1.2f), generateFloat(-1.0f, 1.0f), generateFloat(-1.2f, 1.2f));
+		BoundingBoxTemplate<float> bounds(corner, corner + Vec3f(generateFloat(0.0f, 1.0f), generateFloat(0.0f, 0.5f), generateFloat(0.0f, 1.0f)));
+		int triangleCount = 0;
+		heightfield.forEachTriangleInBounds(bounds, [&](Vec3f, Vec3f, Vec3f) { triangleCount++; });
+
+		int expectedCount = 0;
+		for(int x = 0; x < sampleCountX - 1; x++) {
+			for(int z = 0; z < sampleCountZ - 1; z++) {
+				float maxHeight = std::max(std::max(heightfield.getHeight(x, z), heightfield.getHeight(x + 1, z)), std::max(heightfield.getHeight(x, z + 1), heightfield.getHeight(x + 1, z + 1)));
+				bool overlaps = heightfield.getSample(x + 1, z).x >= bounds.min.x && heightfield.getSample(x, z).x <= bounds.max.x && heightfield.getSample(x, z + 1).z >= bounds.min.z && heightfield.getSample(x, z).z <= bounds.max.z;
+				if(overlaps && maxHeight >= bounds.min.y && bounds.max.y >= -1.0f) expectedCount += 2;
+			}
+		}
+		ASSERT_TRUE(triangleCount == expectedCount);
+	}
+
+	for(int iter = 0; iter < 200; iter++) {
+		Vec3 origin(generateDouble(-1.5, 1.5), generateDouble(1.0, 2.0), generateDouble(-1.5, 1.5));
+		Vec3 direction(generateDouble(-1.0, 1.0), -1.0, generateDouble(-1.0, 1.0));
+		double reference = solid.getIntersectionDistance(origin, direction);
+		double distance = heightfield.getIntersectionDistance(origin, direction);
+		if(reference == std::numeric_limits<double>::max()) {
+			ASSERT_TRUE(distance == std::numeric_limits<double>::max());
+		} else {
+			ASSERT(distance == reference);
+		}
+	}
+
+	// from every side, so rays also enter through the walls and the bottom of the solid
+	for(int iter = 0; iter < 200; iter++) {
+		Vec3 origin = normalize(Vec3(generateDouble(-1.0, 1.0), generateDouble(-1.0, 1.0), generateDouble(-1.0, 1.0))) * 3.0;
+		Vec3 target(generateDouble(-1.0, 1.0), generateDouble(-1.0, 1.0), generateDouble(-1.0, 1.0));
+		Vec3 direction = target - origin;
+		double reference = solid.getIntersectionDistance(origin, direction);
+		double distance = heightfield.getIntersectionDistance(origin, direction);
+		if(reference == std::numeric_limits<double>::max()) {
+			ASSERT_TRUE(distance == std::numeric_limits<double>::max());
+		} else {
+			// the polyhedron intersects its triangles in floats, which grazing rays from the side notice
+			ASSERT_TOLERANT(distance == reference, 0.001);
+		}
+		ASSERT_TRUE(heightfield.containsPoint(target) == solid.containsPoint(Vec3f(target)));
+	}
+
+	for(int iter = 0; iter < 100; iter++) {
+		Vec3f direction = generateVec3f();
+		float bestDot = Vec3f(direction.x >= 0.0f ? 1.0f : -1.0f, -1.0f, direction.z >= 0.0f ? 1.0f : -1.0f) * direction;
+		for(Vec3f vertex : solid.iterVertices()) {
+			bestDot = std::max(bestDot, vertex * direction);
+		}
+		ASSERT(heightfield.furthestInDirection(direction) * direction == bestDot);
+	}
+
+	Rotation rotation = generateRotation();
+	DiagonalMat3 scale{2.0, 0.5, 3.0};
+	BoundingBox bounds = heightfield.getBounds(rotation, scale);
+	double maxRadiusSq = lengthSquared(scale * Vec3(1.0, 1.0, 1.0));
+	for(Vec3f vertex : solid.iterVertices()) {
+		ASSERT_TRUE(bounds.expanded(0.00001).containsPoint(rotation * (scale * Vec3(vertex))));
+		maxRadiusSq = std::max(maxRadiusSq, lengthSquared(scale * Vec3(vertex)));
+	}
+	ASSERT(heightfield.getScaledMaxRadiusSq(scale) == maxRadiusSq);
+}
+
+TEST_CASE(quantizedHeightfieldStaysClose) {
+	std::vector<float> heights(17 * 17);
+	for(float& height : heights) {
+		height = generateFloat(-1.0f, 1.0f);
+	}
+	HeightfieldShapeClass heightfield(17, 17, heights.data(), true);
+	ASSERT_TRUE(heightfield.isQuantized());
+	for(int x = 0; x < 17; x++) {
+		for(int z = 0; z < 17; z++) {
+			ASSERT_TOLERANT(heightfield.getHeight(x, z) == heights[x * 17 + z], 2.0f / 65535.0f);
+		}
+	}
+}
+
+TEST_CASE(flatHeightfieldCollidesLikeBox) {
+	std::vector<float> heights(9 * 9, 0.0f);
+	Shape terrain = heightfieldShape(9, 9, heights.data(), 0.5);
+	Shape floorBox = boxShape(4.0, 1.0, 4.0);
+	Shape box = boxShape(1.0, 1.0, 1.0);
+
+	std::optional<Intersection> terrainResult = intersectsTransformed(terrain, box, CFrame(0.3, 0.4, -0.2));
+	std::optional<Intersection> boxResult = intersectsTransformed(floorBox, box, CFrame(0.3, 0.9, -0.2));
+	ASSERT_TRUE(terrainResult.has_value() && boxResult.has_value());
+	ASSERT_TOLERANT(terrainResult.value().exitVector == boxResult.value().exitVector, 0.01);
+
+	ASSERT_FALSE(intersectsTransformed(terrain, box, CFrame(0.3, 0.6, -0.2)).has_value());
+	ASSERT_FALSE(intersectsTransformed(box, terrain, CFrame(5.0, 0.0, 0.0)).has_value());
+}
+
+static TriangleMesh twoSeparateBoxes() {
+	Polyhedron box = ShapeLibrary::createBox(1.0f, 1.0f, 1.0f);
+	std::vector<Vec3f> vertices;
+	std::vector<Triangle> triangles;
+	for(float offset : {-1.5f, 1.5f}) {
+		int firstVertex = static_cast<int>(vertices.size());
+		for(Vec3f vertex : box.iterVertices()) {
+			vertices.push_back(vertex + Vec3f(offset, 0.0f, 0.0f));
+		}
+		for(Triangle triangle : box.iterTriangles()) {
+			triangles.push_back(Triangle{triangle[0] + firstVertex, triangle[1] + firstVertex, triangle[2] + firstVertex});
+		}
+	}
+	return TriangleMesh(static_cast<int>(vertices.size()), static_cast<int>(triangles.size()), vertices.data(), triangles.data());
+}
+
+TEST_CASE(convexDecompositionOfConvexMeshIsOneHull) {
+	std::vector<Polyhedron> hulls = decomposeConvex(ShapeLibrary::createBox(2.0f, 1.0f, 3.0f));
+	ASSERT_STRICT(hulls.size() == 1);
+	ASSERT_TOLERANT(hulls[0].getVolume() == 6.0, 0.01);
+}
+
+TEST_CASE(convexDecompositionSeparatesPieces) {
+	ConvexDecompositionSettings settings;
+	settings.maxVerticesPerHull = 12;
+	std::vector<Polyhedron> hulls = decomposeConvex(twoSeparateBoxes(), settings);
+
+	ASSERT_TRUE(hulls.size() >= 2 && hulls.size() <= static_cast<std::size_t>(settings.maxHullCount));
+	double totalVolume = 0.0;
+	for(const Polyhedron& hull : hulls) {
+		ASSERT_TRUE(hull.vertexCount <= settings.maxVerticesPerHull);
+		totalVolume += hull.getVolume();
+	}
+	// the hull of both boxes together would be twice as large
+	ASSERT_TOLERANT(totalVolume == 2.0, 0.1);
+
+	ConvexPieces pieces = toConvexPieces(hulls);
+	ASSERT_STRICT(pieces.shapes.size() == hulls.size());
+	for(std::size_t i = 0; i < hulls.size(); i++) {
+		ASSERT_TOLERANT(pieces.shapes[i].getVolume() == hulls[i].getVolume(), 0.001);
+		ASSERT_TRUE(std::abs(std::abs(pieces.offsets[i].x) - 1.5) < 0.1);
+	}
+}
+
+// a U, 3 wide and 3 high with a 1 wide notch from the top down to y=1, from z=-0.5 to z=0.5
+static TriangleMesh uShapedMesh() {
+	Vec2f outline[8]{Vec2f(0.0f, 0.0f), Vec2f(3.0f, 0.0f), Vec2f(3.0f, 3.0f), Vec2f(2.0f, 3.0f), Vec2f(2.0f, 1.0f), Vec2f(1.0f, 1.0f), Vec2f(1.0f, 3.0f), Vec2f(0.0f, 3.0f)};
+	// counterclockwise, like the outline
+	Triangle cap[6]{{6, 7, 0}, {6, 0, 5}, {5, 0, 1}, {5, 1, 4}, {4, 1, 2}, {4, 2, 3}};
+
+	std::vector<Vec3f> vertices;
+	for(Vec2f point : outline) vertices.push_back(Vec3f(point.x, point.y, -0.5f));
+	for(Vec2f point : outline) vertices.push_back(Vec3f(point.x, point.y, 0.5f));
+	std::vector<Triangle> triangles;
+	for(Triangle triangle : cap) {
+		triangles.push_back(Triangle{triangle[0] + 8, triangle[1] + 8, triangle[2] + 8});
+		triangles.push_back(Triangle{triangle[0], triangle[2], triangle[1]});
+	}
+	for(int i = 0; i < 8; i++) {
+		int next = (i + 1) % 8;
+		triangles.push_back(Triangle{i, next, next + 8});
+		triangles.push_back(Triangle{i, next + 8, i + 8});
+	}
+	return TriangleMesh(static_cast<int>(vertices.size()), static_cast<int>(triangles.size()), vertices.data(), triangles.data());
+}
+
+TEST_CASE(convexDecompositionOfConcaveMeshFollowsItsShape) {
+	std::vector<Polyhedron> hulls = decomposeConvex(uShapedMesh());
+	ASSERT_TRUE(hulls.size() >= 2 && hulls.size() <= static_cast<std::size_t>(ConvexDecompositionSettings().maxHullCount));
+
+	// the hull of the whole U would have a volume of 9
+	double totalVolume = 0.0;
+	for(const Polyhedron& hull : hulls) {
+		totalVolume += hull.getVolume();
+	}
+	ASSERT_TOLERANT(totalVolume == 7.0, 0.5);
+
+	// points well inside the U are covered, points in the notch are not, and few points are in more than one piece
+	int overlappingPoints = 0;
+	for(int iter = 0; iter < 2000; iter++) {
+		Vec3f point(generateFloat(0.1f, 2.9f), generateFloat(0.1f, 2.9f), generateFloat(-0.4f, 0.4f));
+		bool inNotch = point.x > 1.0f && point.x < 2.0f && point.y > 1.0f;
+		if(inNotch && (point.x < 1.1f || point.x > 1.9f || point.y < 1.1f)) continue;
+
+		int containingHulls = 0;
+		for(const Polyhedron& hull : hulls) {
+			if(hull.containsPoint(point)) containingHulls++;
+		}
+		if(inNotch) {
+			ASSERT_TRUE(containingHulls == 0);
+		} else {
+			ASSERT_TRUE(containingHulls >= 1);
+			if(containingHulls > 1) overlappingPoints++;
+		}
+	}
+	ASSERT_TRUE(overlappingPoints < 100);
+}
+
+TEST_CASE(convexPartsFormOneRigidBody) {
+	ConvexPieces pieces = toConvexPieces(decomposeConvex(uShapedMesh()));
+	GlobalCFrame cframe(10.0, 2.0, -3.0);
+	std::vector<Part*> parts = createConvexParts(pieces, cframe, PartProperties{1.0, 0.5, 0.3});
+	ASSERT_STRICT(parts.size() == pieces.shapes.size());
+
+	WorldPrototype world(0.01);
+	world.addPart(parts[0]);
+	double totalMass = 0.0;
+	for(std::size_t i = 0; i < parts.size(); i++) {
+		ASSERT_TRUE(parts[i]->getMainPhysical() == parts[0]->getMainPhysical());
+		ASSERT_TRUE(parts[i]->layer != nullptr);
+		ASSERT(Vec3(parts[i]->getPosition() - cframe.getPosition()) == pieces.offsets[i]);
+		totalMass += parts[i]->getMass();
+	}
+	ASSERT_TOLERANT(totalMass == 7.0, 0.5);
+	world.clear();
+}
+
+static std::vector<Vec3f> generatePointsInSphere(int count) {
+	std::vector<Vec3f> points;
+	while(static_cast<int>(points.size()) < count) {
+		Vec3f point(generateFloat(-1.0f, 1.0f), generateFloat(-1.0f, 1.0f), generateFloat(-1.0f, 1.0f));
+		if(lengthSquared(point) <= 1.0f) points.push_back(point);
+	}
+	return points;
+}
+
+static bool hullContainsPoints(const Polyhedron& hull, const std::vector<Vec3f>& points, float tolerance) {
+	for(Triangle triangle : hull.iterTriangles()) {
+		Vec3f v0 = hull.getVertex(triangle.firstIndex);
+		Vec3f normal = normalize(hull.getNormalVecOfTriangle(triangle));
+		for(Vec3f point : points) {
+			if((point - v0) * normal > tolerance) return false;
+		}
+	}
+	return true;
+}
+
+TEST_CASE(quickhullContainsAllPoints) {
+	std::vector<Vec3f> points = generatePointsInSphere(5000);
+	Polyhedron hull = quickhull(points.data(), static_cast<int>(points.size()));
+
+	ASSERT_TRUE(hull.vertexCount >= 4);
+	ASSERT_TRUE(hull.triangleCount == 2 * hull.vertexCount - 4);
+	ASSERT_TRUE(hullContainsPoints(hull, points, 0.0001f));
+	ASSERT_TRUE(hull.getVolume() > 0.0 && hull.getVolume() < 4.0 / 3.0 * PI);
+}
+
+TEST_CASE(quickhullMergesCoplanarFaces) {
+	// a grid of points on every face of a box, only the corners are real vertices
+	std::vector<Vec3f> points;
+	for(int face = 0; face < 6; face++) {
+		int axis = face / 2;
+		float side = (face % 2 == 0) ? -1.0f : 1.0f;
+		for(int i = 0; i <= 10; i++) {
+			for(int j = 0; j <= 10; j++) {
+				Vec3f point;
+				point[axis] = side;
+				point[(axis + 1) % 3] = i / 5.0f - 1.0f;
+				point[(axis + 2) % 3] = j / 5.0f - 1.0f;
+				points.push_back(point);
+			}
+		}
+	}
+	Polyhedron hull = quickhull(points.data(), static_cast<int>(points.size()));
+
+	ASSERT_STRICT(hull.vertexCount == 8);
+	ASSERT_STRICT(hull.triangleCount == 12);
+	ASSERT(hull.getVolume() == 8.0);
+}
+
+TEST_CASE(quickhullRespectsVertexCap) {
+	std::vector<Vec3f> points = generatePointsInSphere(2000);
+	QuickhullSettings settings;
+	settings.maxVertices = 20;
+	Polyhedron hull = quickhull(points.data(), static_cast<int>(points.size()), settings);
+
+	ASSERT_TRUE(hull.vertexCount >= 4 && hull.vertexCount <= 20);
+	for(Vec3f vertex : hull.iterVertices()) {
+		ASSERT_TRUE(std::find(points.begin(), points.end(), vertex) != points.end());
+	}
+}
+
+TEST_CASE(parallelQuickhullMatchesSequential) {
+	std::vector<Vec3f> points = generatePointsInSphere(100000);
+	ThreadPool threadPool(4);
+	Polyhedron sequential = quickhull(points.data(), static_cast<int>(points.size()));
+	Polyhedron parallel = quickhull(points.data(), static_cast<int>(points.size()), threadPool);
+
+	ASSERT_STRICT(parallel.vertexCount == sequential.vertexCount);
+	ASSERT_STRICT(parallel.triangleCount == sequential.triangleCount);
+	ASSERT(parallel.getVolume() == sequential.getVolume());
+}
+
+TEST_CASE(quickhullOfFlatPointsIsEmpty) {
+	std::vector<Vec3f> points{Vec3f(0.0f, 0.0f, 0.0f), Vec3f(1.0f, 0.0f, 0.0f), Vec3f(0.0f, 1.0f, 0.0f), Vec3f(1.0f, 1.0f, 0.0f), Vec3f(0.5f, 0.5f, 0.0f)};
+	Polyhedron hull = quickhull(points.data(), static_cast<int>(points.size()));
+
+	ASSERT_STRICT(hull.vertexCount == 0);
+}
+
+TEST_CASE(collisionLODEnclosesPolyhedron) {
+	Shape sphere = polyhedronShape(ShapeLibrary::createSphere(1.0, 4));
+	const Polyhedron* collisionLOD = static_cast<const PolyhedronShapeClass*>(sphere.baseShape.get())->getCollisionLOD();
+	ASSERT_TRUE(collisionLOD != nullptr);
+	ASSERT_TRUE(collisionLOD->vertexCount <= 32);
+
+	Polyhedron reference = sphere.baseShape->asPolyhedron();
+	std::vector<Vec3f> vertices;
+	for(Vec3f vertex : reference.iterVertices()) {
+		vertices.push_back(vertex);
+	}
+	ASSERT_TRUE(hullContainsPoints(*collisionLOD, vertices, 0.00001f));
+
+	for(int iter = 0; iter < 20; iter++) {
+		Rotation rotation = generateRotation();
+		BoundingBox exact = reference.getBounds(Mat3f(rotation.asRotationMatrix() * sphere.scale));
+		BoundingBox coarse = sphere.baseShape->getBounds(rotation, sphere.scale);
+		ASSERT_TRUE(coarse.containsPoint(exact.min) && coarse.containsPoint(exact.max));
+	}
+
+	Shape smallPolyhedron = polyhedronShape(ShapeLibrary::createSphere(1.0, 1));
+	ASSERT_TRUE(static_cast<const PolyhedronShapeClass*>(smallPolyhedron.baseShape.get())->getCollisionLOD() == nullptr);
+}
+
+TEST_CASE(collisionLODKeepsIntersectionResults) {
+	Shape sphere = polyhedronShape(ShapeLibrary::createSphere(1.0, 4));
+	Shape box = boxShape(1.0, 1.0, 1.0);
+	for(int iter = 0; iter < 200; iter++) {
+		Vec3 offset = normalize(generateVec3()) * generateDouble(1.2, 2.2);
+		CFrame relativeTransform(offset, generateRotation());
+
+		bool withLOD = intersectsTransformed(sphere, box, relativeTransform).has_value();
+		bool withoutLOD = intersectsTransformed(*sphere.baseShape, *box.baseShape, relativeTransform, sphere.scale, box.scale).has_value();
+		ASSERT_STRICT(withLOD == withoutLOD);
+	}
+}
@@ -6,6 +6,9 @@
 #include "generators.h"
 
 #include <Physics3D/world.h>
+#include <Physics3D/worldPhysics.h>
+#include <Physics3D/midphase.h>
+#include <Physics3D/threading/threadPool.h>
 #include <Physics3D/inertia.h>
 #include <Physics3D/math/linalg/trigonometry.h>
 #include <Physics3D/math/linalg/eigen.h>
@@ -17,8 +20,22 @@
 #include <Physics3D/hardconstraints/motorConstraint.h>
 #include <Physics3D/hardconstraints/sinusoidalPistonConstraint.h>
 #include <Physics3D/hardconstraints/fixedConstraint.h>
+#include <Physics3D/misc/cpuid.h>
+#include <Physics3D/misc/physicsProfiler.h>
+#include <Physics3D/misc/latencyHistogram.h>
+#include <Physics3D/misc/hardwareCounters.h>
+#include <Physics3D/misc/allocationTracker.h>
+#include <Physics3D/misc/serialization/serialization.h>
+#include <Physics3D/misc/serialization/worldRecording.h>
+#include <Physics3D/externalforces/magnetForce.h>
+#include <Physics3D/misc/tickTracer.h>
 #include "../util/log.h"
 
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+
 
 using namespace P3D;
 #define REMAINS_CONSTANT(v) REMAINS_CONSTANT_TOLERANT(v, 0.0005)
@@ -820,6 +837,93 @@ TEST_CASE(motorizedPhysicalAngularMomentum) {
 	ASSERT(motorPhys->getTotalAngularMomentum() == getTotalAngularMomentumOfPhysical(motorPhys));
 }
 
+TEST_CASE(subtreePropertiesMatchCOMMotionTree) {
+	std::vector<Part> phys = produceMotorizedPhysical();
+	MotorizedPhysical* motorPhys = phys[0].getMainPhysical();
+
+	for(int i = 0; i < 5; i++) {
+		motorPhys->update(0.05);
+
+		ALLOCA_COMMotionTree(t, motorPhys, size);
+
+		ASSERT(motorPhys->subtree.mass == t.totalMass);
+		ASSERT(motorPhys->subtree.centerOfMass == t.centerOfMass);
+		ASSERT(motorPhys->subtree.motionOfCenterOfMass.getVelocity() == t.motionOfCenterOfMass.getVelocity());
+		ASSERT(motorPhys->subtree.motionOfCenterOfMass.getAcceleration() == t.motionOfCenterOfMass.getAcceleration());
+		ASSERT(motorPhys->subtree.inertia == t.getInertia());
+		ASSERT(motorPhys->subtree.internalAngularMomentum == t.getInternalAngularMomentum());
+	}
+}
+
+TEST_CASE(incrementalSubtreeRefreshMatchesCOMMotionTree) {
+	std::vector<Part> result;
+	result.reserve(10);
+	Part& mainPart = result.emplace_back(boxShape(1.0, 2.0, 0.5), GlobalCFrame(), basicProperties);
+
+	mainPart.ensureHasPhysical();
+
+	Part& weldedPart = result.emplace_back(polyhedronShape(ShapeLibrary::house), mainPart,
+										   new FixedConstraint(),
+										   CFrame(0.3, 0.7, -0.5, Rotation::fromEulerAngles(0.7, 0.3, 0.7)),
+										   CFrame(0.1, 0.2, -0.5, Rotation::fromEulerAngles(0.2, -0.257, 0.4)), basicProperties);
+	Part& motorPart = result.emplace_back(boxShape(1.0, 0.3, 2.0), weldedPart,
+										  new MotorConstraintTemplate<ConstantMotorTurner>(1.7),
+										  CFrame(-0.3, 0.7, 0.5, Rotation::fromEulerAngles(0.7, 0.3, 0.7)),
+										  CFrame(0.1, -0.2, -0.5, Rotation::fromEulerAngles(0.2, -0.257, 0.4)), basicProperties);
+
+	MotorizedPhysical* motorPhys = mainPart.getMainPhysical();
+
+	for(int i = 0; i < 3; i++) {
+		motorPhys->update(0.05);
+
+		ASSERT_FALSE(motorPhys->subtreeIsDirty);
+		ALLOCA_COMMotionTree(t, motorPhys, size);
+		ASSERT(motorPhys->subtree.centerOfMass == t.centerOfMass);
+		ASSERT(motorPhys->subtree.inertia == t.getInertia());
+		ASSERT(motorPhys->subtree.internalAngularMomentum == t.getInternalAngularMomentum());
+	}
+
+	double oldMass = motorPhys->totalMass;
+	weldedPart.setWidth(3.0);
+	ASSERT_FALSE(motorPhys->subtreeIsDirty);
+	ASSERT(motorPhys->totalMass == mainPart.getMass() + weldedPart.getMass() + motorPart.getMass());
+	ASSERT_TRUE(motorPhys->totalMass != oldMass);
+
+	ALLOCA_COMMotionTree(t, motorPhys, size);
+	ASSERT(motorPhys->subtree.centerOfMass == t.centerOfMass);
+	ASSERT(motorPhys->subtree.inertia == t.getInertia());
+}
+
+TEST_CASE(changedAttachmentRefreshesSubtreeProperties) {
+	std::vector<Part> result;
+	result.reserve(10);
+	Part& mainPart = result.emplace_back(boxShape(1.0, 2.0, 0.5), GlobalCFrame(), basicProperties);
+
+	mainPart.ensureHasPhysical();
+
+	Part& childMainPart = result.emplace_back(boxShape(1.0, 0.3, 2.0), mainPart,
+											  new MotorConstraintTemplate<ConstantMotorTurner>(1.7),
+											  CFrame(-0.3, 0.7, 0.5, Rotation::fromEulerAngles(0.7, 0.3, 0.7)),
+											  CFrame(0.1, -0.2, -0.5, Rotation::fromEulerAngles(0.2, -0.257, 0.4)), basicProperties);
+	Part& attachedPart = result.emplace_back(boxShape(0.5, 0.5, 3.0), childMainPart, CFrame(0.0, 1.0, 0.0), basicProperties);
+
+	MotorizedPhysical* motorPhys = mainPart.getMainPhysical();
+	motorPhys->update(0.05);
+	ASSERT_FALSE(motorPhys->subtreeIsDirty);
+	Vec3 oldCenterOfMass = motorPhys->totalCenterOfMass;
+
+	childMainPart.getPhysical()->setAttachFor(&attachedPart, CFrame(2.0, -1.0, 0.5, Rotation::fromEulerAngles(0.3, 0.0, 0.2)));
+
+	ASSERT_FALSE(motorPhys->subtreeIsDirty);
+	ASSERT_TRUE(motorPhys->totalCenterOfMass != oldCenterOfMass);
+	ASSERT(attachedPart.getCFrame() == childMainPart.getCFrame().localToGlobal(attachedPart.getAttachToMainPart()));
+
+	ALLOCA_COMMotionTree(t, motorPhys, size);
+	ASSERT(motorPhys->subtree.mass == t.totalMass);
+	ASSERT(motorPhys->subtree.centerOfMass == t.centerOfMass);
+	ASSERT(motorPhys->subtree.inertia == t.getInertia());
+}
+
 TEST_CASE(physicalTotalAngularMomentum) {
 	std::vector<Part> phys = producePhysical();
 	MotorizedPhysical* motorPhys = phys[0].getMainPhysical();
@@ -1032,3 +1136,579 @@ TEST_CASE(setVelocity) {
 		}
 	}
 }
+
+static void buildBoxPile(WorldPrototype& world, std::vector<Part>& parts, Part& floor) {
+	for(int x = 0; x < 4; x++) {
+		for(int y = 0; y < 4; y++) {
+			for(int z = 0; z < 4; z++) {
+				parts.emplace_back(boxShape(1.0, 1.0, 1.0), GlobalCFrame(x * 0.95, y * 0.95 + 0.45, z * 0.95, Rotation::fromEulerAngles(0.01 * x, 0.02 * y, 0.03 * z)), basicProperties);
+			}
+		}
+	}
+	for(Part& p : parts) {
+		world.addPart(&p);
+	}
+	world.addTerrainPart(&floor);
+}
+
+TEST_CASE(colouredColissionBatchesAreDisjoint) {
+	WorldPrototype world(DELTA_T);
+	std::vector<Part> parts;
+	parts.reserve(64);
+	Part floor(boxShape(20.0, 1.0, 20.0), GlobalCFrame(0.0, -0.5, 0.0), basicProperties);
+	buildBoxPile(world, parts, floor);
+
+	findColissions(world, world.curColissions);
+	colourColissions(world.curColissions);
+
+	const ColissionBuffer& buf = world.curColissions;
+	ASSERT_TRUE(buf.freePartColissions.size() > 0);
+	ASSERT_STRICT(buf.colouredColissions.size() == buf.freePartColissions.size() + buf.freeTerrainColissions.size());
+
+	for(std::size_t batch = 0; batch < buf.getColourBatchCount(); batch++) {
+		std::vector<const MotorizedPhysical*> touched;
+		for(std::size_t i = buf.colourBatchStarts[batch]; i < buf.colourBatchStarts[batch + 1]; i++) {
+			const ColouredColission& c = buf.colouredColissions[i];
+			touched.push_back(c.colission->p1->getMainPhysical());
+			if(!c.isTerrain) touched.push_back(c.colission->p2->getMainPhysical());
+		}
+		std::sort(touched.begin(), touched.end());
+		ASSERT_TRUE(std::adjacent_find(touched.begin(), touched.end()) == touched.end());
+	}
+}
+
+TEST_CASE(parallelColissionHandlingMatchesSequential) {
+	WorldPrototype sequentialWorld(DELTA_T);
+	WorldPrototype parallelWorld(DELTA_T);
+	std::vector<Part> sequentialParts;
+	std::vector<Part> parallelParts;
+	sequentialParts.reserve(64);
+	parallelParts.reserve(64);
+	Part sequentialFloor(boxShape(20.0, 1.0, 20.0), GlobalCFrame(0.0, -0.5, 0.0), basicProperties);
+	Part parallelFloor(boxShape(20.0, 1.0, 20.0), GlobalCFrame(0.0, -0.5, 0.0), basicProperties);
+	buildBoxPile(sequentialWorld, sequentialParts, sequentialFloor);
+	buildBoxPile(parallelWorld, parallelParts, parallelFloor);
+
+	ThreadPool pool(4);
+	for(int tick = 0; tick < 20; tick++) {
+		findColissions(sequentialWorld, sequentialWorld.curColissions);
+		findColissions(parallelWorld, parallelWorld.curColissions);
+
+		handleColissions(sequentialWorld.curColissions);
+		handleColissionsParallel(parallelWorld.curColissions, pool);
+
+		for(std::size_t i = 0; i < sequentialParts.size(); i++) {
+			const MotorizedPhysical* a = sequentialParts[i].getMainPhysical();
+			const MotorizedPhysical* b = parallelParts[i].getMainPhysical();
+			ASSERT_STRICT(a->totalForce == b->totalForce);
+			ASSERT_STRICT(a->totalMoment == b->totalMoment);
+			ASSERT_STRICT(a->motionOfCenterOfMass.getVelocity() == b->motionOfCenterOfMass.getVelocity());
+			ASSERT_STRICT(a->motionOfCenterOfMass.getAngularVelocity() == b->motionOfCenterOfMass.getAngularVelocity());
+		}
+
+		update(sequentialWorld);
+		update(parallelWorld);
+	}
+}
+
+TEST_CASE(calmWorldSubStepsMatchesRegularTick) {
+	WorldPrototype regularWorld(DELTA_T);
+	WorldPrototype subSteppedWorld(DELTA_T);
+	subSteppedWorld.adaptiveSubStepping = true;
+	DirectionalGravity gravity(Vec3(0.0, -10.0, 0.0));
+	regularWorld.addExternalForce(&gravity);
+	subSteppedWorld.addExternalForce(&gravity);
+
+	std::vector<Part> regularParts;
+	std::vector<Part> subSteppedParts;
+	regularParts.reserve(64);
+	subSteppedParts.reserve(64);
+	Part regularFloor(boxShape(20.0, 1.0, 20.0), GlobalCFrame(0.0, -0.5, 0.0), basicProperties);
+	Part subSteppedFloor(boxShape(20.0, 1.0, 20.0), GlobalCFrame(0.0, -0.5, 0.0), basicProperties);
+	buildBoxPile(regularWorld, regularParts, regularFloor);
+	buildBoxPile(subSteppedWorld, subSteppedParts, subSteppedFloor);
+
+	for(int i = 0; i < 10; i++) {
+		regularWorld.tick();
+		subSteppedWorld.tick();
+	}
+
+	for(std::size_t i = 0; i < regularParts.size(); i++) {
+		ASSERT(regularParts[i].getCFrame() == subSteppedParts[i].getCFrame());
+	}
+}
+
+TEST_CASE(fastPartIsSubStepped) {
+	WorldPrototype world(0.05);
+	WorldPrototype referenceWorld(0.05);
+	world.adaptiveSubStepping = true;
+	world.maxSubSteps = 16;
+	DirectionalGravity gravity(Vec3(0.0, -10.0, 0.0));
+	world.addExternalForce(&gravity);
+	referenceWorld.addExternalForce(&gravity);
+
+	Part calmPart(boxShape(1.0, 1.0, 1.0), GlobalCFrame(-5.0, 3.0, 0.0), basicProperties);
+	Part fastPart(boxShape(0.2, 0.2, 0.2), GlobalCFrame(5.0, 3.0, 0.0), basicProperties);
+	Part referencePart(boxShape(0.2, 0.2, 0.2), GlobalCFrame(5.0, 3.0, 0.0), basicProperties);
+	world.addPart(&calmPart);
+	world.addPart(&fastPart);
+	referenceWorld.addPart(&referencePart);
+	fastPart.setVelocity(Vec3(20.0, 5.0, 0.0));
+	referencePart.setVelocity(Vec3(20.0, 5.0, 0.0));
+
+	ASSERT_STRICT(getRequiredSubSteps(world, *calmPart.getMainPhysical()) == 1);
+	ASSERT_TRUE(getRequiredSubSteps(world, *fastPart.getMainPhysical()) > 1);
+
+	// the fast part should move exactly as if the whole world ran at the smaller timestep
+	for(int i = 0; i < 4; i++) {
+		int subSteps = getRequiredSubSteps(world, *fastPart.getMainPhysical());
+		referenceWorld.deltaT = world.deltaT / subSteps;
+		for(int step = 0; step < subSteps; step++) {
+			referenceWorld.tick();
+		}
+		world.tick();
+
+		ASSERT(fastPart.getCFrame() == referencePart.getCFrame());
+		ASSERT(fastPart.getVelocity() == referencePart.getVelocity());
+	}
+}
+
+TEST_CASE(speculativeContactsPreventTunnelling) {
+	WorldPrototype tunnellingWorld(0.05);
+	WorldPrototype speculativeWorld(0.05);
+	speculativeWorld.speculativeContacts = true;
+
+	Part tunnellingWall(boxShape(0.1, 10.0, 10.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	Part speculativeWall(boxShape(0.1, 10.0, 10.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	Part tunnellingProjectile(boxShape(0.2, 0.2, 0.2), GlobalCFrame(-2.0, 0.0, 0.0), basicProperties);
+	Part speculativeProjectile(boxShape(0.2, 0.2, 0.2), GlobalCFrame(-2.0, 0.0, 0.0), basicProperties);
+	tunnellingWorld.addTerrainPart(&tunnellingWall);
+	speculativeWorld.addTerrainPart(&speculativeWall);
+	tunnellingWorld.addPart(&tunnellingProjectile);
+	speculativeWorld.addPart(&speculativeProjectile);
+	tunnellingProjectile.setVelocity(Vec3(100.0, 0.0, 0.0));
+	speculativeProjectile.setVelocity(Vec3(100.0, 0.0, 0.0));
+
+	ASSERT_TRUE(isFastPart(speculativeWorld, speculativeProjectile));
+
+	for(int i = 0; i < 10; i++) {
+		tunnellingWorld.tick();
+		speculativeWorld.tick();
+	}
+
+	ASSERT_TRUE(tunnellingProjectile.getPosition().x > 0.0);
+	ASSERT_TRUE(speculativeProjectile.getPosition().x < 0.0);
+}
+
+TEST_CASE(speculativeContactsDeflectOffConcaveMeshSlope) {
+	WorldPrototype world(0.05);
+	world.speculativeContacts = true;
+
+	// a valley with its slopes along y = -x and y = x, the convex hull of the mesh covers the whole valley
+	Vec3f vertices[6]{Vec3f(-2.0f, 2.0f, -3.0f), Vec3f(-2.0f, 2.0f, 3.0f), Vec3f(0.0f, 0.0f, -3.0f), Vec3f(0.0f, 0.0f, 3.0f), Vec3f(2.0f, 2.0f, -3.0f), Vec3f(2.0f, 2.0f, 3.0f)};
+	Triangle triangles[4]{{0, 1, 2}, {1, 3, 2}, {2, 3, 4}, {3, 5, 4}};
+	Part valley(triangleMeshShape(TriangleMesh(6, 4, vertices, triangles)), GlobalCFrame(0.0, 1.0, 0.0), basicProperties);
+	// nearer to the right slope, which it flies straight into
+	Part projectile(sphereShape(0.2), GlobalCFrame(0.1, 0.8, 0.0), basicProperties);
+	world.addTerrainPart(&valley);
+	world.addPart(&projectile);
+	projectile.setVelocity(Vec3(100.0, 0.0, 0.0));
+
+	ASSERT_TRUE(isFastPart(world, projectile));
+	ASSERT_TRUE(projectile.getSeparation(valley).separated);
+
+	world.tick();
+
+	// without the contact it would come out under the rim of the valley, at (5.1, 0.8)
+	ASSERT_TRUE(projectile.getMotion().getVelocity().y > 0.0);
+	ASSERT_TRUE(projectile.getPosition().y > 2.0);
+}
+
+TEST_CASE(midphaseNeverRejectsIntersectingParts) {
+	std::vector<std::unique_ptr<Part>> parts;
+	for(int i = 0; i < 30; i++) {
+		Position pos(generateDouble(-3.0, 3.0), generateDouble(-3.0, 3.0), generateDouble(-3.0, 3.0));
+		Shape shape = boxShape(generateDouble(0.2, 3.0), generateDouble(0.2, 3.0), generateDouble(0.2, 3.0));
+		parts.push_back(std::make_unique<Part>(shape, GlobalCFrame(pos, generateRotation()), basicProperties));
+	}
+	std::vector<Colission> colissions;
+	for(std::size_t i = 0; i < parts.size(); i++) {
+		for(std::size_t j = i + 1; j < parts.size(); j++) {
+			colissions.push_back(Colission{parts[i].get(), parts[j].get()});
+		}
+	}
+
+	MidphaseBuffer buffer;
+	buffer.gather(colissions);
+	runMidphaseTestsFallback(buffer);
+	std::vector<MidphaseResult> fallbackResults(buffer.results.begin(), buffer.results.begin() + buffer.size);
+
+	if(CPUIDCheck::hasTechnology(CPUIDCheck::AVX | CPUIDCheck::AVX2 | CPUIDCheck::FMA)) {
+		runMidphaseTestsAVX(buffer);
+		for(std::size_t i = 0; i < buffer.size; i++) {
+			ASSERT_TRUE(buffer.results[i] == fallbackResults[i]);
+		}
+	}
+
+	int boundsRejects = 0;
+	for(std::size_t i = 0; i < colissions.size(); i++) {
+		if(colissions[i].p1->intersects(*colissions[i].p2).intersects) {
+			ASSERT_TRUE(fallbackResults[i] == MidphaseResult::PASS);
+		}
+		if(fallbackResults[i] == MidphaseResult::BOUNDS_REJECT) boundsRejects++;
+	}
+	ASSERT_TRUE(boundsRejects > 0);
+
+	std::size_t passCount = std::count(fallbackResults.begin(), fallbackResults.end(), MidphaseResult::PASS);
+	filterColissionsMidphase(colissions);
+	ASSERT_STRICT(colissions.size() == passCount);
+}
+
+TEST_CASE(contactCacheReusesOnlyUnmovedPairs) {
+	ContactCache cache;
+	Part a(boxShape(1.0, 1.0, 1.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	Part b(boxShape(1.0, 1.0, 1.0), GlobalCFrame(0.9, 0.1, 0.0, Rotation::fromEulerAngles(0.1, 0.2, 0.3)), basicProperties);
+	PartIntersection result = a.intersects(b);
+	ASSERT_TRUE(result.intersects);
+
+	cache.storeColissions(std::vector<Colission>{Colission{&a, &b, result.intersection, result.exitVector}}, 0);
+
+	std::vector<Colission> toRefine{Colission{&a, &b}};
+	std::vector<Colission> reused;
+	cache.takeReusableColissions(toRefine, reused, 0.001, 1);
+	ASSERT_STRICT(toRefine.size() == 0);
+	ASSERT_STRICT(reused.size() == 1);
+	ASSERT(reused[0].intersection == result.intersection);
+	ASSERT(reused[0].exitVector == result.exitVector);
+	cache.removeStaleEntries(1);
+	ASSERT_STRICT(cache.size() == 1);
+
+	b.translate(Vec3(0.01, 0.0, 0.0));
+	toRefine = std::vector<Colission>{Colission{&a, &b}};
+	reused.clear();
+	cache.takeReusableColissions(toRefine, reused, 0.001, 2);
+	ASSERT_STRICT(toRefine.size() == 1);
+	ASSERT_STRICT(reused.size() == 0);
+	cache.removeStaleEntries(2);
+	ASSERT_STRICT(cache.size() == 0);
+}
+
+TEST_CASE(contactCacheForgetsOnlyPairsOfPart) {
+	ContactCache cache;
+	Part a(boxShape(1.0, 1.0, 1.0), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	Part b(boxShape(1.0, 1.0, 1.0), GlobalCFrame(0.9, 0.0, 0.0), basicProperties);
+	Part c(boxShape(1.0, 1.0, 1.0), GlobalCFrame(0.0, 0.9, 0.0), basicProperties);
+	std::vector<Colission> colissions{Colission{&a, &b}, Colission{&b, &c}, Colission{&c, &a}};
+
+	cache.storeColissions(colissions, 0);
+	ASSERT_STRICT(cache.size() == 3);
+	cache.forgetPart(&b);
+	ASSERT_STRICT(cache.size() == 1);
+	cache.forgetPart(&b);
+	ASSERT_STRICT(cache.size() == 1);
+
+	// stale entries must leave no trace for forgetPart either
+	cache.storeColissions(colissions, 1);
+	cache.storeColissions(std::vector<Colission>{Colission{&a, &b}}, 2);
+	cache.removeStaleEntries(2);
+	ASSERT_STRICT(cache.size() == 1);
+	cache.forgetPart(&c);
+	ASSERT_STRICT(cache.size() == 1);
+	cache.forgetPart(&a);
+	ASSERT_STRICT(cache.size() == 0);
+}
+
+TEST_CASE(restingContactReuseMatchesRegularTick) {
+	WorldPrototype world(DELTA_T);
+	WorldPrototype referenceWorld(DELTA_T);
+	world.reuseRestingContacts = true;
+	DirectionalGravity gravity(Vec3(0.0, -10.0, 0.0));
+	world.addExternalForce(&gravity);
+	referenceWorld.addExternalForce(&gravity);
+
+	Part floor(boxShape(20.0, 1.0, 20.0), GlobalCFrame(0.0, -0.5, 0.0), basicProperties);
+	Part referenceFloor(boxShape(20.0, 1.0, 20.0), GlobalCFrame(0.0, -0.5, 0.0), basicProperties);
+	Part box(boxShape(1.0, 1.0, 1.0), GlobalCFrame(0.0, 0.5, 0.0), basicProperties);
+	Part referenceBox(boxShape(1.0, 1.0, 1.0), GlobalCFrame(0.0, 0.5, 0.0), basicProperties);
+	world.addTerrainPart(&floor);
+	referenceWorld.addTerrainPart(&referenceFloor);
+	world.addPart(&box);
+	referenceWorld.addPart(&referenceBox);
+
+	long long cachedContacts = 0;
+	for(int i = 0; i < 200; i++) {
+		world.tick();
+		cachedContacts += intersectionStatistics.history.avg()[static_cast<int>(IntersectionResult::CACHED_CONTACT)];
+		referenceWorld.tick();
+	}
+
+	ASSERT_TRUE(cachedContacts > 0);
+	// a single box on a floor wobbles sideways a bit either way, it should rest at the same height
+	ASSERT_STRICT(world.contactCache.size() == 1);
+	Vec3 drift = box.getPosition() - Position(0.0, 0.5, 0.0);
+	Vec3 referenceDrift = referenceBox.getPosition() - Position(0.0, 0.5, 0.0);
+	ASSERT_TOLERANT(drift.y == referenceDrift.y, 0.01);
+	ASSERT_TRUE(std::abs(drift.x) < 0.2 && std::abs(drift.z) < 0.2);
+}
+
+TEST_CASE(boxRestsOnTriangleMeshTerrain) {
+	WorldPrototype world(DELTA_T);
+	DirectionalGravity gravity(Vec3(0.0, -10.0, 0.0));
+	world.addExternalForce(&gravity);
+
+	// a 4x4 grid of quads at y=0
+	EditableMesh grid(25, 32);
+	for(int x = 0; x < 5; x++) {
+		for(int z = 0; z < 5; z++) {
+			grid.setVertex(x * 5 + z, x * 2.0f - 4.0f, 0.0f, z * 2.0f - 4.0f);
+		}
+	}
+	for(int x = 0; x < 4; x++) {
+		for(int z = 0; z < 4; z++) {
+			int corner = x * 5 + z;
+			grid.setTriangle((x * 4 + z) * 2, corner, corner + 1, corner + 6);
+			grid.setTriangle((x * 4 + z) * 2 + 1, corner, corner + 6, corner + 5);
+		}
+	}
+
+	Part terrain(triangleMeshShape(TriangleMesh(std::move(grid))), GlobalCFrame(0.0, 0.0, 0.0), basicProperties);
+	Part box(boxShape(1.0, 1.0, 1.0), GlobalCFrame(0.7, 2.0, -1.3), basicProperties);
+	world.addTerrainPart(&terrain);
+	world.addPart(&box);
+
+	for(int i = 0; i < 300; i++) {
+		world.tick();
+	}
+
+	Vec3 offset = box.getPosition() - Position(0.0, 0.5, 0.0);
+	ASSERT_TOLERANT(offset.y == 0.0, 0.02);
+}
+
+TEST_CASE(boxRestsOnHeightfieldTerrain) {
+	WorldPrototype world(DELTA_T);
+	DirectionalGravity gravity(Vec3(0.0, -10.0, 0.0));
+	world.addExternalForce(&gravity);
+
+	// flat at y=0, with a hill in one corner that the box never reaches
+	std::vector<float> heights(33 * 33, 0.0f);
+	heights[30 * 33 + 30] = 3.0f;
+	Shape terrainShape = heightfieldShape(33, 33, heights.data(), 0.5, true);
+
+	Part terrain(terrainShape, GlobalCFrame(0.0, terrainShape.getHeight() / 2, 0.0), basicProperties);
+	Part box(boxShape(1.0, 1.0, 1.0), GlobalCFrame(-2.3, 2.0, 1.6), basicProperties);
+	world.addTerrainPart(&terrain);
+	world.addPart(&box);
+
+	for(int i = 0; i < 300; i++) {
+		world.tick();
+	}
+
+	Vec3 offset = box.getPosition() - Position(0.0, 0.5, 0.0);
+	ASSERT_TOLERANT(offset.y == 0.0, 0.02);
+}
+
+TEST_CASE(tickTracerKeepsNewestNestedEvents) {
+	TickTracer tracer;
+	tracer.enable(16);
+
+	tracer.beginTick();
+	tracer.begin("outer");
+	for(int i = 0; i < 20; i++) {
+		tracer.begin("inner");
+		tracer.end("inner", i);
+	}
+	tracer.end("outer");
+	tracer.endTick();
+
+	std::stringstream ss;
+	tracer.writeChromeTrace(ss);
+	std::string trace = ss.str();
+
+	auto countOf = [&trace](const std::string& str) {
+		int count = 0;
+		for(std::size_t pos = trace.find(str); pos != std::string::npos; pos = trace.find(str, pos + 1)) count++;
+		return count;
+	};
+
+	// the ring buffer holds the last 16 events, the oldest of which could be overwritten while reading and is skipped
+	// that leaves the ends of inner 13, outer and tick without their begins
+	ASSERT_STRICT(countOf("\"ph\":\"B\"") == 6);
+	ASSERT_STRICT(countOf("\"ph\":\"E\"") == 6);
+	ASSERT_TRUE(countOf("\"count\":19") == 1);
+	ASSERT_TRUE(countOf("\"name\":\"outer\"") == 0);
+}
+
+TEST_CASE(latencyHistogramPercentiles) {
+	LatencyHistogram histogram;
+	ASSERT_TRUE(histogram.getPercentile(99.0).count() == 0);
+
+	for(int i = 1; i <= 1000; i++) {
+		histogram.record(std::chrono::microseconds(i));
+	}
+	histogram.record(std::chrono::nanoseconds(37));
+
+	ASSERT_TRUE(histogram.getCount() == 1001);
+	ASSERT_TRUE(histogram.getMin().count() == 37);
+	ASSERT_TRUE(histogram.getMax() == std::chrono::microseconds(1000));
+	ASSERT_TRUE(histogram.getPercentile(0.0).count() == 37);
+	ASSERT_TRUE(histogram.getPercentile(100.0) == std::chrono::microseconds(1000));
+
+	// buckets are at most 1/64th of their value wide
+	ASSERT_TOLERANT(histogram.getPercentile(50.0).count() / 500000.0 == 1.0, 1.0 / 64);
+	ASSERT_TOLERANT(histogram.getPercentile(99.0).count() / 990000.0 == 1.0, 1.0 / 64);
+	ASSERT_TOLERANT(histogram.getPercentile(99.9).count() / 999000.0 == 1.0, 1.0 / 64);
+	ASSERT_TRUE(histogram.getPercentile(50.0) >= std::chrono::microseconds(500));
+}
+
+TEST_CASE(hardwareCountersPerProcess) {
+	HardwareCounters counters;
+	// perf_event_open is not allowed everywhere, the profiler must then record nothing
+	bool isOpen = counters.open();
+	ASSERT_TRUE(isOpen == counters.isOpenOnThisThread());
+
+	BreakdownAverageProfiler<PhysicsProcess> profiler(physicsMeasure.labels, 10);
+	profiler.setHardwareCounters(&counters);
+	volatile double work = 0.0;
+	for(int tick = 0; tick < 3; tick++) {
+		profiler.mark(PhysicsProcess::UPDATING);
+		for(int i = 0; i < 10000; i++) work = work + i * 0.5;
+		profiler.mark(PhysicsProcess::OTHER);
+		profiler.end();
+	}
+	profiler.setHardwareCounters(nullptr);
+
+	if(!isOpen) {
+		ASSERT_TRUE(profiler.counterHistory.size() == 0);
+		return;
+	}
+	ASSERT_TRUE(profiler.counterHistory.size() == 3);
+	HardwareCounterValues update = profiler.counterHistory.front().values[static_cast<std::size_t>(PhysicsProcess::UPDATING)];
+	if(counters.isAvailable(HardwareCounter::INSTRUCTIONS)) {
+		ASSERT_TRUE(update[HardwareCounter::INSTRUCTIONS] >= 10000);
+	}
+	ASSERT_TRUE(profiler.counterHistory.front().values[static_cast<std::size_t>(PhysicsProcess::WAIT_FOR_LOCK)][HardwareCounter::CYCLES] == 0);
+}
+
+// calls to operator new itself can't be optimized away like new expressions
+static void* volatile allocationSink;
+
+TEST_CASE(allocationTrackerCountsPerProcess) {
+	BreakdownAverageProfiler<PhysicsProcess> profiler(physicsMeasure.labels, 10);
+	profiler.setTrackAllocations(true);
+	allocationTracker.enable();
+
+	profiler.mark(PhysicsProcess::UPDATING);
+	allocationSink = ::operator new(100);
+	::operator delete(allocationSink);
+	allocationSink = ::operator new(28);
+	profiler.mark(PhysicsProcess::OTHER);
+	// sized deletes must be counted as well
+	::operator delete(allocationSink, 28);
+	profiler.end();
+
+	// a tick that allocates nothing must report exactly that
+	profiler.mark(PhysicsProcess::UPDATING);
+	profiler.mark(PhysicsProcess::OTHER);
+	profiler.end();
+
+	allocationTracker.disable();
+	profiler.setTrackAllocations(false);
+
+	ASSERT_TRUE(profiler.allocationHistory.size() == 2);
+	AllocationCounts updating = profiler.allocationHistory.tail().values[static_cast<std::size_t>(PhysicsProcess::UPDATING)];
+	AllocationCounts other = profiler.allocationHistory.tail().values[static_cast<std::size_t>(PhysicsProcess::OTHER)];
+	ASSERT_TRUE(updating.allocations == 2);
+	ASSERT_TRUE(updating.frees == 1);
+	ASSERT_TRUE(updating.bytes == 128);
+	ASSERT_TRUE(other.allocations == 0);
+	ASSERT_TRUE(other.frees == 1);
+
+	for(const AllocationCounts& counts : profiler.allocationHistory.front().values) {
+		ASSERT_TRUE(counts.allocations == 0);
+		ASSERT_TRUE(counts.frees == 0);
+	}
+}
+
+TEST_CASE(worldRecordingReplaysSameSimulation) {
+	PartProperties properties{1.0, 0.5, 0.3};
+	std::stringstream initialWorld;
+	{
+		WorldPrototype world(0.01);
+		world.addExternalForce(new DirectionalGravity(Vec3(0.0, -10.0, 0.0)));
+		world.addTerrainPart(new Part(boxShape(20.0, 1.0, 20.0), GlobalCFrame(0.0, 0.0, 0.0), properties));
+		for(int i = 0; i < 5; i++) {
+			world.addPart(new Part(boxShape(1.0, 1.0, 1.0), GlobalCFrame(i * 0.3, 1.0 + i * 1.1, 0.0), properties));
+		}
+		// a bumpy quantized heightfield beside the floor, so its shape class goes through the recording too
+		std::vector<float> heights(9 * 9);
+		for(int x = 0; x < 9; x++) {
+			for(int z = 0; z < 9; z++) {
+				heights[x * 9 + z] = 0.1f * ((x + z) % 3);
+			}
+		}
+		world.addTerrainPart(new Part(heightfieldShape(9, 9, heights.data(), 0.5, true), GlobalCFrame(14.0, 0.0, 0.0), properties));
+		world.addPart(new Part(boxShape(1.0, 1.0, 1.0), GlobalCFrame(14.3, 1.5, 0.4), properties));
+		SerializationSessionPrototype().serializeWorld(world, initialWorld);
+		world.clear();
+	}
+	// a loaded world, so the replay builds its colission trees the same way
+	WorldPrototype liveWorld(0.01);
+	DeSerializationSessionPrototype().deserializeWorld(liveWorld, initialWorld);
+
+	std::stringstream recording;
+	std::uint64_t lastLiveChecksum = 0;
+	{
+		WorldRecorder recorder(liveWorld, recording, true);
+		MagnetForce magnet(5.0, 1.0);
+		Part* added = nullptr;
+		for(int tick = 0; tick < 60; tick++) {
+			if(tick == 5) {
+				added = new Part(sphereShape(0.5), GlobalCFrame(3.0, 4.0, 0.0), properties);
+				recorder.addPart(added);
+				recorder.setMotion(*added, Vec3(-2.0, 0.0, 0.0), Vec3(0.0, 1.0, 0.0));
+			}
+			if(tick == 8) {
+				Vec3f vertices[4]{Vec3f(-2.0f, 0.0f, -2.0f), Vec3f(2.0f, 0.0f, -2.0f), Vec3f(2.0f, 0.0f, 2.0f), Vec3f(-2.0f, 0.0f, 2.0f)};
+				Triangle triangles[2]{{0, 3, 2}, {0, 2, 1}};
+				recorder.addTerrainPart(new Part(triangleMeshShape(TriangleMesh(4, 2, vertices, triangles)), GlobalCFrame(-14.0, 0.0, 0.0), properties));
+				recorder.addPart(new Part(sphereShape(0.5), GlobalCFrame(-14.0, 1.0, 0.0), properties));
+			}
+			if(tick == 10) recorder.applyForce(*liveWorld.physicals[0]->getMainPart(), Vec3(0.1, 0.0, 0.0), Vec3(0.0, 50.0, 0.0));
+			if(tick == 20) {
+				magnet.selectedPart = added;
+				magnet.magnetPoint = Position(0.0, 5.0, 0.0);
+				recorder.recordMagnet(magnet);
+				liveWorld.addExternalForce(&magnet);
+			}
+			if(tick == 30) {
+				magnet.selectedPart = nullptr;
+				recorder.recordMagnet(magnet);
+			}
+			if(tick == 40) {
+				recorder.removePart(added);
+				delete added;
+			}
+			if(tick == 45) recorder.setProperties(*liveWorld.physicals[1]->getMainPart(), PartProperties{2.0, 0.1, 0.8});
+			liveWorld.tick();
+			recorder.afterTick();
+		}
+		recorder.finish();
+		lastLiveChecksum = computeWorldChecksum(liveWorld);
+		liveWorld.removeExternalForce(&magnet);
+	}
+
+	WorldPrototype replayWorld(1.0);
+	{
+		WorldReplayer replayer(replayWorld, recording);
+		ASSERT_TRUE(replayer.getTickCount() == 60);
+		ASSERT_TRUE(replayWorld.deltaT == 0.01);
+		while(!replayer.isFinished()) {
+			replayer.tick();
+		}
+		ASSERT_TRUE(replayer.getCheckedTickCount() == 60);
+		ASSERT_TRUE(replayer.getMismatchedTickCount() == 0);
+		ASSERT_TRUE(computeWorldChecksum(replayWorld) == lastLiveChecksum);
+	}
+	liveWorld.clear();
+	replayWorld.clear();
+}